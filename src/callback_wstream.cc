@@ -0,0 +1,18 @@
+#include <callback_wstream.h>
+
+bool CallbackWStream::write(const void* buffer, size_t size) {
+    if (size == 0) {
+        return true;
+    }
+
+    if (!fWrite(buffer, size, fContext)) {
+        return false;
+    }
+
+    fBytesWritten += size;
+    return true;
+}
+
+size_t CallbackWStream::bytesWritten() const {
+    return fBytesWritten;
+}
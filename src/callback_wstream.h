@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <sk_stream.h>
+
+/**
+ *  Hands every write to a caller-supplied function instead of keeping the bytes, so the output
+ *  of an encode never has to be held in memory.
+ */
+class CallbackWStream : public SkWStream {
+public:
+    /** Receives |size| bytes at |data|; returns zero to fail the write. */
+    typedef int (*WriteFn)(const void* data, size_t size, void* context);
+
+    CallbackWStream(WriteFn write, void* context)
+        : fWrite(write)
+        , fContext(context)
+        , fBytesWritten(0)
+    {}
+
+    bool write(const void* buffer, size_t size) override;
+
+    size_t bytesWritten() const override;
+
+private:
+    WriteFn fWrite;
+    void*   fContext;
+    size_t  fBytesWritten;
+};
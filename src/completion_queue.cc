@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include <completion_queue.h>
+
+CompletionQueue::CompletionQueue()
+    : fReadFD(-1)
+    , fWriteFD(-1)
+{
+#if defined(__linux__)
+    fReadFD = fWriteFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fReadFD < 0) {
+        perror("completion_queue: cannot create eventfd");
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("completion_queue: cannot create pipe");
+        return;
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    fReadFD = fds[0];
+    fWriteFD = fds[1];
+#endif
+}
+
+CompletionQueue::~CompletionQueue() {
+    if (fReadFD >= 0) {
+        close(fReadFD);
+    }
+    if (fWriteFD >= 0 && fWriteFD != fReadFD) {
+        close(fWriteFD);
+    }
+}
+
+CompletionQueue* CompletionQueue::GetDefault() {
+    static CompletionQueue* queue = new CompletionQueue;
+    return queue;
+}
+
+void CompletionQueue::signal() {
+    if (fWriteFD < 0) {
+        return;
+    }
+
+#if defined(__linux__)
+    uint64_t one = 1;
+#else
+    char one = 1;
+#endif
+    // A full pipe already reports readable, so EAGAIN is not an error here.
+    if (write(fWriteFD, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("completion_queue: cannot signal completion");
+    }
+}
+
+void CompletionQueue::push(const TransformCompletion& completion) {
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        fCompletions.push_back(completion);
+    }
+    this->signal();
+}
+
+size_t CompletionQueue::drain(TransformCompletion* out, size_t max) {
+    // Reset the descriptor before popping, so a completion pushed concurrently always leaves it
+    // readable for the next poll.
+    if (fReadFD >= 0) {
+        char scratch[64];
+        while (read(fReadFD, scratch, sizeof(scratch)) > 0) {
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(fLock);
+    size_t count = 0;
+    while (count < max && !fCompletions.empty()) {
+        out[count++] = fCompletions.front();
+        fCompletions.pop_front();
+    }
+
+    // Leave the descriptor readable if the caller did not take everything.
+    if (!fCompletions.empty()) {
+        this->signal();
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <deque>
+#include <mutex>
+
+#include <skbitmap_to_png.h>
+
+/**
+ *  Thread-safe queue of finished asynchronous transforms.  Every push signals a pollable file
+ *  descriptor (an eventfd on Linux, a pipe elsewhere) so that a host event loop can wait for
+ *  completions without blocking in this library.
+ */
+class CompletionQueue {
+public:
+    CompletionQueue();
+    ~CompletionQueue();
+
+    /**
+     *  Process-wide queue used by the transform_*_async entry points.  It is never destroyed,
+     *  like SkExecutor::GetDefault(): pool threads may still push to it while the process
+     *  exits, and its descriptor stays open until then.
+     */
+    static CompletionQueue* GetDefault();
+
+    /**
+     *  Returns the descriptor that becomes readable when completions are pending, or -1 if it
+     *  could not be created.
+     */
+    int fd() const { return fReadFD; }
+
+    void push(const TransformCompletion& completion);
+
+    /**
+     *  Moves up to |max| completions into |out| and resets the descriptor.  Returns the number
+     *  of completions written.
+     */
+    size_t drain(TransformCompletion* out, size_t max);
+
+private:
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    void signal();
+
+    std::mutex                      fLock;
+    std::deque<TransformCompletion> fCompletions;
+    int                             fReadFD;
+    int                             fWriteFD;
+};
@@ -0,0 +1,184 @@
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <png.h>
+
+#include <sk_fast_deflate.h>
+#include <sk_rect.h>
+
+#include <encode_estimate.h>
+#include <vector_wstream.h>
+
+// Pairs of rows, so filters see a real row above the second, spread over the frame thinly
+// enough that periodic content such as lines of text does not alias with them.
+static constexpr int kProbeBands = 32;
+static constexpr int kProbeBandRows = 2;
+
+// Wider frames are sampled across their middle columns.
+static constexpr int kMaxProbeWidth = 4096;
+
+// Random bytes compress the same at any width, so rows this wide stand in for frames of any
+// width when there are no pixels to sample.  Enough rows to fill deflate's window several
+// times over.
+static constexpr int kRandomProbeWidth = 1024;
+static constexpr int kRandomProbeRows = 16;
+
+static uint64_t thread_cpu_ns() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Sums the data of the IDAT chunks of |png| and counts the chunks.
+static size_t idat_bytes(const std::vector<unsigned char>& png, size_t* chunks) {
+    size_t total = 0;
+    *chunks = 0;
+    for (size_t i = 8; i + 8 <= png.size();) {
+        const size_t length = ((size_t)png[i] << 24) | ((size_t)png[i + 1] << 16) |
+                              ((size_t)png[i + 2] << 8) | png[i + 3];
+        if (memcmp(&png[i + 4], "IDAT", 4) == 0) {
+            total += length;
+            (*chunks)++;
+        }
+        i += length + 12;
+    }
+    return total;
+}
+
+struct ProbeResult {
+    std::vector<unsigned char> fPng;
+    uint64_t                   fCpuNs;
+};
+
+static bool probe(const SkPixmap& band, const SkPngEncoder::Options& options,
+                  ProbeResult* result) {
+    result->fPng.clear();
+    VectorWStream dst(&result->fPng);
+    const uint64_t start = thread_cpu_ns();
+    const bool ok = SkPngEncoder::Encode(&dst, band, options);
+    result->fCpuNs = thread_cpu_ns() - start;
+    return ok;
+}
+
+// CPU time every encode spends however few rows it has: creating libpng's structs,
+// initializing deflate and writing the header.  Measured on a tiny image so the probes'
+// per-row cost can be scaled without it.
+static uint64_t measure_fixed_cpu_ns(SkPngEncoder::Options::Engine engine) {
+    // Two different pixels, which Encode() does not shortcut as uniform.
+    const uint32_t pixels[2] = {0x00000000, 0xFFFFFFFF};
+    const SkPixmap tiny(SkImageInfo::MakeN32(2, 1, kPremul_SkAlphaType), pixels, sizeof(pixels));
+    SkPngEncoder::Options options;
+    options.fComments = nullptr;
+    options.fEngine = engine;
+    ProbeResult result;
+    uint64_t fastest = UINT64_MAX;
+    for (int i = 0; i < 4; i++) {
+        if (probe(tiny, options, &result)) {
+            fastest = std::min(fastest, result.fCpuNs);
+        }
+    }
+    return fastest == UINT64_MAX ? 0 : fastest;
+}
+
+// Measured once per engine.
+static uint64_t fixed_cpu_ns(SkPngEncoder::Options::Engine engine) {
+    if (engine == SkPngEncoder::Options::Engine::kFast) {
+        static const uint64_t fast = measure_fixed_cpu_ns(engine);
+        return fast;
+    }
+    static const uint64_t libpng = measure_fixed_cpu_ns(engine);
+    return libpng;
+}
+
+// Peak size of the vector the output is collected in: it doubles as it grows, and holds the
+// old buffer and the new one while copying between them.
+static uint64_t collected_output_bytes(uint64_t output) {
+    uint64_t capacity = 1;
+    while (capacity < output) {
+        capacity *= 2;
+    }
+    return capacity + capacity / 2;
+}
+
+static size_t clamp_size(double bytes) {
+    return bytes < (double)SIZE_MAX ? (size_t)bytes : SIZE_MAX;
+}
+
+bool EstimatePngEncode(const SkPixmap& pixels, const SkPngEncoder::Options& options,
+                       bool collectOutput, EncodeEstimate* estimate) {
+    const size_t maxOutput = SkPngEncoder::MaxEncodedSize(pixels.info(), options);
+    const size_t working = SkPngEncoder::WorkingMemory(pixels.info(), options);
+    if (maxOutput == 0 || working == 0) {
+        return false;
+    }
+
+    // Bands are encoded upright: an orientation moves rows around without changing how they
+    // compress much.
+    SkPngEncoder::Options probeOptions = options;
+    probeOptions.fLimits = nullptr;
+    probeOptions.fPipelined = false;
+    probeOptions.fOrigin = kTopLeft_SkEncodedOrigin;
+
+    // The sampled rows are gathered into one image and encoded together, so deflate warms up
+    // once, as it does over a whole frame.
+    const int width = pixels.width(), height = pixels.height();
+    SkImageInfo info = pixels.info();
+    std::vector<uint8_t> rows;
+    if (pixels.addr() != nullptr) {
+        const int bandRows = std::min(kProbeBandRows, height);
+        const int bands = std::min(kProbeBands, height / bandRows);
+        const int left = (width - std::min(width, kMaxProbeWidth)) / 2;
+        info = info.makeWH(std::min(width, kMaxProbeWidth), bands * bandRows);
+        const size_t rowBytes = info.minRowBytes();
+        rows.resize(info.computeMinByteSize());
+        for (int i = 0; i < bands; i++) {
+            const int top = (int)((int64_t)i * (height - bandRows) / std::max(1, bands - 1));
+            for (int y = 0; y < bandRows; y++) {
+                memcpy(rows.data() + (i * bandRows + y) * rowBytes, pixels.addr(left, top + y),
+                       rowBytes);
+            }
+        }
+    } else {
+        info = info.makeWH(std::min(width, kRandomProbeWidth),
+                           std::min(height, kRandomProbeRows));
+        rows.resize(info.computeMinByteSize());
+        uint32_t state = 0x9E3779B9;
+        for (uint8_t& byte : rows) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = (uint8_t)state;
+        }
+    }
+
+    ProbeResult result;
+    if (!probe(SkPixmap(info, rows.data(), info.minRowBytes()), probeOptions, &result)) {
+        return false;
+    }
+    const uint64_t fixedNs = fixed_cpu_ns(options.fEngine);
+    const uint64_t sampledNs = result.fCpuNs > fixedNs ? result.fCpuNs - fixedNs : 0;
+    size_t chunks;
+    const size_t sampledIdat = idat_bytes(result.fPng, &chunks);
+    const size_t otherBytes = result.fPng.size() - sampledIdat - 12 * chunks;
+
+    // libpng cuts the frame's deflate stream into IDATs of PNG_ZBUF_SIZE bytes, the fast
+    // engine into larger ones.
+    const double idatChunk = options.fEngine == SkPngEncoder::Options::Engine::kFast
+                                     ? SkFastDeflate::kOutputBytes
+                                     : PNG_ZBUF_SIZE;
+    const double scale = (double)width * height / ((double)info.width() * info.height());
+    const double idat = sampledIdat * scale;
+    const double expected = otherBytes + idat + 12 * std::ceil(idat / idatChunk);
+
+    estimate->fMaxOutputBytes = maxOutput;
+    estimate->fExpectedOutputBytes = std::min(clamp_size(expected), maxOutput);
+    estimate->fPeakMemoryBytes = clamp_size(
+            working + (collectOutput ? collected_output_bytes(estimate->fExpectedOutputBytes)
+                                     : 0));
+    estimate->fExpectedCpuNs = fixedNs + (uint64_t)(sampledNs * scale);
+    return true;
+}
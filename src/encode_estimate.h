@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sk_pixmap.h>
+#include <sk_png_encoder.h>
+
+/**
+ *  What encoding a frame as a png is expected to cost, known before the encode runs so that
+ *  admission control can turn it away.
+ */
+struct EncodeEstimate {
+    /** No png of the frame can be larger. */
+    size_t   fMaxOutputBytes = 0;
+
+    /** Projected from encoding a few bands of rows. */
+    size_t   fExpectedOutputBytes = 0;
+
+    /** What the encode allocates, including the output when it is collected. */
+    size_t   fPeakMemoryBytes = 0;
+
+    /** Projected CPU time of the encode on one thread of this host. */
+    uint64_t fExpectedCpuNs = 0;
+};
+
+/**
+ *  Estimates encoding |pixels| with |options| by encoding bands of rows spread over the frame
+ *  and scaling the bytes and CPU time they took.  When |pixels| has no pixel memory the bands
+ *  are random bytes of the same format, so the expected values are those of incompressible
+ *  content.  |collectOutput| counts the vector the output grows in towards the peak memory.
+ *  Returns false for pixels the png encoder does not support.
+ */
+bool EstimatePngEncode(const SkPixmap& pixels, const SkPngEncoder::Options& options,
+                       bool collectOutput, EncodeEstimate* estimate);
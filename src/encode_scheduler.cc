@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include <sk_executor.h>
+
+#include <encode_scheduler.h>
+
+static int resolve_concurrency(int maxConcurrent) {
+    if (maxConcurrent > 0) {
+        return maxConcurrent;
+    }
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+EncodeScheduler::EncodeScheduler(int maxConcurrent, size_t maxInflightBytes)
+    : fMaxConcurrent(resolve_concurrency(maxConcurrent))
+    , fMaxInflightBytes(maxInflightBytes)
+{}
+
+EncodeScheduler* EncodeScheduler::GetDefault() {
+    static EncodeScheduler* scheduler = new EncodeScheduler(0, 0);
+    return scheduler;
+}
+
+void EncodeScheduler::setLimits(int maxConcurrent, size_t maxInflightBytes) {
+    std::deque<std::function<void(void)>> ready;
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        fMaxConcurrent = resolve_concurrency(maxConcurrent);
+        fMaxInflightBytes = maxInflightBytes;
+        this->pump(&ready);
+    }
+    fAdmittedCV.notify_all();
+    this->dispatch(&ready);
+}
+
+bool EncodeScheduler::canAdmit(Lane lane, size_t bytes) const {
+    int limit = fMaxConcurrent;
+    if (lane == kBulk && limit > 1) {
+        limit--;
+    }
+    if (fStats.fRunning >= limit) {
+        return false;
+    }
+
+    // A single job larger than the whole budget still runs, but alone.
+    if (fMaxInflightBytes != 0 && fStats.fRunning > 0 &&
+        fStats.fInflightBytes + bytes > fMaxInflightBytes) {
+        return false;
+    }
+    return true;
+}
+
+void EncodeScheduler::admit(Waiter* waiter, Clock::time_point now) {
+    auto waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - waiter->fEnqueued).count();
+
+    LaneStats& lane = fStats.fLanes[waiter->fLane];
+    lane.fAdmitted++;
+    lane.fTotalWaitUs += waitUs;
+    lane.fMaxWaitUs = std::max<uint64_t>(lane.fMaxWaitUs, waitUs);
+
+    fStats.fRunning++;
+    fStats.fInflightBytes += waiter->fBytes;
+    waiter->fAdmitted = true;
+}
+
+void EncodeScheduler::enqueue(Waiter* waiter) {
+    LaneStats& lane = fStats.fLanes[waiter->fLane];
+    fQueues[waiter->fLane].push_back(waiter);
+    lane.fQueueDepth = fQueues[waiter->fLane].size();
+    lane.fMaxQueueDepth = std::max(lane.fMaxQueueDepth, lane.fQueueDepth);
+}
+
+void EncodeScheduler::expire(Lane lane, Clock::time_point now,
+                             std::deque<std::function<void(void)>>* ready) {
+    auto& queue = fQueues[lane];
+    for (auto it = queue.begin(); it != queue.end();) {
+        Waiter* waiter = *it;
+
+        // Sync waiters time out on their own in acquire().
+        if (!waiter->fWork || waiter->fDeadline > now) {
+            ++it;
+            continue;
+        }
+
+        ready->push_back(std::move(waiter->fExpired));
+        fStats.fLanes[lane].fExpired++;
+        delete waiter;
+        it = queue.erase(it);
+    }
+}
+
+void EncodeScheduler::pump(std::deque<std::function<void(void)>>* ready) {
+    auto now = Clock::now();
+    for (int i = 0; i < kLaneCount; i++) {
+        this->expire((Lane)i, now, ready);
+        fStats.fLanes[i].fQueueDepth = fQueues[i].size();
+    }
+
+    for (int i = 0; i < kLaneCount; i++) {
+        auto& queue = fQueues[i];
+        while (!queue.empty() && this->canAdmit((Lane)i, queue.front()->fBytes)) {
+            Waiter* waiter = queue.front();
+            queue.pop_front();
+            this->admit(waiter, now);
+
+            // Async waiters are owned by the queue; sync waiters live on the stack of the
+            // thread blocked in acquire().
+            if (waiter->fWork) {
+                ready->push_back(std::move(waiter->fWork));
+                delete waiter;
+            }
+        }
+        fStats.fLanes[i].fQueueDepth = queue.size();
+
+        // Never let a lower lane overtake a blocked higher one.
+        if (!queue.empty()) {
+            break;
+        }
+    }
+}
+
+void EncodeScheduler::dispatch(std::deque<std::function<void(void)>>* ready) {
+    for (auto& work : *ready) {
+        SkExecutor::GetDefault().add(std::move(work));
+    }
+}
+
+bool EncodeScheduler::acquire(Lane lane, size_t bytes, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(fLock);
+
+    Waiter waiter;
+    waiter.fLane = lane;
+    waiter.fBytes = bytes;
+    waiter.fEnqueued = Clock::now();
+
+    bool higherWaiting = false;
+    for (int i = 0; i <= lane; i++) {
+        higherWaiting |= !fQueues[i].empty();
+    }
+    if (!higherWaiting && this->canAdmit(lane, bytes)) {
+        this->admit(&waiter, waiter.fEnqueued);
+        return true;
+    }
+
+    this->enqueue(&waiter);
+    auto isAdmitted = [&waiter] { return waiter.fAdmitted; };
+    if (deadline == Clock::time_point::max()) {
+        fAdmittedCV.wait(lock, isAdmitted);
+        return true;
+    }
+    if (fAdmittedCV.wait_until(lock, deadline, isAdmitted)) {
+        return true;
+    }
+
+    // Nobody is waiting for this encode any more; shed it from the queue.
+    auto& queue = fQueues[lane];
+    queue.erase(std::find(queue.begin(), queue.end(), &waiter));
+    fStats.fLanes[lane].fQueueDepth = queue.size();
+    fStats.fLanes[lane].fExpired++;
+
+    // The expired waiter may have been blocking the ones behind it.
+    std::deque<std::function<void(void)>> ready;
+    this->pump(&ready);
+    lock.unlock();
+    fAdmittedCV.notify_all();
+    this->dispatch(&ready);
+    return false;
+}
+
+void EncodeScheduler::release(size_t bytes) {
+    std::deque<std::function<void(void)>> ready;
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        fStats.fRunning--;
+        fStats.fInflightBytes -= bytes;
+        this->pump(&ready);
+    }
+    fAdmittedCV.notify_all();
+    this->dispatch(&ready);
+}
+
+int EncodeScheduler::acquireHelpers(Lane lane, int wanted) {
+    if (wanted <= 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(fLock);
+
+    // Queued encodes come before the helpers of running ones.
+    for (int i = 0; i < kLaneCount; i++) {
+        if (!fQueues[i].empty()) {
+            return 0;
+        }
+    }
+
+    int count = 0;
+    while (count < wanted && this->canAdmit(lane, 0)) {
+        fStats.fRunning++;
+        count++;
+    }
+    return count;
+}
+
+void EncodeScheduler::releaseHelpers(int count) {
+    std::deque<std::function<void(void)>> ready;
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        fStats.fRunning -= count;
+        this->pump(&ready);
+    }
+    fAdmittedCV.notify_all();
+    this->dispatch(&ready);
+}
+
+void EncodeScheduler::schedule(Lane lane, size_t bytes, Clock::time_point deadline,
+                               std::function<void(void)> work,
+                               std::function<void(void)> expired) {
+    auto run = [this, bytes, work] {
+        work();
+        this->release(bytes);
+    };
+
+    std::deque<std::function<void(void)>> ready;
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        std::unique_ptr<Waiter> waiter(new Waiter);
+        waiter->fLane = lane;
+        waiter->fBytes = bytes;
+        waiter->fEnqueued = Clock::now();
+        waiter->fDeadline = deadline;
+        waiter->fWork = run;
+        waiter->fExpired = std::move(expired);
+        this->enqueue(waiter.release());
+        this->pump(&ready);
+    }
+    fAdmittedCV.notify_all();
+    this->dispatch(&ready);
+}
+
+EncodeScheduler::Stats EncodeScheduler::stats() {
+    std::lock_guard<std::mutex> lock(fLock);
+    return fStats;
+}
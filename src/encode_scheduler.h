@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+/**
+ *  Admission control in front of the encoders.  Limits how many encodes run at once and how
+ *  many input bytes they hold, and keeps two priority lanes so that latency-sensitive work
+ *  never queues behind bulk work: interactive waiters are always admitted first, and one slot
+ *  is held back from the bulk lane whenever more than one encode may run.
+ */
+class EncodeScheduler {
+public:
+    enum Lane {
+        kInteractive,
+        kBulk,
+
+        kLaneCount,
+    };
+
+    struct LaneStats {
+        uint64_t fAdmitted = 0;
+        uint64_t fQueueDepth = 0;
+        uint64_t fMaxQueueDepth = 0;
+        uint64_t fTotalWaitUs = 0;
+        uint64_t fMaxWaitUs = 0;
+        uint64_t fExpired = 0;
+    };
+
+    struct Stats {
+        int       fRunning = 0;
+        size_t    fInflightBytes = 0;
+        LaneStats fLanes[kLaneCount];
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     *  Blocks in the constructor until the encode is admitted or |deadline| passes, and
+     *  releases its slot in the destructor.
+     */
+    class Scope {
+    public:
+        Scope(EncodeScheduler* scheduler, Lane lane, size_t bytes,
+              Clock::time_point deadline = Clock::time_point::max())
+            : fScheduler(scheduler)
+            , fBytes(bytes)
+        {
+            fAdmitted = fScheduler->acquire(lane, fBytes, deadline);
+        }
+
+        ~Scope() {
+            if (fAdmitted) {
+                fScheduler->release(fBytes);
+            }
+        }
+
+        bool admitted() const { return fAdmitted; }
+
+    private:
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        EncodeScheduler* fScheduler;
+        size_t           fBytes;
+        bool             fAdmitted;
+    };
+
+    /**
+     *  Takes up to |wanted| more slots for the helper threads of an encode that already holds
+     *  one, without waiting: only slots that are free and that no queued encode is waiting for.
+     *  Releases them in the destructor.  Helper slots hold no bytes.
+     */
+    class Helpers {
+    public:
+        Helpers(EncodeScheduler* scheduler, Lane lane, int wanted)
+            : fScheduler(scheduler)
+            , fCount(scheduler->acquireHelpers(lane, wanted))
+        {}
+
+        ~Helpers() {
+            if (fCount > 0) {
+                fScheduler->releaseHelpers(fCount);
+            }
+        }
+
+        int count() const { return fCount; }
+
+    private:
+        Helpers(const Helpers&) = delete;
+        Helpers& operator=(const Helpers&) = delete;
+
+        EncodeScheduler* fScheduler;
+        int              fCount;
+    };
+
+    /**
+     *  |maxConcurrent| <= 0 selects the number of cores.  |maxInflightBytes| of zero disables
+     *  the byte limit.
+     */
+    EncodeScheduler(int maxConcurrent, size_t maxInflightBytes);
+
+    /**
+     *  Process-wide scheduler used by the C API.  It is never destroyed, like
+     *  SkExecutor::GetDefault(): pool threads may still release slots while the process exits.
+     */
+    static EncodeScheduler* GetDefault();
+
+    void setLimits(int maxConcurrent, size_t maxInflightBytes);
+
+    /** Returns false, without taking a slot, if |deadline| passes first. */
+    bool acquire(Lane lane, size_t bytes, Clock::time_point deadline = Clock::time_point::max());
+    void release(size_t bytes);
+
+    /** Returns how many of |wanted| helper slots were taken; see Helpers. */
+    int acquireHelpers(Lane lane, int wanted);
+    void releaseHelpers(int count);
+
+    /**
+     *  Runs |work| on the default SkExecutor once admitted, without blocking the caller or a
+     *  pool thread while it waits.  The slot is released afterwards.  If |deadline| passes
+     *  while the work is still queued, it is dropped and |expired| runs on the executor instead,
+     *  without taking a slot.  Queued work is checked against its deadline whenever the queue
+     *  changes, so |expired| runs no later than the moment the work would have been admitted.
+     */
+    void schedule(Lane lane, size_t bytes, Clock::time_point deadline,
+                  std::function<void(void)> work, std::function<void(void)> expired);
+
+    Stats stats();
+
+private:
+    struct Waiter {
+        Lane                      fLane;
+        size_t                    fBytes;
+        Clock::time_point         fEnqueued;
+        Clock::time_point         fDeadline = Clock::time_point::max();
+        bool                      fAdmitted = false;
+        std::function<void(void)> fWork;
+        std::function<void(void)> fExpired;
+    };
+
+    EncodeScheduler(const EncodeScheduler&) = delete;
+    EncodeScheduler& operator=(const EncodeScheduler&) = delete;
+
+    bool canAdmit(Lane lane, size_t bytes) const;
+    void admit(Waiter* waiter, Clock::time_point now);
+    void enqueue(Waiter* waiter);
+
+    /**
+     *  Drops the async waiters of |lane| whose deadline is before |now|.  Must hold fLock; their
+     *  expiry work is appended to |ready|.
+     */
+    void expire(Lane lane, Clock::time_point now, std::deque<std::function<void(void)>>* ready);
+
+    /**
+     *  Sheds expired async waiters and admits queued waiters in priority order.  Must hold fLock;
+     *  admitted and expired async work is appended to |ready| and dispatched by the caller after
+     *  unlocking.
+     */
+    void pump(std::deque<std::function<void(void)>>* ready);
+    void dispatch(std::deque<std::function<void(void)>>* ready);
+
+    std::mutex              fLock;
+    std::condition_variable fAdmittedCV;
+    std::deque<Waiter*>     fQueues[kLaneCount];
+    int                     fMaxConcurrent;
+    size_t                  fMaxInflightBytes;
+    Stats                   fStats;
+};
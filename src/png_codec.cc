@@ -23,22 +23,53 @@ static void AddComments(SkPngEncoder::Options& options,
       static_cast<int>(comment_pointers.size()));
 }
 
+static SkPngEncoder::Options MakeOptions(
+    const std::vector<PNGCodec::Comment>& comments,
+    int zlib_level) {
+  SkPngEncoder::Options options;
+  AddComments(options, comments);
+  options.fZLibLevel = zlib_level;
+  return options;
+}
+
 static bool EncodeSkPixmap(const SkPixmap& src,
-                           const std::vector<PNGCodec::Comment>& comments,
-                           std::vector<unsigned char>* output,
-                           int zlib_level) {
+                           const SkPngEncoder::Options& options,
+                           std::vector<unsigned char>* output) {
   output->clear();
   VectorWStream dst(output);
 
-  SkPngEncoder::Options options;
-  AddComments(options, comments);
-  options.fZLibLevel = zlib_level;
   return SkPngEncoder::Encode(&dst, src, options);
 }
 
 // static
 bool PNGCodec::FastEncodeBGRASkBitmap(const SkPixmap& input, std::vector<unsigned char>* output) {
-  return EncodeSkPixmap(input, std::vector<PNGCodec::Comment>(), output, Z_BEST_SPEED);
+  return EncodeSkPixmap(input, FastEncodeOptions(), output);
+}
+
+// static
+SkPngEncoder::Options PNGCodec::FastEncodeOptions() {
+  return MakeOptions(std::vector<PNGCodec::Comment>(), Z_BEST_SPEED);
+}
+
+// static
+bool PNGCodec::EncodeWithOptions(const SkPixmap& input,
+                                 const SkPngEncoder::Options& options,
+                                 std::vector<unsigned char>* output) {
+  return EncodeSkPixmap(input, options, output);
+}
+
+// static
+bool PNGCodec::EncodeWithOptions(const SkPixmap& input,
+                                 const SkPngEncoder::Options& options,
+                                 SkWStream* output) {
+  return SkPngEncoder::Encode(output, input, options);
+}
+
+// static
+std::unique_ptr<SkEncoder> PNGCodec::MakeEncoder(const SkPixmap& input,
+                                                 const SkPngEncoder::Options& options,
+                                                 SkWStream* output) {
+  return SkPngEncoder::Make(output, input, options);
 }
 
 PNGCodec::Comment::Comment(const std::string& k, const std::string& t)
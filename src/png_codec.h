@@ -2,10 +2,14 @@
 
 #include <stddef.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <sk_encoder.h>
 #include <sk_pixmap.h>
+#include <sk_png_encoder.h>
+#include <sk_stream.h>
 
 // Interface for encoding and decoding PNG data. This is a wrapper around
 // libpng, which has an inconvenient interface for callers. This is currently
@@ -43,4 +47,25 @@ class PNGCodec {
   // between this and the previous method is that this restricts compression to
   // zlib q1, which is just rle encoding.
   static bool FastEncodeBGRASkBitmap(const SkPixmap& input, std::vector<unsigned char>* output);
+
+  // Returns the encoder options FastEncodeBGRASkBitmap uses, for callers that
+  // want the same output with limits or threading added on top.
+  static SkPngEncoder::Options FastEncodeOptions();
+
+  // Encodes |input| with explicit encoder |options|.
+  static bool EncodeWithOptions(const SkPixmap& input,
+                                const SkPngEncoder::Options& options,
+                                std::vector<unsigned char>* output);
+
+  // Same as above, writing the encoded bytes to |output| as they are produced.
+  static bool EncodeWithOptions(const SkPixmap& input,
+                                const SkPngEncoder::Options& options,
+                                SkWStream* output);
+
+  // Creates an encoder for callers that drive SkEncoder::encodeRows()
+  // themselves. |input|, |output| and anything |options| points to must
+  // outlive the returned encoder. Returns nullptr on an invalid |input|.
+  static std::unique_ptr<SkEncoder> MakeEncoder(const SkPixmap& input,
+                                                const SkPngEncoder::Options& options,
+                                                SkWStream* output);
 };
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include <png_codec.h>
+
+#include <push_encoder.h>
+#include <vector_wstream.h>
+
+// Band buffers a worker may hold at once: one being encoded, one queued behind it and one the
+// caller is filling.
+static constexpr int kMaxBands = 3;
+
+std::unique_ptr<PushEncoder> PushEncoder::Make(
+        const SkImageInfo& info, const SkEncodeLimits& limits, bool useWorker,
+        SkPngEncoder::Options::ColorSpaceHandling colorSpace,
+        SkPngEncoder::Options::Engine engine, std::unique_ptr<SkWStream> output) {
+    std::unique_ptr<PushEncoder> encoder(new PushEncoder(info, limits, std::move(output)));
+
+    SkPngEncoder::Options options = PNGCodec::FastEncodeOptions();
+    options.fLimits = &encoder->fLimits;
+    options.fColorSpaceHandling = colorSpace;
+    options.fEngine = engine;
+    encoder->fEncoder = SkPngEncoder::MakeForRows(encoder->fStream.get(), encoder->fShape,
+                                                  options);
+    if (!encoder->fEncoder) {
+        return nullptr;
+    }
+
+    if (useWorker) {
+        for (int i = 0; i < kMaxBands; i++) {
+            encoder->fFree.emplace_back(new Band);
+        }
+        encoder->fWorker = std::thread(&PushEncoder::run, encoder.get());
+    }
+    return encoder;
+}
+
+PushEncoder::PushEncoder(const SkImageInfo& info, const SkEncodeLimits& limits,
+                         std::unique_ptr<SkWStream> output)
+    : fLimits(limits)
+    , fShape(info, nullptr, info.minRowBytes())
+    , fOutput(output ? nullptr : new std::vector<unsigned char>)
+    , fStream(output ? std::move(output)
+                     : std::unique_ptr<SkWStream>(new VectorWStream(fOutput.get())))
+    , fRowsPushed(0)
+    , fClosing(false)
+    , fFailed(false)
+{}
+
+PushEncoder::~PushEncoder() {
+    this->finish();
+}
+
+bool PushEncoder::push(const void* rows, int count, size_t rowBytes) {
+    const size_t minRowBytes = fShape.info().minRowBytes();
+    if (!rows || count <= 0 || count > fShape.height() - fRowsPushed || rowBytes < minRowBytes) {
+        return false;
+    }
+    fRowsPushed += count;
+
+    if (!fWorker.joinable()) {
+        return this->encode(rows, count, rowBytes);
+    }
+
+    std::unique_ptr<Band> band;
+    {
+        std::unique_lock<std::mutex> lock(fLock);
+        fCV.wait(lock, [this] { return fFailed || !fFree.empty(); });
+        if (fFailed) {
+            return false;
+        }
+        band = std::move(fFree.back());
+        fFree.pop_back();
+    }
+
+    // Pack the rows so the worker does not depend on the caller's buffer.
+    band->fPixels.resize(count * minRowBytes);
+    for (int y = 0; y < count; y++) {
+        memcpy(band->fPixels.data() + y * minRowBytes,
+               static_cast<const uint8_t*>(rows) + y * rowBytes, minRowBytes);
+    }
+    band->fRows = count;
+
+    std::lock_guard<std::mutex> lock(fLock);
+    fQueued.push_back(std::move(band));
+    fCV.notify_all();
+    return true;
+}
+
+bool PushEncoder::finish() {
+    if (fWorker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(fLock);
+            fClosing = true;
+            fCV.notify_all();
+        }
+        fWorker.join();
+    }
+
+    return !this->failed() && fRowsPushed == fShape.height();
+}
+
+bool PushEncoder::failed() const {
+    std::lock_guard<std::mutex> lock(fLock);
+    return fFailed;
+}
+
+bool PushEncoder::encode(const void* rows, int count, size_t rowBytes) {
+    SkPixmap band(fShape.info().makeWH(fShape.width(), count), rows, rowBytes);
+    if (fEncoder->encodeRows(band)) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(fLock);
+    fFailed = true;
+    fCV.notify_all();
+    return false;
+}
+
+void PushEncoder::run() {
+    std::unique_lock<std::mutex> lock(fLock);
+    for (;;) {
+        fCV.wait(lock, [this] { return fClosing || fFailed || !fQueued.empty(); });
+        if (fQueued.empty() || fFailed) {
+            return;
+        }
+
+        std::unique_ptr<Band> band = std::move(fQueued.front());
+        fQueued.pop_front();
+        lock.unlock();
+
+        const bool ok = this->encode(band->fPixels.data(), band->fRows,
+                                     fShape.info().minRowBytes());
+
+        lock.lock();
+        fFree.push_back(std::move(band));
+        fCV.notify_all();
+        if (!ok) {
+            return;
+        }
+    }
+}
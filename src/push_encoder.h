@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sk_encode_limits.h>
+#include <sk_encoder.h>
+#include <sk_image_info.h>
+#include <sk_pixmap.h>
+#include <sk_png_encoder.h>
+#include <sk_stream.h>
+
+/**
+ *  Encodes a png whose rows are pushed by the caller a band at a time, so the full frame never
+ *  has to exist in memory.  Without a worker each push() encodes the band in place before
+ *  returning.  With a worker, push() copies the band into one of a few band buffers and returns
+ *  while the worker encodes it, blocking only when every buffer is still queued.
+ */
+class PushEncoder {
+public:
+    /**
+     *  Returns nullptr on an invalid or unsupported |info|.  |colorSpace| decides how a color
+     *  space on |info| reaches the png, and |engine| what filters and deflates its rows.  The
+     *  png is written to |output| when given, and collected for releaseOutput() otherwise.
+     */
+    static std::unique_ptr<PushEncoder> Make(
+            const SkImageInfo& info, const SkEncodeLimits& limits, bool useWorker,
+            SkPngEncoder::Options::ColorSpaceHandling colorSpace =
+                    SkPngEncoder::Options::ColorSpaceHandling::kEmbed,
+            SkPngEncoder::Options::Engine engine = SkPngEncoder::Options::Engine::kLibpng,
+            std::unique_ptr<SkWStream> output = nullptr);
+
+    ~PushEncoder();
+
+    /**
+     *  Queues the next |count| rows, |rowBytes| apart.  Returns false on invalid arguments,
+     *  including more rows than the image has left, or once encoding has failed.
+     */
+    bool push(const void* rows, int count, size_t rowBytes);
+
+    /** Waits for queued bands.  Returns true if every row was encoded. */
+    bool finish();
+
+    bool failed() const;
+    const SkEncodeLimits& limits() const { return fLimits; }
+
+    /**
+     *  Transfers the encoded bytes to the caller.  Only valid once finish() returned true;
+     *  returns nullptr when the encoder was made with an output stream.
+     */
+    std::vector<unsigned char>* releaseOutput() { return fOutput.release(); }
+
+private:
+    struct Band {
+        std::vector<uint8_t> fPixels;
+        int                  fRows;
+    };
+
+    PushEncoder(const SkImageInfo& info, const SkEncodeLimits& limits,
+                std::unique_ptr<SkWStream> output);
+
+    PushEncoder(const PushEncoder&) = delete;
+    PushEncoder& operator=(const PushEncoder&) = delete;
+
+    bool encode(const void* rows, int count, size_t rowBytes);
+    void run();
+
+    // Declared in dependency order: the encoder refers to fLimits, fShape and fStream.
+    SkEncodeLimits                              fLimits;
+    SkPixmap                                    fShape;
+    std::unique_ptr<std::vector<unsigned char>> fOutput;
+    std::unique_ptr<SkWStream>                  fStream;
+    std::unique_ptr<SkEncoder>                  fEncoder;
+
+    int fRowsPushed;
+
+    mutable std::mutex                 fLock;
+    std::condition_variable            fCV;
+    std::deque<std::unique_ptr<Band>>  fQueued;
+    std::vector<std::unique_ptr<Band>> fFree;
+    bool                               fClosing;
+    bool                               fFailed;
+    std::thread                        fWorker;
+};
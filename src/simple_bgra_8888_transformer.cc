@@ -1,75 +1,170 @@
+#include <algorithm>
+
 #include <simple_bgra_8888_transformer.h>
 
-#include <sk_image_encoder_fns.h>
 #include <sk_image_info.h>
 #include <sk_image_encoder_private.h>
 #include <sk_msan.h>
+#include <sk_row_transform.h>
+#include <sk_task_group.h>
 
-static transform_scanline_proc choose_proc(const SkImageInfo& info) {
-    switch (info.colorType()) {
-        case kUnknown_SkColorType:
-            break;
-
-        case kBGRA_8888_SkColorType:
-            switch (info.alphaType()) {
-                case kPremul_SkAlphaType:
-                    return transform_scanline_bgrA_same;
-                default:
-                    assert(false);
-                    return nullptr;
-            }
+// Bands smaller than this cost more to schedule than to transform.
+static constexpr int kMinRowsPerBand = 16;
+
+// Bands are converted this many pixels' worth of rows per call, a few hundred kilobytes at a
+// time, with the limits checked between calls.
+static constexpr int kRunPixels = 1 << 16;
+
+// Output keeps the src alpha type, so premultiplied rows stay premultiplied.
+static bool init_xform(SkColorSpaceXformRow* xform, const SkImageInfo& info) {
+    skcms_AlphaFormat alpha = skcms_AlphaFormat_Unpremul;
+    if (info.isOpaque()) {
+        alpha = skcms_AlphaFormat_Opaque;
+    } else if (info.alphaType() == kPremul_SkAlphaType) {
+        alpha = skcms_AlphaFormat_PremulAsEncoded;
     }
-    
-    assert(false);
-    return nullptr;
+    return xform->init(info, skcms_PixelFormat_BGRA_8888, alpha);
 }
 
 std::unique_ptr<SkEncoder> SimpleBGRA8888Transformer::Make(const SkPixmap& src, SkWStream* dst, 
-                                                            const SkImageInfo& info) {
+                                                            const SkImageInfo& info,
+                                                            SkEncodeLimits* limits,
+                                                            SkEncodedOrigin origin) {
     if (!SkPixmapIsValid(src)) {
         return nullptr;
     }
 
-    auto ret = std::unique_ptr<SimpleBGRA8888Transformer>(new SimpleBGRA8888Transformer(src, dst));
+    std::unique_ptr<SkOrientedRows> rows;
+    if (origin != kTopLeft_SkEncodedOrigin) {
+        rows.reset(new SkOrientedRows(src, origin));
+    }
+    const SkPixmap& shape = rows ? rows->shape() : src;
+
+    std::unique_ptr<SkLimitedWStream> limitedDst;
+    if (limits) {
+        limitedDst.reset(new SkLimitedWStream(dst, limits));
+        dst = limitedDst.get();
+    }
+
+    auto ret = std::unique_ptr<SimpleBGRA8888Transformer>(new SimpleBGRA8888Transformer(shape, dst));
     
-    ret->chooseProc(info);
+    if (!ret->chooseTransform(info)) {
+        return nullptr;
+    }
+    if (rows) {
+        ret->setOrientedRows(std::move(rows));
+    }
+    ret->setLimits(limits);
+    ret->fLimitedDst = std::move(limitedDst);
     
     return ret;
 }
 
 SimpleBGRA8888Transformer::SimpleBGRA8888Transformer(const SkPixmap& src, SkWStream* dst)
-    : INHERITED(src, 4 * src.width())
+    : INHERITED(src, 4 * (size_t)src.width())
     , fDst(dst)
 {}
 
-void SimpleBGRA8888Transformer::chooseProc(const SkImageInfo& info) {
-    fProc = choose_proc(info);
+bool SimpleBGRA8888Transformer::chooseTransform(const SkImageInfo& info) {
+    fTransform = SkChooseRowTransform(info, SkRowDst::kBGRA_8888);
+    fConvertColorSpace = init_xform(&fXform, info);
+    return fTransform != nullptr;
 }
 
 SimpleBGRA8888Transformer::~SimpleBGRA8888Transformer() {}
 
 bool SimpleBGRA8888Transformer::onEncodeRows(int numRows) {
-    const void* srcRow = fSrc.addr(0, fCurrRow);
     for (int y = 0; y < numRows; y++) {
+        if (!this->checkLimits()) {
+            return false;
+        }
+
+        const void* srcRow = this->rowAddr(fCurrRow + y);
         sk_msan_assert_initialized(srcRow,
-                                   (const uint8_t*)srcRow + (fSrc.width() << fSrc.shiftPerPixel()));
-        fProc((char*)fStorage.get(),
-                            (const char*)srcRow,
-                            fSrc.width(),
-                            SkColorTypeBytesPerPixel(fSrc.colorType()));
+                                   (const uint8_t*)srcRow + fSrc.info().minRowBytes());
 
-        if (!fDst->write(fStorage.get(), 4 * fSrc.width())) {
-            perror("simple_bgra_8888_transformer: cannot write to stream");
+        // Unpremultiplied BGRA rows are already in the output format.
+        const void* dstRow = srcRow;
+        if (fConvertColorSpace) {
+            fXform((char*)fStorage.get(), (const char*)srcRow, fSrc.width());
+            dstRow = fStorage.get();
+        } else if (!fTransform->fIsCopy) {
+            (*fTransform)((char*)fStorage.get(), 4 * (size_t)fSrc.width(),
+                          (const char*)srcRow, fSrc.info().minRowBytes(),
+                          fSrc.width(), 1);
+            dstRow = fStorage.get();
         }
 
-        srcRow = SkTAddOffset<const void>(srcRow, fSrc.rowBytes());
+        if (!fDst->write(dstRow, 4 * (size_t)fSrc.width())) {
+            perror("simple_bgra_8888_transformer: cannot write to stream");
+            return false;
+        }
     }
 
     fCurrRow += numRows;
     return true;
 }
 
-bool SimpleBGRA8888Transformer::Encode(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info) {
-    auto encoder = SimpleBGRA8888Transformer::Make(src, dst, info);
-    return encoder.get() && encoder->encodeRows(src.height());
+bool SimpleBGRA8888Transformer::Encode(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info,
+                                       SkEncodeLimits* limits, SkEncodedOrigin origin) {
+    auto encoder = SimpleBGRA8888Transformer::Make(src, dst, info, limits, origin);
+    const int rows = SkEncodedOriginSwapsWidthHeight(origin) ? src.width() : src.height();
+    return encoder.get() && encoder->encodeRows(rows);
+}
+
+bool SimpleBGRA8888Transformer::EncodeParallel(const SkPixmap& src, void* dst, const SkImageInfo& info,
+                                               int maxBands, SkEncodeLimits* limits,
+                                               SkExecutor& executor) {
+    if (!SkPixmapIsValid(src)) {
+        return false;
+    }
+
+    const size_t dstRowBytes = 4 * (size_t)src.width();
+    if (limits && !limits->checkOutput(dstRowBytes * src.height())) {
+        return false;
+    }
+
+    const SkRowTransform* transform = SkChooseRowTransform(info, SkRowDst::kBGRA_8888);
+    if (!transform) {
+        return false;
+    }
+
+    SkColorSpaceXformRow xform;
+    const bool convert = init_xform(&xform, info);
+    const int bands = std::max(1, std::min(maxBands, src.height() / kMinRowsPerBand));
+    const int rowsPerBand = (src.height() + bands - 1) / bands;
+    const int rowsPerRun = std::max(1, kRunPixels / src.width());
+
+    auto transformBand = [&](int band) {
+        const int top = band * rowsPerBand;
+        const int bottom = std::min(src.height(), top + rowsPerBand);
+
+        for (int y = top; y < bottom; y += rowsPerRun) {
+            if (limits && !limits->check()) {
+                return;
+            }
+
+            const int rows = std::min(rowsPerRun, bottom - y);
+            const char* srcRows = (const char*)src.addr(0, y);
+            char* dstRows = (char*)dst + y * dstRowBytes;
+            for (int i = 0; i < rows; i++) {
+                const char* srcRow = srcRows + i * src.rowBytes();
+                sk_msan_assert_initialized(srcRow, srcRow + src.info().minRowBytes());
+                if (convert) {
+                    xform(dstRows + i * dstRowBytes, srcRow, src.width());
+                }
+            }
+            if (!convert) {
+                (*transform)(dstRows, dstRowBytes, srcRows, src.rowBytes(), src.width(), rows);
+            }
+        }
+    };
+
+    // The calling thread transforms the first band itself while the executor takes the rest.
+    SkTaskGroup group(executor);
+    group.batch(bands - 1, [&](int band) { transformBand(band + 1); });
+    transformBand(0);
+    group.wait();
+
+    return !limits || limits->result() == SkEncodeLimits::Result::kOk;
 }
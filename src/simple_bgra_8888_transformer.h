@@ -5,7 +5,11 @@
 #include <sk_pixmap.h>
 #include <sk_stream.h>
 #include <sk_encoder.h>
-#include <sk_image_encoder_fns.h>
+#include <sk_encode_limits.h>
+#include <sk_encoded_origin.h>
+#include <sk_executor.h>
+#include <sk_row_transform.h>
+#include <sk_color_space_xform_row.h>
 
 class SimpleBGRA8888Transformer : public SkEncoder {
 public:
@@ -13,13 +17,39 @@ public:
      *  Encode the |src| pixels to the |dst| stream.
      *  |options| may be used to control the encoding behavior.
      *
+     *  If |limits| is non-null, the encode fails once they are exceeded.
+     *
+     *  |origin| flips or rotates the pixels as they are written; the 90 degree rotations
+     *  swap the output width and height.
+     *
+     *  Raw BGRA has nowhere to record a color space, so when |info| has one other than
+     *  sRGB the pixels are converted to sRGB as they are written.  Alpha keeps the src
+     *  alpha type.
+     *
      *  Returns true on success.  Returns false on an invalid or unsupported |src|.
      */
-    static bool Encode(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info);
+    static bool Encode(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info,
+                       SkEncodeLimits* limits = nullptr,
+                       SkEncodedOrigin origin = kTopLeft_SkEncodedOrigin);
+
+    /**
+     *  Encode the |src| pixels straight into |dst|, which must hold 4 * width * height bytes.
+     *  The rows are split into up to |maxBands| bands, each writing into its own slice of
+     *  |dst| without going through a stream.  The calling thread transforms the first band
+     *  while the others are transformed concurrently on |executor|.
+     *
+     *  Returns true on success.  Returns false on an invalid or unsupported |src|, or once
+     *  |limits| are exceeded.
+     */
+    static bool EncodeParallel(const SkPixmap& src, void* dst, const SkImageInfo& info,
+                               int maxBands, SkEncodeLimits* limits = nullptr,
+                               SkExecutor& executor = SkExecutor::GetDefault());
 
-    static std::unique_ptr<SkEncoder> Make(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info);
+    static std::unique_ptr<SkEncoder> Make(const SkPixmap& src, SkWStream* dst, const SkImageInfo& info,
+                                           SkEncodeLimits* limits = nullptr,
+                                           SkEncodedOrigin origin = kTopLeft_SkEncodedOrigin);
 
-    void chooseProc(const SkImageInfo& srcInfo);
+    bool chooseTransform(const SkImageInfo& srcInfo);
 
     ~SimpleBGRA8888Transformer() override;
 
@@ -31,6 +61,9 @@ protected:
     typedef SkEncoder INHERITED;
 
 private:
-    transform_scanline_proc fProc;
+    const SkRowTransform* fTransform = nullptr;
+    SkColorSpaceXformRow fXform;
+    bool fConvertColorSpace = false;
     SkWStream *fDst;
+    std::unique_ptr<SkLimitedWStream> fLimitedDst;
 };
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include <math.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include <zlib.h>
+
+#include <sk_color_space.h>
+
+// Transfer functions and gamuts as Skia names them.
+static constexpr skcms_TransferFunction kSRGBTransferFn =
+    { 2.4f, (float)(1 / 1.055), (float)(0.055 / 1.055), (float)(1 / 12.92), 0.04045f, 0.0f, 0.0f };
+static constexpr skcms_TransferFunction k2Dot2TransferFn = { 2.2f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+static constexpr skcms_Matrix3x3 kSRGBGamut = {{
+    { 0x6FA2 / 65536.0f, 0x6299 / 65536.0f, 0x24A0 / 65536.0f },
+    { 0x38F5 / 65536.0f, 0xB785 / 65536.0f, 0x0F84 / 65536.0f },
+    { 0x0390 / 65536.0f, 0x18DA / 65536.0f, 0xB6CF / 65536.0f },
+}};
+static constexpr skcms_Matrix3x3 kDisplayP3Gamut = {{
+    {  0.515102f,   0.291965f,  0.157153f  },
+    {  0.241182f,   0.692236f,  0.0665819f },
+    { -0.00104941f, 0.0418818f, 0.784378f  },
+}};
+static constexpr skcms_Matrix3x3 kAdobeRGBGamut = {{
+    { 0x9C18 / 65536.0f, 0x348D / 65536.0f, 0x2631 / 65536.0f },
+    { 0x4FA5 / 65536.0f, 0xA02C / 65536.0f, 0x102F / 65536.0f },
+    { 0x0004 / 65536.0f, 0x0F95 / 65536.0f, 0xBE9C / 65536.0f },
+}};
+
+// png iCCP keyword; any name will do.
+static const char kICCPKeyword[] = "Skia";
+
+std::shared_ptr<SkColorSpace> SkColorSpace::MakeSRGB() {
+    static const std::shared_ptr<SkColorSpace> cs(
+            new SkColorSpace(kSRGBTransferFn, kSRGBGamut, "sRGB"));
+    return cs;
+}
+
+std::shared_ptr<SkColorSpace> SkColorSpace::MakeDisplayP3() {
+    static const std::shared_ptr<SkColorSpace> cs(
+            new SkColorSpace(kSRGBTransferFn, kDisplayP3Gamut, "Display P3"));
+    return cs;
+}
+
+std::shared_ptr<SkColorSpace> SkColorSpace::MakeAdobeRGB() {
+    static const std::shared_ptr<SkColorSpace> cs(
+            new SkColorSpace(k2Dot2TransferFn, kAdobeRGBGamut, "Adobe RGB (1998)"));
+    return cs;
+}
+
+std::shared_ptr<SkColorSpace> SkColorSpace::MakeRGB(const skcms_TransferFunction& transferFn,
+                                                    const skcms_Matrix3x3& toXYZD50) {
+    std::shared_ptr<SkColorSpace> cs(new SkColorSpace(transferFn, toXYZD50, "RGB"));
+    return cs->isSRGB() ? MakeSRGB() : cs;
+}
+
+std::shared_ptr<SkColorSpace> SkColorSpace::MakeICC(const void* data, size_t size) {
+    if (!data || size == 0) {
+        return nullptr;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    std::shared_ptr<SkColorSpace> cs(new SkColorSpace(std::vector<uint8_t>(bytes, bytes + size)));
+    if (!skcms_Parse(cs->fICC.data(), cs->fICC.size(), &cs->fProfile)) {
+        return nullptr;
+    }
+    return cs;
+}
+
+SkColorSpace::SkColorSpace(const skcms_TransferFunction& transferFn,
+                           const skcms_Matrix3x3& toXYZD50, const char* description)
+    : fDescription(description)
+    , fTransferFn(transferFn)
+    , fToXYZD50(toXYZD50)
+{
+    skcms_Init(&fProfile);
+    skcms_SetTransferFunction(&fProfile, &fTransferFn);
+    skcms_SetXYZD50(&fProfile, &fToXYZD50);
+}
+
+SkColorSpace::SkColorSpace(std::vector<uint8_t> icc)
+    : fICC(std::move(icc))
+    , fDescription(nullptr)
+    , fTransferFn()
+    , fToXYZD50()
+{
+    skcms_Init(&fProfile);
+}
+
+bool SkColorSpace::isSRGB() const {
+    return skcms_ApproximatelyEqualProfiles(&fProfile, skcms_sRGB_profile());
+}
+
+namespace {
+// Big-endian writer for the handful of ICC structures a matrix/curve profile needs.
+class ICCWriter {
+public:
+    void u16(uint16_t v) { fBytes.push_back(v >> 8); fBytes.push_back(v & 0xFF); }
+    void u32(uint32_t v) { this->u16(v >> 16); this->u16(v & 0xFFFF); }
+    void sig(const char s[4]) { fBytes.insert(fBytes.end(), s, s + 4); }
+    void s15Fixed16(float v) { this->u32((uint32_t)(int32_t)lrintf(v * 65536.0f)); }
+    void zeros(size_t n) { fBytes.insert(fBytes.end(), n, 0); }
+    void align() { this->zeros((4 - fBytes.size() % 4) % 4); }
+
+    void setU32(size_t offset, uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            fBytes[offset + i] = (uint8_t)(v >> (24 - 8 * i));
+        }
+    }
+
+    size_t size() const { return fBytes.size(); }
+    std::vector<uint8_t>& bytes() { return fBytes; }
+
+private:
+    std::vector<uint8_t> fBytes;
+};
+}
+
+static void write_mluc(ICCWriter& w, const char* text) {
+    const size_t length = strlen(text);
+    w.sig("mluc");
+    w.zeros(4);
+    w.u32(1);
+    w.u32(12);
+    w.sig("enUS");
+    w.u32((uint32_t)(2 * length));
+    w.u32(28);
+    for (size_t i = 0; i < length; i++) {
+        w.u16((uint8_t)text[i]);
+    }
+}
+
+static void write_xyz(ICCWriter& w, float x, float y, float z) {
+    w.sig("XYZ ");
+    w.zeros(4);
+    w.s15Fixed16(x);
+    w.s15Fixed16(y);
+    w.s15Fixed16(z);
+}
+
+static void write_para(ICCWriter& w, const skcms_TransferFunction& fn) {
+    const bool linearSegmentOffsets = fn.e != 0 || fn.f != 0;
+    w.sig("para");
+    w.zeros(4);
+    w.u16(linearSegmentOffsets ? 4 : 3);
+    w.zeros(2);
+    for (float v : { fn.g, fn.a, fn.b, fn.c, fn.d }) {
+        w.s15Fixed16(v);
+    }
+    if (linearSegmentOffsets) {
+        w.s15Fixed16(fn.e);
+        w.s15Fixed16(fn.f);
+    }
+}
+
+// Serializes a version 4 display profile with one curve shared by all three channels.
+static std::vector<uint8_t> write_icc_profile(const skcms_TransferFunction& fn,
+                                              const skcms_Matrix3x3& toXYZD50,
+                                              const char* description) {
+    static const float kD50[3] = { 0.9642f, 1.0f, 0.8249f };
+    static const char* const kTags[] = {
+        "desc", "cprt", "wtpt", "rXYZ", "gXYZ", "bXYZ", "rTRC", "gTRC", "bTRC",
+    };
+    constexpr uint32_t kTagCount = sizeof(kTags) / sizeof(kTags[0]);
+
+    ICCWriter w;
+    w.u32(0);                   // size, patched below
+    w.zeros(4);                 // preferred CMM
+    w.u32(0x04300000);          // version 4.3
+    w.sig("mntr");
+    w.sig("RGB ");
+    w.sig("XYZ ");
+    w.u16(2016); w.u16(1); w.u16(1); w.zeros(6);
+    w.sig("acsp");
+    w.zeros(4 + 4 + 4 + 4 + 8); // platform, flags, manufacturer, model, attributes
+    w.u32(0);                   // perceptual intent
+    for (float v : kD50) {
+        w.s15Fixed16(v);
+    }
+    w.zeros(4 + 16 + 28);       // creator, profile ID, reserved
+
+    w.u32(kTagCount);
+    const size_t table = w.size();
+    w.zeros(12 * kTagCount);
+
+    size_t curveOffset = 0, curveSize = 0;
+    for (uint32_t i = 0; i < kTagCount; i++) {
+        const size_t start = w.size();
+        switch (i) {
+            case 0: write_mluc(w, description); break;
+            case 1: write_mluc(w, "No copyright, use freely"); break;
+            case 2: write_xyz(w, kD50[0], kD50[1], kD50[2]); break;
+            case 3:
+            case 4:
+            case 5: {
+                const int c = i - 3;
+                write_xyz(w, toXYZD50.vals[0][c], toXYZD50.vals[1][c], toXYZD50.vals[2][c]);
+                break;
+            }
+            case 6:
+                write_para(w, fn);
+                curveOffset = start;
+                curveSize = w.size() - start;
+                break;
+            default:
+                break;
+        }
+
+        // The channels share one curve.
+        const bool sharedCurve = i > 6;
+        const size_t offset = sharedCurve ? curveOffset : start;
+        const size_t size = sharedCurve ? curveSize : w.size() - start;
+
+        w.bytes()[table + 12 * i + 0] = kTags[i][0];
+        w.bytes()[table + 12 * i + 1] = kTags[i][1];
+        w.bytes()[table + 12 * i + 2] = kTags[i][2];
+        w.bytes()[table + 12 * i + 3] = kTags[i][3];
+        w.setU32(table + 12 * i + 4, (uint32_t)offset);
+        w.setU32(table + 12 * i + 8, (uint32_t)size);
+        w.align();
+    }
+
+    w.setU32(0, (uint32_t)w.size());
+    return std::move(w.bytes());
+}
+
+const std::vector<uint8_t>& SkColorSpace::iccpChunk() const {
+    std::call_once(fICCPOnce, [this] {
+        std::vector<uint8_t> icc = fICC;
+        if (icc.empty()) {
+            icc = write_icc_profile(fTransferFn, fToXYZD50, fDescription);
+        }
+
+        // Keyword, its terminator and the compression method, then the zlib stream.
+        const size_t header = sizeof(kICCPKeyword) + 1;
+        uLongf compressedSize = compressBound(icc.size());
+        fICCP.resize(header + compressedSize);
+        memcpy(fICCP.data(), kICCPKeyword, sizeof(kICCPKeyword));
+        fICCP[sizeof(kICCPKeyword)] = 0;
+        if (compress2(fICCP.data() + header, &compressedSize, icc.data(), icc.size(),
+                      Z_BEST_COMPRESSION) != Z_OK) {
+            fICCP.clear();
+            return;
+        }
+        fICCP.resize(header + compressedSize);
+    });
+    return fICCP;
+}
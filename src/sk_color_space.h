@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <skcms.h>
+
+/**
+ *  SkColorSpace describes the range and linearity of the colors in an image: a transfer
+ *  function and the primaries' mapping to XYZ D50, or an arbitrary ICC profile.  Color
+ *  spaces are immutable and shared; the named spaces are singletons, so anything cached on
+ *  them is built once per process.
+ */
+class SkColorSpace {
+public:
+    static std::shared_ptr<SkColorSpace> MakeSRGB();
+    static std::shared_ptr<SkColorSpace> MakeDisplayP3();
+    static std::shared_ptr<SkColorSpace> MakeAdobeRGB();
+
+    /**
+     *  Creates a color space from a transfer function and a gamut, |toXYZD50| mapping linear
+     *  RGB to XYZ D50.  Returns the sRGB singleton for sRGB.
+     */
+    static std::shared_ptr<SkColorSpace> MakeRGB(const skcms_TransferFunction& transferFn,
+                                                 const skcms_Matrix3x3& toXYZD50);
+
+    /**
+     *  Creates a color space from the ICC profile in |data|, which is copied so it can be
+     *  embedded in encoded images as it is.  Returns nullptr if it does not parse.
+     */
+    static std::shared_ptr<SkColorSpace> MakeICC(const void* data, size_t size);
+
+    const skcms_ICCProfile& profile() const { return fProfile; }
+
+    bool isSRGB() const;
+
+    /**
+     *  Returns the payload of a png iCCP chunk describing this color space: a keyword, the
+     *  compression method and the deflated ICC profile.  It is built on first use and kept,
+     *  so encoders embed the profile without compressing it again.  Empty if the profile
+     *  cannot be serialized.
+     */
+    const std::vector<uint8_t>& iccpChunk() const;
+
+private:
+    SkColorSpace(const skcms_TransferFunction& transferFn, const skcms_Matrix3x3& toXYZD50,
+                 const char* description);
+    SkColorSpace(std::vector<uint8_t> icc);
+
+    // Parsed from, or describing, |fICC| when it is set.
+    skcms_ICCProfile             fProfile;
+    std::vector<uint8_t>         fICC;
+    const char*                  fDescription;
+    skcms_TransferFunction       fTransferFn;
+    skcms_Matrix3x3              fToXYZD50;
+
+    mutable std::once_flag       fICCPOnce;
+    mutable std::vector<uint8_t> fICCP;
+};
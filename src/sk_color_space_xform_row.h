@@ -0,0 +1,60 @@
+#pragma once
+
+#include <sk_color_space.h>
+#include <sk_image_info.h>
+
+#include <skcms.h>
+
+/**
+ *  Converts rows from their own color space to sRGB in the same skcms call that
+ *  unpremultiplies and swizzles them for an encoder, so a wide-gamut source costs no pass
+ *  over the image beyond the one the encoder already makes.
+ */
+class SkColorSpaceXformRow {
+public:
+    /**
+     *  Prepares to convert rows described by |src| into |dstFmt| pixels with |dstAlpha|.
+     *  Returns false, leaving the rows to the encoder's usual proc, when |src| has no color
+     *  space, is already sRGB, or has a single channel.
+     */
+    bool init(const SkImageInfo& src, skcms_PixelFormat dstFmt, skcms_AlphaFormat dstAlpha) {
+        if (!src.colorSpace() || src.colorSpace()->isSRGB()) {
+            return false;
+        }
+
+        switch (src.colorType()) {
+            case kRGBA_8888_SkColorType: fSrcFmt = skcms_PixelFormat_RGBA_8888; break;
+            case kBGRA_8888_SkColorType: fSrcFmt = skcms_PixelFormat_BGRA_8888; break;
+            case kRGB_565_SkColorType:   fSrcFmt = skcms_PixelFormat_BGR_565;   break;
+            case kRGBA_F16_SkColorType:  fSrcFmt = skcms_PixelFormat_RGBA_hhhh; break;
+            default:
+                return false;
+        }
+
+        switch (src.alphaType()) {
+            case kPremul_SkAlphaType:   fSrcAlpha = skcms_AlphaFormat_PremulAsEncoded; break;
+            case kUnpremul_SkAlphaType: fSrcAlpha = skcms_AlphaFormat_Unpremul;        break;
+            default:                    fSrcAlpha = skcms_AlphaFormat_Opaque;          break;
+        }
+        if (SkColorTypeIsAlwaysOpaque(src.colorType())) {
+            fSrcAlpha = skcms_AlphaFormat_Opaque;
+        }
+
+        fSrcProfile = &src.colorSpace()->profile();
+        fDstFmt = dstFmt;
+        fDstAlpha = dstAlpha;
+        return true;
+    }
+
+    void operator()(char* dst, const char* src, int width) const {
+        skcms_Transform(src, fSrcFmt, fSrcAlpha, fSrcProfile,
+                        dst, fDstFmt, fDstAlpha, skcms_sRGB_profile(), width);
+    }
+
+private:
+    skcms_PixelFormat       fSrcFmt;
+    skcms_AlphaFormat       fSrcAlpha;
+    const skcms_ICCProfile* fSrcProfile = nullptr;
+    skcms_PixelFormat       fDstFmt;
+    skcms_AlphaFormat       fDstAlpha;
+};
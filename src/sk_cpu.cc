@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <sk_cpu.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+    #include <asm/hwcap.h>
+    #include <sys/auxv.h>
+#endif
+
+namespace {
+struct CpuVariant {
+    const char* fName;
+    uint32_t    fFeatures;
+};
+}
+
+// Best first; each variant's kernels may use every feature it lists.
+static const CpuVariant kVariants[] = {
+    { "avx2",   SkCpu::AVX2 | SkCpu::SSSE3 | SkCpu::SSE2 },
+    { "ssse3",  SkCpu::SSSE3 | SkCpu::SSE2 },
+    { "sse2",   SkCpu::SSE2 },
+    { "neon",   SkCpu::NEON },
+    { "scalar", 0 },
+};
+
+static uint32_t detect_features() {
+    uint32_t features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        features |= SkCpu::SSE2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        features |= SkCpu::SSSE3;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+        features |= SkCpu::AVX2;
+    }
+#elif defined(__aarch64__) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+        features |= SkCpu::NEON;
+    }
+#elif defined(__aarch64__)
+    // Advanced SIMD is part of every AArch64 core.
+    features |= SkCpu::NEON;
+#endif
+    return features;
+}
+
+uint32_t SkCpu::ReadFeatures() {
+    uint32_t features = detect_features();
+
+    if (const char* cap = getenv("SKBITMAP_TO_PNG_CPU")) {
+        for (const CpuVariant& variant : kVariants) {
+            if (strcmp(cap, variant.fName) == 0) {
+                features &= variant.fFeatures;
+                break;
+            }
+        }
+    }
+    return features;
+}
+
+const char* SkCpu::Variant() {
+    for (const CpuVariant& variant : kVariants) {
+        if (variant.fFeatures && Supports(variant.fFeatures)) {
+            return variant.fName;
+        }
+    }
+    return "scalar";
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ *  The instruction set extensions the pixel kernels and the fast png engine's filter and
+ *  deflate kernels have variants for, detected once per process from CPUID on x86 and from the
+ *  HWCAP auxiliary vector on ARM, so one build runs the best variant each host supports.
+ *
+ *  Setting SKBITMAP_TO_PNG_CPU to a variant name ("avx2", "ssse3", "sse2", "neon" or "scalar")
+ *  before the first encode caps the kernels at that variant, to compare variants on one host or
+ *  to rule one out.  Features the host lacks are never enabled.
+ */
+struct SkCpu {
+    enum {
+        SSE2  = 1 << 0,
+        SSSE3 = 1 << 1,
+        AVX2  = 1 << 2,  // Only reported together with F16C, which the AVX2 kernels also use.
+        NEON  = 1 << 3,
+    };
+
+    static bool Supports(uint32_t mask) { return (Features() & mask) == mask; }
+
+    /**
+     *  The name of the best variant in use, one of the names SKBITMAP_TO_PNG_CPU accepts.
+     */
+    static const char* Variant();
+
+private:
+    static uint32_t Features() {
+        static const uint32_t features = ReadFeatures();
+        return features;
+    }
+
+    static uint32_t ReadFeatures();
+};
@@ -0,0 +1,39 @@
+#include <sk_encode_limits.h>
+
+// Keeps the first reason recorded, whichever thread saw it.
+static void fail(std::atomic<SkEncodeLimits::Result>* result, SkEncodeLimits::Result reason) {
+    auto expected = SkEncodeLimits::Result::kOk;
+    result->compare_exchange_strong(expected, reason);
+}
+
+bool SkEncodeLimits::check() {
+    if (fResult.load(std::memory_order_relaxed) != Result::kOk) {
+        return false;
+    }
+
+    if (fCancel && fCancel->load(std::memory_order_relaxed)) {
+        fail(&fResult, Result::kCancelled);
+        return false;
+    }
+
+    if (fDeadline != Clock::time_point::max() && Clock::now() >= fDeadline) {
+        fail(&fResult, Result::kDeadlineExceeded);
+        return false;
+    }
+
+    return true;
+}
+
+bool SkEncodeLimits::checkOutput(size_t totalBytes) {
+    if (fMaxOutputBytes != 0 && totalBytes > fMaxOutputBytes) {
+        fail(&fResult, Result::kOutputTooLarge);
+    }
+    return this->check();
+}
+
+bool SkLimitedWStream::write(const void* buffer, size_t size) {
+    if (!fLimits->checkOutput(fDst->bytesWritten() + size)) {
+        return false;
+    }
+    return fDst->write(buffer, size);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+
+#include <sk_stream.h>
+
+/**
+ *  Limits an encode is allowed to run under. Encoders check them between rows,
+ *  and SkLimitedWStream checks them on every write, which for png happens from
+ *  inside the deflate loop. Once a limit is hit the encode fails and the reason
+ *  is kept for the caller. Checks may run concurrently from several threads.
+ */
+class SkEncodeLimits {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Result {
+        kOk,
+        kDeadlineExceeded,
+        kCancelled,
+        kOutputTooLarge,
+    };
+
+    SkEncodeLimits() = default;
+    SkEncodeLimits(const SkEncodeLimits& that) { *this = that; }
+    SkEncodeLimits& operator=(const SkEncodeLimits& that) {
+        fDeadline = that.fDeadline;
+        fCancel = that.fCancel;
+        fMaxOutputBytes = that.fMaxOutputBytes;
+        fResult.store(that.fResult.load());
+        return *this;
+    }
+
+    /** Fail once |deadline| has passed. */
+    void setDeadline(Clock::time_point deadline) { fDeadline = deadline; }
+
+    /** Fail once |*cancel| becomes true. It may be set from any thread. */
+    void setCancelFlag(const std::atomic<bool>* cancel) { fCancel = cancel; }
+
+    /** Fail once more than |bytes| would be written. Zero means unlimited. */
+    void setMaxOutputBytes(size_t bytes) { fMaxOutputBytes = bytes; }
+
+    /**
+     *  Returns false, and records why, if the encode should stop.
+     */
+    bool check();
+
+    /**
+     *  Same as check(), and also fails if the output would grow to |totalBytes|.
+     */
+    bool checkOutput(size_t totalBytes);
+
+    Result result() const { return fResult.load(); }
+
+private:
+    Clock::time_point        fDeadline = Clock::time_point::max();
+    const std::atomic<bool>* fCancel = nullptr;
+    size_t                   fMaxOutputBytes = 0;
+    std::atomic<Result>      fResult{Result::kOk};
+};
+
+/**
+ *  Forwards writes to another stream while enforcing SkEncodeLimits.
+ *  Neither |dst| nor |limits| is owned.
+ */
+class SkLimitedWStream : public SkWStream {
+public:
+    SkLimitedWStream(SkWStream* dst, SkEncodeLimits* limits)
+        : fDst(dst)
+        , fLimits(limits)
+    {}
+
+    bool write(const void* buffer, size_t size) override;
+    void flush() override { fDst->flush(); }
+    size_t bytesWritten() const override { return fDst->bytesWritten(); }
+
+private:
+    SkWStream*      fDst;
+    SkEncodeLimits* fLimits;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <sk_rect.h>
+
+// These values match the orientation www.exif.org/Exif2-2.PDF.
+enum SkEncodedOrigin {
+    kTopLeft_SkEncodedOrigin     = 1, // Default
+    kTopRight_SkEncodedOrigin    = 2, // Reflected across y-axis
+    kBottomRight_SkEncodedOrigin = 3, // Rotated 180
+    kBottomLeft_SkEncodedOrigin  = 4, // Reflected across x-axis
+    kLeftTop_SkEncodedOrigin     = 5, // Reflected across x-axis, Rotated 90 CCW
+    kRightTop_SkEncodedOrigin    = 6, // Rotated 90 CW
+    kRightBottom_SkEncodedOrigin = 7, // Reflected across x-axis, Rotated 90 CW
+    kLeftBottom_SkEncodedOrigin  = 8, // Rotated 90 CCW
+    kDefault_SkEncodedOrigin     = kTopLeft_SkEncodedOrigin,
+    kLast_SkEncodedOrigin        = kLeftBottom_SkEncodedOrigin,
+};
+
+/**
+ * Return true if the encoded origin includes a 90 degree rotation, in which case the width
+ * and height of the source data are swapped relative to a correctly oriented destination.
+ */
+static inline bool SkEncodedOriginSwapsWidthHeight(SkEncodedOrigin origin) {
+    return origin >= kLeftTop_SkEncodedOrigin;
+}
+
+/**
+ * Return where |rect| of a |w| x |h| source lands once the source is drawn with |origin|,
+ * in the coordinates of the correctly oriented destination.
+ */
+static inline SkIRect SkEncodedOriginMapRect(SkEncodedOrigin origin, int w, int h,
+                                             const SkIRect& rect) {
+    switch (origin) {
+        case kTopRight_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(w - rect.fRight, rect.fTop, w - rect.fLeft, rect.fBottom);
+        case kBottomRight_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(w - rect.fRight, h - rect.fBottom,
+                                     w - rect.fLeft, h - rect.fTop);
+        case kBottomLeft_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(rect.fLeft, h - rect.fBottom, rect.fRight, h - rect.fTop);
+        case kLeftTop_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(rect.fTop, rect.fLeft, rect.fBottom, rect.fRight);
+        case kRightTop_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(h - rect.fBottom, rect.fLeft, h - rect.fTop, rect.fRight);
+        case kRightBottom_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(h - rect.fBottom, w - rect.fRight,
+                                     h - rect.fTop, w - rect.fLeft);
+        case kLeftBottom_SkEncodedOrigin:
+            return SkIRect::MakeLTRB(rect.fTop, w - rect.fRight, rect.fBottom, w - rect.fLeft);
+        default:
+            return rect;
+    }
+}
@@ -1,5 +1,7 @@
 #include <cassert>
 
+#include <algorithm>
+
 #include <sk_encoder.h>
 
 bool SkEncoder::encodeRows(int numRows) {
@@ -8,7 +10,17 @@ bool SkEncoder::encodeRows(int numRows) {
         return false;
     }
 
-    if (fCurrRow + numRows > fSrc.height()) {
+    // Encoders made without pixels only accept rows through encodeRows(const SkPixmap&).
+    if (!fBand && !fOrientedRows && !fSrc.addr()) {
+        return false;
+    }
+
+    if (!this->checkLimits()) {
+        fCurrRow = fSrc.height();
+        return false;
+    }
+
+    if (numRows > fSrc.height() - fCurrRow) {
         numRows = fSrc.height() - fCurrRow;
     }
 
@@ -19,4 +31,53 @@ bool SkEncoder::encodeRows(int numRows) {
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool SkEncoder::encodeRows(const SkPixmap& rows) {
+    if (!rows.addr() || rows.height() <= 0 || rows.width() != fSrc.width() ||
+        rows.colorType() != fSrc.colorType() || rows.rowBytes() < rows.info().minRowBytes64()) {
+        return false;
+    }
+
+    fBand = &rows;
+    fBandTop = fCurrRow;
+    bool success = this->encodeRows(rows.height());
+    fBand = nullptr;
+    return success;
+}
+
+// Bytes read from a stream per band handed to the encoder.
+static constexpr size_t kStreamBandBytes = 256 * 1024;
+
+bool SkEncoder::encodeRows(SkStream* src, int numRows, size_t rowBytes) {
+    const SkImageInfo& info = fSrc.info();
+    if (!src || numRows <= 0 || numRows > fSrc.height() - fCurrRow ||
+        !info.validRowBytes(rowBytes)) {
+        return false;
+    }
+
+    const int bandRows = (int)std::min<size_t>(numRows,
+                                               std::max<size_t>(1, kStreamBandBytes / rowBytes));
+    SkAutoTMalloc<uint8_t> storage(bandRows * rowBytes);
+
+    for (int done = 0; done < numRows;) {
+        const int rows = std::min(bandRows, numRows - done);
+        size_t bytes = rows * rowBytes;
+        if (fCurrRow + rows == fSrc.height()) {
+            bytes -= rowBytes - info.minRowBytes();
+        }
+
+        if (src->read(storage.get(), bytes) != bytes) {
+            fCurrRow = fSrc.height();
+            return false;
+        }
+
+        SkPixmap band(info.makeWH(info.width(), rows), storage.get(), rowBytes);
+        if (!this->encodeRows(band)) {
+            return false;
+        }
+        done += rows;
+    }
+
+    return true;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <memory>
+
+#include <sk_encode_limits.h>
+#include <sk_oriented_rows.h>
 #include <sk_pixmap.h>
+#include <sk_stream.h>
 #include <sk_templates_private.h>
 
 class SkEncoder {
@@ -10,9 +15,37 @@ public:
      *  Encode |numRows| rows of input.  If the caller requests more rows than are remaining
      *  in the src, this will encode all of the remaining rows.  |numRows| must be greater
      *  than zero.
+     *
+     *  An encoder may spend a call reading ahead in the src instead, and encode fewer rows
+     *  or none; rowsEncoded() tells how many are done.
      */
     bool encodeRows(int numRows);
 
+    /**
+     *  Rows encoded so far.
+     */
+    int rowsEncoded() const { return fCurrRow; }
+
+    /**
+     *  Encode the rows of |rows| as the next rows of the image, for callers that produce the
+     *  image a band at a time.  |rows| must match the width and color type of the src; its
+     *  pixels are only read during this call.  Rows past the end of the image are ignored.
+     */
+    bool encodeRows(const SkPixmap& rows);
+
+    /**
+     *  Encode the next |numRows| rows, read from |src| as rows |rowBytes| apart; the last row
+     *  of the image need not be padded.  Rows are read a band of a few hundred kilobytes at a
+     *  time, so memory use does not grow with the image.  Fails if |src| ends early.
+     */
+    bool encodeRows(SkStream* src, int numRows, size_t rowBytes);
+
+    /**
+     *  Stop encoding once |limits| are exceeded; they are checked before every row.
+     *  |limits| is unowned and may be nullptr.
+     */
+    void setLimits(SkEncodeLimits* limits) { fLimits = limits; }
+
     virtual ~SkEncoder() {}
 
 protected:
@@ -23,9 +56,52 @@ protected:
         : fSrc(src)
         , fCurrRow(0)
         , fStorage(storageBytes)
+        , fLimits(nullptr)
+        , fBand(nullptr)
+        , fBandTop(0)
     {}
 
+    /**
+     *  Reads src rows through |rows|, whose shape() must be the src.  Rows must then be
+     *  requested in order.
+     */
+    void setOrientedRows(std::unique_ptr<SkOrientedRows> rows) {
+        fOrientedRows = std::move(rows);
+    }
+
+    /**
+     *  Returns the address of src row |y|, taken from the band being encoded by
+     *  encodeRows(const SkPixmap&) when there is one.
+     */
+    const void* rowAddr(int y) {
+        if (fBand) {
+            return fBand->addr(0, y - fBandTop);
+        }
+        return fOrientedRows ? fOrientedRows->row(y) : fSrc.addr(0, y);
+    }
+
+    /**
+     *  Returns how far apart consecutive src rows are when every rowAddr(y + 1) is that far
+     *  past rowAddr(y), so several rows may be read starting from one address, or 0 when the
+     *  rows are produced one at a time.
+     */
+    size_t srcRowStride() const {
+        if (fOrientedRows) {
+            return 0;
+        }
+        return fBand ? fBand->rowBytes() : fSrc.rowBytes();
+    }
+
+    /**
+     *  Returns false if the encode should stop before the next row.
+     */
+    bool checkLimits() { return !fLimits || fLimits->check(); }
+
     const SkPixmap&        fSrc;
     int                    fCurrRow;
     SkAutoTMalloc<uint8_t> fStorage;
+    SkEncodeLimits*        fLimits;
+    const SkPixmap*        fBand;
+    int                    fBandTop;
+    std::unique_ptr<SkOrientedRows> fOrientedRows;
 };
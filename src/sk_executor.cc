@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sk_executor.h>
+
+SkExecutor::~SkExecutor() {}
+
+class SkThreadPool final : public SkExecutor {
+public:
+    explicit SkThreadPool(int threads) {
+        for (int i = 0; i < threads; i++) {
+            fThreads.emplace_back(&Loop, this);
+        }
+    }
+
+    ~SkThreadPool() override {
+        // Signal each thread that it's time to shut down.
+        {
+            std::lock_guard<std::mutex> lock(fWorkLock);
+            fShutdown = true;
+        }
+        fWorkAvailable.notify_all();
+
+        for (auto& thread : fThreads) {
+            thread.join();
+        }
+    }
+
+    void add(std::function<void(void)> work) override {
+        {
+            std::lock_guard<std::mutex> lock(fWorkLock);
+            fWork.push_back(std::move(work));
+        }
+        fWorkAvailable.notify_one();
+    }
+
+    void borrow() override {
+        // If there is work waiting, do it on this thread.
+        std::function<void(void)> work;
+        {
+            std::lock_guard<std::mutex> lock(fWorkLock);
+            if (fWork.empty()) {
+                return;
+            }
+            work = std::move(fWork.front());
+            fWork.pop_front();
+        }
+        work();
+    }
+
+private:
+    static void Loop(SkThreadPool* pool) {
+        for (;;) {
+            std::function<void(void)> work;
+            {
+                std::unique_lock<std::mutex> lock(pool->fWorkLock);
+                pool->fWorkAvailable.wait(lock, [pool] {
+                    return pool->fShutdown || !pool->fWork.empty();
+                });
+                if (pool->fWork.empty()) {
+                    return;  // fShutdown was set and nothing is left to do.
+                }
+                work = std::move(pool->fWork.front());
+                pool->fWork.pop_front();
+            }
+            work();
+        }
+    }
+
+    std::vector<std::thread>              fThreads;
+    std::deque<std::function<void(void)>> fWork;
+    std::mutex                            fWorkLock;
+    std::condition_variable               fWorkAvailable;
+    bool                                  fShutdown = false;
+};
+
+std::unique_ptr<SkExecutor> SkExecutor::MakeFIFOThreadPool(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    return std::unique_ptr<SkExecutor>(new SkThreadPool(threads));
+}
+
+SkExecutor& SkExecutor::GetDefault() {
+    // Intentionally leaked: worker threads may still be running at exit.
+    static SkExecutor* gDefaultExecutor = SkExecutor::MakeFIFOThreadPool().release();
+    return *gDefaultExecutor;
+}
@@ -0,0 +1,846 @@
+#include <string.h>
+
+#include <algorithm>
+
+#include <sk_cpu.h>
+#include <sk_fast_deflate.h>
+
+#include <zlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define SK_FAST_DEFLATE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define SK_FAST_DEFLATE_NEON 1
+#endif
+
+// The farthest back deflate may match, kept in front of each block of input.
+static constexpr size_t kWindowBytes = 32 * 1024;
+static constexpr size_t kBlockBytes = 128 * 1024;
+static constexpr size_t kInputBytes = kWindowBytes + kBlockBytes;
+
+static constexpr int kHashBits = 15;
+
+// Matches are only taken when four bytes agree; shorter ones rarely beat their literals.
+// Matches farther back than a pixel cost more bits for their distance, so they have to be
+// longer to pay.
+static constexpr size_t kMinMatch = 4;
+static constexpr size_t kMinFarMatch = 6;
+static constexpr size_t kMaxMatch = 258;
+
+// After this many pixels in a row without a match, each search steps over one more pixel,
+// as LZ4 does, so noise goes by without a search at every pixel.
+static constexpr int kSkipShift = 5;
+
+// Room past kOutputBytes for what is written between checks: one token, or a block header.
+static constexpr size_t kOutputSlack = 1024;
+
+static constexpr int kEndOfBlock = 256;
+static constexpr int kNumLitLen = 286;
+static constexpr int kNumDist = 30;
+static constexpr int kNumCodeLength = 19;
+
+static const uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t kDistBase[kNumDist] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t kDistExtra[kNumDist] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+// The order code length code lengths are written in.
+static const uint8_t kCodeLengthOrder[kNumCodeLength] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+static const uint8_t kCodeLengthExtra[3] = { 2, 3, 7 };
+
+namespace {
+// Length and distance codes by value, as zlib looks them up.
+struct CodeTables {
+    CodeTables() {
+        for (int c = 0; c < 29; c++) {
+            const int last = c == 28 ? 258 : kLengthBase[c + 1] - 1;
+            for (int length = kLengthBase[c]; length <= last; length++) {
+                fLengthCode[length] = (uint8_t)c;
+            }
+        }
+        for (int c = 0; c < kNumDist; c++) {
+            const int last = c == kNumDist - 1 ? 32768 : kDistBase[c + 1] - 1;
+            for (int distance = kDistBase[c]; distance <= last; distance++) {
+                if (distance <= 256) {
+                    fDistCode[distance - 1] = (uint8_t)c;
+                } else {
+                    fDistCode[256 + ((distance - 1) >> 7)] = (uint8_t)c;
+                }
+            }
+        }
+    }
+
+    int distCode(size_t distance) const {
+        return distance <= 256 ? fDistCode[distance - 1] : fDistCode[256 + ((distance - 1) >> 7)];
+    }
+
+    uint8_t fLengthCode[259];
+    uint8_t fDistCode[512];
+};
+}
+
+static const CodeTables& code_tables() {
+    static const CodeTables tables;
+    return tables;
+}
+
+static uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Returns how many of the first |limit| bytes of |a| and |b| agree.  |b| may overlap |a|.
+static size_t match_length(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t n = 0;
+    for (; n + 8 <= limit; n += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + n, 8);
+        memcpy(&y, b + n, 8);
+        if (x != y) {
+            break;
+        }
+    }
+    while (n < limit && a[n] == b[n]) {
+        n++;
+    }
+    return n;
+}
+
+#if defined(SK_FAST_DEFLATE_SSE2)
+__attribute__((target("sse2")))
+static size_t match_length_sse2(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t n = 0;
+    for (; n + 16 <= limit; n += 16) {
+        const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + n)),
+                                          _mm_loadu_si128((const __m128i*)(b + n)));
+        const unsigned differ = ~(unsigned)_mm_movemask_epi8(eq) & 0xFFFF;
+        if (differ) {
+            return n + __builtin_ctz(differ);
+        }
+    }
+    while (n < limit && a[n] == b[n]) {
+        n++;
+    }
+    return n;
+}
+#endif
+
+#if defined(SK_FAST_DEFLATE_NEON)
+static size_t match_length_neon(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t n = 0;
+    for (; n + 16 <= limit; n += 16) {
+        if (vminvq_u8(vceqq_u8(vld1q_u8(a + n), vld1q_u8(b + n))) != 0xFF) {
+            break;
+        }
+    }
+    while (n < limit && a[n] == b[n]) {
+        n++;
+    }
+    return n;
+}
+#endif
+
+// zlib's adler32 modulus, and the most bytes whose sums fit in 32 bits between reductions.
+static constexpr uint32_t kAdlerBase = 65521;
+static constexpr size_t kAdlerMaxBytes = 5552;
+
+// Updates |adler| with |size| bytes at |data|.  The vector variants sum 32 bytes at a time,
+// weighting each by its distance from the end of the run, and reduce every kAdlerMaxBytes
+// bytes; the last bytes, fewer than 32, go to zlib's adler32, which is the scalar variant.
+static uint32_t adler32_scalar(uint32_t adler, const uint8_t* data, size_t size) {
+    return (uint32_t)adler32(adler, data, (uInt)size);
+}
+
+#if defined(SK_FAST_DEFLATE_SSE2)
+__attribute__((target("ssse3")))
+static uint32_t adler32_ssse3(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    for (size_t blocks = size / 32; blocks > 0;) {
+        size_t n = std::min(blocks, kAdlerMaxBytes / 32);
+        blocks -= n;
+
+        // |prefix| sums s1 as it was before each block, which each block adds 32 times to s2.
+        __m128i prefix = _mm_cvtsi32_si128((int)(s1 * n));
+        __m128i sum2 = _mm_cvtsi32_si128((int)s2);
+        __m128i sum1 = zero;
+        do {
+            const __m128i bytes1 = _mm_loadu_si128((const __m128i*)data);
+            const __m128i bytes2 = _mm_loadu_si128((const __m128i*)(data + 16));
+            prefix = _mm_add_epi32(prefix, sum1);
+            sum1 = _mm_add_epi32(sum1, _mm_sad_epu8(bytes1, zero));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            sum1 = _mm_add_epi32(sum1, _mm_sad_epu8(bytes2, zero));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            data += 32;
+        } while (--n);
+        sum2 = _mm_add_epi32(sum2, _mm_slli_epi32(prefix, 5));
+
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + (uint32_t)_mm_cvtsi128_si32(sum1)) % kAdlerBase;
+        s2 = (uint32_t)_mm_cvtsi128_si32(sum2) % kAdlerBase;
+    }
+    return adler32_scalar(s2 << 16 | s1, data, size % 32);
+}
+
+__attribute__((target("avx2")))
+static uint32_t adler32_avx2(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                         24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9,
+                                         8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (size_t blocks = size / 32; blocks > 0;) {
+        size_t n = std::min(blocks, kAdlerMaxBytes / 32);
+        blocks -= n;
+
+        __m256i prefix = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        __m256i sum2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        __m256i sum1 = zero;
+        do {
+            const __m256i bytes = _mm256_loadu_si256((const __m256i*)data);
+            prefix = _mm256_add_epi32(prefix, sum1);
+            sum1 = _mm256_add_epi32(sum1, _mm256_sad_epu8(bytes, zero));
+            sum2 = _mm256_add_epi32(sum2,
+                                    _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, tap), ones));
+            data += 32;
+        } while (--n);
+        sum2 = _mm256_add_epi32(sum2, _mm256_slli_epi32(prefix, 5));
+
+        __m128i s1s = _mm_add_epi32(_mm256_castsi256_si128(sum1),
+                                    _mm256_extracti128_si256(sum1, 1));
+        __m128i s2s = _mm_add_epi32(_mm256_castsi256_si128(sum2),
+                                    _mm256_extracti128_si256(sum2, 1));
+        s1s = _mm_add_epi32(s1s, _mm_shuffle_epi32(s1s, _MM_SHUFFLE(2, 3, 0, 1)));
+        s1s = _mm_add_epi32(s1s, _mm_shuffle_epi32(s1s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2s = _mm_add_epi32(s2s, _mm_shuffle_epi32(s2s, _MM_SHUFFLE(2, 3, 0, 1)));
+        s2s = _mm_add_epi32(s2s, _mm_shuffle_epi32(s2s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + (uint32_t)_mm_cvtsi128_si32(s1s)) % kAdlerBase;
+        s2 = (uint32_t)_mm_cvtsi128_si32(s2s) % kAdlerBase;
+    }
+    return adler32_scalar(s2 << 16 | s1, data, size % 32);
+}
+#endif
+
+#if defined(SK_FAST_DEFLATE_NEON)
+static uint32_t adler32_neon(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    static const uint16_t kTaps[32] = {
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+    };
+
+    for (size_t blocks = size / 32; blocks > 0;) {
+        size_t n = std::min(blocks, kAdlerMaxBytes / 32);
+        blocks -= n;
+
+        // Each byte column is summed alone, and weighted by its tap once the run is over.
+        uint32x4_t prefix = vsetq_lane_u32(s1 * (uint32_t)n, vdupq_n_u32(0), 0);
+        uint32x4_t sum1 = vdupq_n_u32(0);
+        uint16x8_t columns[4] = { vdupq_n_u16(0), vdupq_n_u16(0),
+                                  vdupq_n_u16(0), vdupq_n_u16(0) };
+        do {
+            const uint8x16_t bytes1 = vld1q_u8(data);
+            const uint8x16_t bytes2 = vld1q_u8(data + 16);
+            prefix = vaddq_u32(prefix, sum1);
+            sum1 = vpadalq_u16(sum1, vpadalq_u8(vpaddlq_u8(bytes1), bytes2));
+            columns[0] = vaddw_u8(columns[0], vget_low_u8(bytes1));
+            columns[1] = vaddw_u8(columns[1], vget_high_u8(bytes1));
+            columns[2] = vaddw_u8(columns[2], vget_low_u8(bytes2));
+            columns[3] = vaddw_u8(columns[3], vget_high_u8(bytes2));
+            data += 32;
+        } while (--n);
+
+        uint32x4_t sum2 = vshlq_n_u32(prefix, 5);
+        for (int c = 0; c < 4; c++) {
+            sum2 = vmlal_u16(sum2, vget_low_u16(columns[c]), vld1_u16(kTaps + 8 * c));
+            sum2 = vmlal_u16(sum2, vget_high_u16(columns[c]), vld1_u16(kTaps + 8 * c + 4));
+        }
+        s1 = (s1 + vaddvq_u32(sum1)) % kAdlerBase;
+        s2 = (s2 + vaddvq_u32(sum2)) % kAdlerBase;
+    }
+    return adler32_scalar(s2 << 16 | s1, data, size % 32);
+}
+#endif
+
+// Up residuals of |size| bytes of |row| against |above|, copying |row| over |above| as they
+// go.  Each variant returns how many bytes it filtered; the scalar loop finishes the rest.
+#if defined(SK_FAST_DEFLATE_SSE2)
+__attribute__((target("avx2")))
+static size_t filter_up_avx2(uint8_t* row, uint8_t* above, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(row + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(above + i));
+        _mm256_storeu_si256((__m256i*)(row + i), _mm256_sub_epi8(x, b));
+        _mm256_storeu_si256((__m256i*)(above + i), x);
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t filter_up_sse2(uint8_t* row, uint8_t* above, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(above + i));
+        _mm_storeu_si128((__m128i*)(row + i), _mm_sub_epi8(x, b));
+        _mm_storeu_si128((__m128i*)(above + i), x);
+    }
+    return i;
+}
+#endif
+
+#if defined(SK_FAST_DEFLATE_NEON)
+static size_t filter_up_neon(uint8_t* row, uint8_t* above, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t x = vld1q_u8(row + i);
+        vst1q_u8(row + i, vsubq_u8(x, vld1q_u8(above + i)));
+        vst1q_u8(above + i, x);
+    }
+    return i;
+}
+#endif
+
+void SkFastDeflate::FilterUp(uint8_t* row, uint8_t* above, size_t size) {
+    size_t i = 0;
+#if defined(SK_FAST_DEFLATE_SSE2)
+    if (SkCpu::Supports(SkCpu::AVX2)) {
+        i = filter_up_avx2(row, above, size);
+    }
+    if (SkCpu::Supports(SkCpu::SSE2)) {
+        i += filter_up_sse2(row + i, above + i, size - i);
+    }
+#elif defined(SK_FAST_DEFLATE_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        i = filter_up_neon(row, above, size);
+    }
+#endif
+    for (; i < size; i++) {
+        const uint8_t x = row[i];
+        row[i] = x - above[i];
+        above[i] = x;
+    }
+}
+
+// Replaces the |n| ascending weights in |a| with the code lengths of a minimum-redundancy code
+// for them, in place; Moffat and Katajainen's algorithm.
+static void minimum_redundancy(uint32_t* a, int n) {
+    if (n < 2) {
+        if (n == 1) {
+            a[0] = 1;
+        }
+        return;
+    }
+
+    a[0] += a[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; next--) {
+        a[next] = a[a[next]] + 1;
+    }
+
+    int avail = 1, used = 0, depth = 0;
+    int next = n - 1;
+    root = n - 2;
+    while (avail > 0) {
+        while (root >= 0 && (int)a[root] == depth) {
+            used++;
+            root--;
+        }
+        while (avail > used) {
+            a[next--] = depth;
+            avail--;
+        }
+        avail = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+// Folds the codes longer than |maxBits| into it, then lengthens the shortest codes that
+// make room until the code is complete again; miniz does the same.
+static void limit_lengths(int* numCodes, int maxBits) {
+    for (int i = maxBits + 1; i <= 32; i++) {
+        numCodes[maxBits] += numCodes[i];
+        numCodes[i] = 0;
+    }
+    uint32_t total = 0;
+    for (int i = maxBits; i > 0; i--) {
+        total += (uint32_t)numCodes[i] << (maxBits - i);
+    }
+    while (total != (1u << maxBits)) {
+        numCodes[maxBits]--;
+        for (int i = maxBits - 1; i > 0; i--) {
+            if (numCodes[i]) {
+                numCodes[i]--;
+                numCodes[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+}
+
+static uint16_t reverse_bits(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return (uint16_t)reversed;
+}
+
+// Builds a canonical Huffman code of at most |maxBits| bits for the |n| symbols counted in
+// |counts|, with codes bit-reversed for writing least significant bit first.  Symbols are
+// added until two are used, which keeps the code complete for strict inflaters.
+static void build_code(uint32_t* counts, int n, int maxBits, uint8_t* lengths, uint16_t* codes) {
+    struct Entry {
+        uint32_t fCount;
+        int      fSymbol;
+    };
+    Entry sorted[kNumLitLen];
+    int used = 0;
+    for (int s = 0; s < n; s++) {
+        used += counts[s] != 0;
+    }
+    for (int s = 0; used < 2; s++) {
+        if (!counts[s]) {
+            counts[s] = 1;
+            used++;
+        }
+    }
+
+    int m = 0;
+    for (int s = 0; s < n; s++) {
+        if (counts[s]) {
+            sorted[m++] = { counts[s], s };
+        }
+    }
+    std::sort(sorted, sorted + m, [](const Entry& x, const Entry& y) {
+        return x.fCount < y.fCount || (x.fCount == y.fCount && x.fSymbol < y.fSymbol);
+    });
+
+    uint32_t depths[kNumLitLen];
+    for (int i = 0; i < m; i++) {
+        depths[i] = sorted[i].fCount;
+    }
+    minimum_redundancy(depths, m);
+
+    int numCodes[33] = {};
+    for (int i = 0; i < m; i++) {
+        numCodes[std::min<uint32_t>(depths[i], 32)]++;
+    }
+    limit_lengths(numCodes, maxBits);
+
+    // The least frequent symbols take the longest codes.
+    memset(lengths, 0, n);
+    int i = 0;
+    for (int length = maxBits; length > 0; length--) {
+        for (int c = numCodes[length]; c > 0; c--) {
+            lengths[sorted[i++].fSymbol] = (uint8_t)length;
+        }
+    }
+
+    int lengthCounts[16] = {};
+    for (int s = 0; s < n; s++) {
+        lengthCounts[lengths[s]]++;
+    }
+    lengthCounts[0] = 0;
+    uint32_t nextCode[16];
+    uint32_t code = 0;
+    for (int length = 1; length < 16; length++) {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+    for (int s = 0; s < n; s++) {
+        codes[s] = lengths[s] ? reverse_bits(nextCode[lengths[s]]++, lengths[s]) : 0;
+    }
+}
+
+/**
+ *  The Huffman codes of a dynamic block, and its code lengths as they are written.
+ */
+struct SkFastDeflate::Block {
+    int      fNumLitLen;
+    int      fNumDist;
+    uint8_t  fLitLenLengths[kNumLitLen];
+    uint16_t fLitLenCodes[kNumLitLen];
+    uint8_t  fDistLengths[kNumDist];
+    uint16_t fDistCodes[kNumDist];
+
+    // The lengths of both codes, run-length coded.
+    int      fNumSymbols;
+    uint8_t  fSymbols[kNumLitLen + kNumDist];
+    uint8_t  fSymbolExtra[kNumLitLen + kNumDist];
+
+    int      fNumCodeLengths;
+    uint8_t  fCodeLengthLengths[kNumCodeLength];
+    uint16_t fCodeLengthCodes[kNumCodeLength];
+};
+
+// Builds |block| for the symbols counted in |litLenCounts| and |distCounts| and returns how
+// many bits it takes to write.
+uint64_t SkFastDeflate::PlanDynamicBlock(uint32_t* litLenCounts, uint32_t* distCounts,
+                                         Block* block) {
+    build_code(litLenCounts, kNumLitLen, 15, block->fLitLenLengths, block->fLitLenCodes);
+    build_code(distCounts, kNumDist, 15, block->fDistLengths, block->fDistCodes);
+
+    block->fNumLitLen = kNumLitLen;
+    while (block->fNumLitLen > 257 && !block->fLitLenLengths[block->fNumLitLen - 1]) {
+        block->fNumLitLen--;
+    }
+    block->fNumDist = kNumDist;
+    while (block->fNumDist > 1 && !block->fDistLengths[block->fNumDist - 1]) {
+        block->fNumDist--;
+    }
+
+    uint8_t lengths[kNumLitLen + kNumDist];
+    memcpy(lengths, block->fLitLenLengths, block->fNumLitLen);
+    memcpy(lengths + block->fNumLitLen, block->fDistLengths, block->fNumDist);
+    const int numLengths = block->fNumLitLen + block->fNumDist;
+
+    uint32_t codeLengthCounts[kNumCodeLength] = {};
+    int numSymbols = 0;
+    auto emit = [&](int symbol, int extra) {
+        block->fSymbols[numSymbols] = (uint8_t)symbol;
+        block->fSymbolExtra[numSymbols] = (uint8_t)extra;
+        numSymbols++;
+        codeLengthCounts[symbol]++;
+    };
+    for (int i = 0; i < numLengths;) {
+        const int length = lengths[i];
+        int run = 1;
+        while (i + run < numLengths && lengths[i + run] == length) {
+            run++;
+        }
+        i += run;
+
+        if (length == 0) {
+            while (run >= 11) {
+                const int r = std::min(run, 138);
+                emit(18, r - 11);
+                run -= r;
+            }
+            if (run >= 3) {
+                emit(17, run - 3);
+                run = 0;
+            }
+        } else {
+            emit(length, 0);
+            run--;
+            while (run >= 3) {
+                const int r = std::min(run, 6);
+                emit(16, r - 3);
+                run -= r;
+            }
+        }
+        for (; run > 0; run--) {
+            emit(length, 0);
+        }
+    }
+    block->fNumSymbols = numSymbols;
+
+    build_code(codeLengthCounts, kNumCodeLength, 7, block->fCodeLengthLengths,
+               block->fCodeLengthCodes);
+    block->fNumCodeLengths = kNumCodeLength;
+    while (block->fNumCodeLengths > 4 &&
+           !block->fCodeLengthLengths[kCodeLengthOrder[block->fNumCodeLengths - 1]]) {
+        block->fNumCodeLengths--;
+    }
+
+    uint64_t bits = 3 + 5 + 5 + 4 + 3 * block->fNumCodeLengths;
+    for (int s = 0; s < kNumCodeLength; s++) {
+        bits += (uint64_t)codeLengthCounts[s] *
+                (block->fCodeLengthLengths[s] + (s >= 16 ? kCodeLengthExtra[s - 16] : 0));
+    }
+    for (int s = 0; s < kNumLitLen; s++) {
+        bits += (uint64_t)litLenCounts[s] *
+                (block->fLitLenLengths[s] + (s > kEndOfBlock ? kLengthExtra[s - 257] : 0));
+    }
+    for (int s = 0; s < kNumDist; s++) {
+        bits += (uint64_t)distCounts[s] * (block->fDistLengths[s] + kDistExtra[s]);
+    }
+    return bits;
+}
+
+SkFastDeflate::SkFastDeflate(SkWStream* dst, int bytesPerPixel)
+    : fDst(dst)
+    , fBytesPerPixel(bytesPerPixel)
+    , fMatchLength(match_length)
+    , fUpdateAdler(adler32_scalar)
+    , fInput(kInputBytes)
+    , fHead(1 << kHashBits)
+    , fTokens(kInputBytes)
+    , fOut(kOutputBytes + kOutputSlack)
+{
+#if defined(SK_FAST_DEFLATE_SSE2)
+    if (SkCpu::Supports(SkCpu::SSE2)) {
+        fMatchLength = match_length_sse2;
+    }
+    if (SkCpu::Supports(SkCpu::AVX2)) {
+        fUpdateAdler = adler32_avx2;
+    } else if (SkCpu::Supports(SkCpu::SSSE3)) {
+        fUpdateAdler = adler32_ssse3;
+    }
+#elif defined(SK_FAST_DEFLATE_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        fMatchLength = match_length_neon;
+        fUpdateAdler = adler32_neon;
+    }
+#endif
+    std::fill(fHead.get(), fHead.get() + (1 << kHashBits), -1);
+
+    // Deflate with a 32K window, compressed for speed.
+    fWriter.fOut = fOut.get();
+    *fWriter.fOut++ = 0x78;
+    *fWriter.fOut++ = 0x01;
+}
+
+bool SkFastDeflate::write(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0 && !fFailed) {
+        const size_t n = std::min(size, kInputBytes - fEnd);
+        memcpy(fInput.get() + fEnd, bytes, n);
+        fAdler = fUpdateAdler(fAdler, bytes, n);
+        fEnd += n;
+        bytes += n;
+        size -= n;
+
+        if (fEnd == kInputBytes) {
+            this->compressBlock(false);
+
+            // Keep the window for the next block to match into.
+            const size_t shift = fEnd - kWindowBytes;
+            memmove(fInput.get(), fInput.get() + shift, kWindowBytes);
+            int32_t* head = fHead.get();
+            for (int h = 0; h < (1 << kHashBits); h++) {
+                head[h] = std::max(head[h] - (int32_t)shift, -1);
+            }
+            fStart = fEnd = kWindowBytes;
+        }
+    }
+    return !fFailed;
+}
+
+bool SkFastDeflate::finish() {
+    this->compressBlock(true);
+    this->alignToByte();
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        *fWriter.fOut++ = (uint8_t)(fAdler >> shift);
+    }
+    this->flushOutput();
+    return !fFailed;
+}
+
+void SkFastDeflate::compressBlock(bool final) {
+    // Counted in locals: the token stores would otherwise be taken to alias the members.
+    uint32_t litLenCounts[kNumLitLen] = {};
+    uint32_t distCounts[kNumDist] = {};
+
+    const CodeTables& tables = code_tables();
+    const uint8_t* in = fInput.get();
+    int32_t* head = fHead.get();
+    uint32_t* tokens = fTokens.get();
+    const size_t end = fEnd, bytesPerPixel = fBytesPerPixel;
+    const auto matchLength = fMatchLength;
+    int numTokens = 0;
+    size_t misses = 0;
+    for (size_t i = fStart; i < end;) {
+        const size_t limit = std::min(kMaxMatch, end - i);
+        size_t length = 0, distance = 0;
+        if (limit >= kMinMatch) {
+            // Filtered rows of flat color are runs of one pixel.
+            const uint32_t next = load32(in + i);
+            if (i >= bytesPerPixel && load32(in + i - bytesPerPixel) == next) {
+                length = matchLength(in + i, in + i - bytesPerPixel, limit);
+                distance = bytesPerPixel;
+            }
+            if (length < limit) {
+                const uint32_t h = (next * 2654435761u) >> (32 - kHashBits);
+                const int32_t candidate = head[h];
+                head[h] = (int32_t)i;
+                if (candidate >= 0 && i - candidate <= kWindowBytes &&
+                    load32(in + candidate) == next) {
+                    const size_t n = matchLength(in + i, in + candidate, limit);
+                    if (n > length && n >= kMinFarMatch) {
+                        length = n;
+                        distance = i - candidate;
+                    }
+                }
+            }
+        }
+
+        if (length >= kMinMatch) {
+            tokens[numTokens++] = (uint32_t)(distance << 16 | length);
+            litLenCounts[257 + tables.fLengthCode[length]]++;
+            distCounts[tables.distCode(distance)]++;
+            i += length;
+            misses = 0;
+        } else {
+            // Matches are searched for a pixel at a time, as they are found in runs of them.
+            const size_t step = bytesPerPixel * (1 + (misses++ >> kSkipShift));
+            const size_t literals = std::min(step, end - i);
+            for (size_t j = 0; j < literals; j++) {
+                tokens[numTokens++] = in[i + j];
+                litLenCounts[in[i + j]]++;
+            }
+            i += literals;
+        }
+    }
+    litLenCounts[kEndOfBlock]++;
+
+    // A block that does not compress is stored: its bytes, behind a header per 64K.
+    const size_t size = fEnd - fStart;
+    const uint64_t storedBits = 8 * (uint64_t)size + 7 +
+                                (3 + 32) * std::max<uint64_t>(1, (size + 65534) / 65535);
+    Block block;
+    if (PlanDynamicBlock(litLenCounts, distCounts, &block) < storedBits) {
+        this->writeDynamicBlock(block, numTokens, final);
+    } else {
+        this->writeStoredBlock(in + fStart, size, final);
+    }
+    fStart = fEnd;
+}
+
+void SkFastDeflate::writeDynamicBlock(const Block& block, int numTokens, bool final) {
+    BitWriter w = fWriter;
+    w.put(final, 1);
+    w.put(2, 2);
+    w.put(block.fNumLitLen - 257, 5);
+    w.put(block.fNumDist - 1, 5);
+    w.put(block.fNumCodeLengths - 4, 4);
+    for (int i = 0; i < block.fNumCodeLengths; i++) {
+        w.put(block.fCodeLengthLengths[kCodeLengthOrder[i]], 3);
+    }
+    for (int i = 0; i < block.fNumSymbols; i++) {
+        const int s = block.fSymbols[i];
+        w.put(block.fCodeLengthCodes[s], block.fCodeLengthLengths[s]);
+        if (s >= 16) {
+            w.put(block.fSymbolExtra[i], kCodeLengthExtra[s - 16]);
+        }
+    }
+
+    const CodeTables& tables = code_tables();
+    const uint32_t* tokens = fTokens.get();
+    uint8_t* const outputEnd = fOut.get() + kOutputBytes;
+    for (int i = 0; i < numTokens; i++) {
+        const uint32_t token = tokens[i];
+        if (token < 256) {
+            w.put(block.fLitLenCodes[token], block.fLitLenLengths[token]);
+        } else {
+            // A code and its extra bits fit in one write: at most 15 + 5 and 15 + 13 bits.
+            const uint32_t length = token & 0xFFFF, distance = token >> 16;
+            const int lc = tables.fLengthCode[length];
+            const int ls = 257 + lc;
+            w.put(block.fLitLenCodes[ls] | (length - kLengthBase[lc]) << block.fLitLenLengths[ls],
+                  block.fLitLenLengths[ls] + kLengthExtra[lc]);
+            const int dc = tables.distCode(distance);
+            w.put(block.fDistCodes[dc] | (distance - kDistBase[dc]) << block.fDistLengths[dc],
+                  block.fDistLengths[dc] + kDistExtra[dc]);
+        }
+        if (w.fOut >= outputEnd) {
+            fWriter = w;
+            this->flushOutput();
+            w = fWriter;
+        }
+    }
+    w.put(block.fLitLenCodes[kEndOfBlock], block.fLitLenLengths[kEndOfBlock]);
+    fWriter = w;
+}
+
+void SkFastDeflate::writeStoredBlock(const uint8_t* data, size_t size, bool final) {
+    do {
+        const size_t n = std::min<size_t>(size, 65535);
+        size -= n;
+        fWriter.put(final && size == 0, 1);
+        fWriter.put(0, 2);
+        this->alignToByte();
+        if (this->outputSize() >= kOutputBytes) {
+            this->flushOutput();
+        }
+        uint8_t* out = fWriter.fOut;
+        out[0] = (uint8_t)n;
+        out[1] = (uint8_t)(n >> 8);
+        out[2] = (uint8_t)~n;
+        out[3] = (uint8_t)(~n >> 8);
+        fWriter.fOut += 4;
+
+        for (size_t copied = 0; copied < n;) {
+            if (this->outputSize() >= kOutputBytes) {
+                this->flushOutput();
+            }
+            const size_t m = std::min(n - copied, kOutputBytes - this->outputSize());
+            memcpy(fWriter.fOut, data + copied, m);
+            fWriter.fOut += m;
+            copied += m;
+        }
+        data += n;
+    } while (size > 0);
+}
+
+void SkFastDeflate::alignToByte() {
+    fWriter.put(0, (8 - fWriter.fCount % 8) % 8);
+    for (; fWriter.fCount > 0; fWriter.fCount -= 8) {
+        *fWriter.fOut++ = (uint8_t)fWriter.fBits;
+        fWriter.fBits >>= 8;
+    }
+    fWriter.fBits = 0;
+}
+
+void SkFastDeflate::flushOutput() {
+    const size_t size = this->outputSize();
+    if (size && !fFailed && !fDst->write(fOut.get(), size)) {
+        fFailed = true;
+    }
+    fWriter.fOut = fOut.get();
+}
+
+size_t SkFastDeflate::WorkingMemory() {
+    return sizeof(SkFastDeflate) + kInputBytes + sizeof(int32_t) * (1 << kHashBits) +
+           sizeof(uint32_t) * kInputBytes + kOutputBytes + kOutputSlack;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sk_stream.h>
+#include <sk_templates_private.h>
+
+/**
+ *  A zlib stream writer that trades a few percent of size for speed, for pngs written in real
+ *  time.  Every input byte is looked at once: matches are only tried one pixel back, where
+ *  runs of filtered pixels repeat, and at the last place the next four bytes were seen, with
+ *  no chains or lazy evaluation.  Each block of input is tokenized first and then written
+ *  with Huffman tables built for that block, or stored when that is smaller, so the output
+ *  never grows much past the input.  Any inflater reads the result.
+ *
+ *  Match comparison, the adler32 checksum and the Up filter have SSE2, SSSE3, AVX2 and NEON
+ *  variants, chosen through SkCpu like the pixel kernels.
+ */
+class SkFastDeflate {
+public:
+    /**
+     *  The stream is written to |dst|, which is unowned, in pieces of at most kOutputBytes.
+     *  Runs are looked for |bytesPerPixel| bytes back.
+     */
+    SkFastDeflate(SkWStream* dst, int bytesPerPixel);
+
+    /**
+     *  Compresses the next |size| bytes of the stream.  Returns false once a write to |dst|
+     *  has failed.
+     */
+    bool write(const void* data, size_t size);
+
+    /**
+     *  Compresses what is left and ends the stream.  Returns false once a write to |dst| has
+     *  failed.
+     */
+    bool finish();
+
+    /** Bytes the writer allocates. */
+    static size_t WorkingMemory();
+
+    /**
+     *  Replaces the |size| bytes of |row| with their png Up residuals against |above|, and
+     *  |above| with the bytes |row| had, as the fast png engine filters each row before
+     *  writing it.
+     */
+    static void FilterUp(uint8_t* row, uint8_t* above, size_t size);
+
+    static constexpr size_t kOutputBytes = 64 * 1024;
+
+private:
+    struct Block;
+    static uint64_t PlanDynamicBlock(uint32_t* litLenCounts, uint32_t* distCounts, Block* block);
+
+    void compressBlock(bool final);
+    void writeDynamicBlock(const Block& block, int numTokens, bool final);
+    void writeStoredBlock(const uint8_t* data, size_t size, bool final);
+
+    /**
+     *  Bits waiting to be written, least significant first, and where they go.  Loops copy it
+     *  into a local so the bytes they write are not taken to alias it.
+     */
+    struct BitWriter {
+        uint64_t fBits = 0;
+        int      fCount = 0;
+        uint8_t* fOut = nullptr;
+
+        void put(uint32_t bits, int count) {
+            fBits |= (uint64_t)bits << fCount;
+            fCount += count;
+            if (fCount >= 32) {
+                for (int i = 0; i < 4; i++) {
+                    fOut[i] = (uint8_t)(fBits >> (8 * i));
+                }
+                fOut += 4;
+                fBits >>= 32;
+                fCount -= 32;
+            }
+        }
+    };
+
+    size_t outputSize() const { return fWriter.fOut - fOut.get(); }
+    void alignToByte();
+    void flushOutput();
+
+    SkWStream*             fDst;
+    const size_t           fBytesPerPixel;
+    size_t                 (*fMatchLength)(const uint8_t*, const uint8_t*, size_t);
+    uint32_t               (*fUpdateAdler)(uint32_t, const uint8_t*, size_t);
+
+    // Input, with the window of earlier input matches may reach back into before it.
+    SkAutoTMalloc<uint8_t> fInput;
+    size_t                 fStart = 0;
+    size_t                 fEnd = 0;
+    uint32_t               fAdler = 1;
+
+    // Offsets in fInput of the last place each hashed four bytes were seen, or negative.
+    SkAutoTMalloc<int32_t> fHead;
+
+    SkAutoTMalloc<uint32_t> fTokens;
+
+    SkAutoTMalloc<uint8_t> fOut;
+    BitWriter              fWriter;
+    bool                   fFailed = false;
+};
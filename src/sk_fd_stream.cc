@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <sk_fd_stream.h>
+
+std::unique_ptr<SkFDStream> SkFDStream::MakeFromFile(const char path[], size_t readAhead) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return std::unique_ptr<SkFDStream>(new SkFDStream(fd, true, readAhead));
+}
+
+SkFDStream::SkFDStream(int fd, bool ownsFd, size_t readAhead)
+    : fFD(fd)
+    , fOwnsFD(ownsFd)
+    , fCapacity(std::max<size_t>(readAhead, 1))
+    , fBuffer(fCapacity)
+    , fStart(0)
+    , fEnd(0)
+    , fEOF(false)
+    , fFailed(false)
+{
+    struct stat st;
+    if (fstat(fFD, &st) != 0) {
+        return;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fFD, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+    else if (S_ISFIFO(st.st_mode)) {
+        // Best effort: unprivileged processes are capped by /proc/sys/fs/pipe-max-size.
+        fcntl(fFD, F_SETPIPE_SZ, (int)std::min<size_t>(fCapacity, 1 << 30));
+    }
+#endif
+}
+
+SkFDStream::~SkFDStream() {
+    if (fOwnsFD) {
+        close(fFD);
+    }
+}
+
+size_t SkFDStream::readFD(void* buffer, size_t size) {
+    for (;;) {
+        ssize_t n = ::read(fFD, buffer, size);
+        if (n > 0) {
+            return (size_t)n;
+        }
+        if (n == 0) {
+            fEOF = true;
+            return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            struct pollfd pfd = { fFD, POLLIN, 0 };
+            poll(&pfd, 1, -1);
+            continue;
+        }
+
+        fEOF = true;
+        fFailed = true;
+        return 0;
+    }
+}
+
+size_t SkFDStream::read(void* buffer, size_t size) {
+    uint8_t* dst = (uint8_t*)buffer;
+    size_t done = 0;
+
+    while (done < size) {
+        if (fStart == fEnd) {
+            if (fEOF) {
+                break;
+            }
+
+            // Large requests skip the copy through the read-ahead buffer.
+            if (dst && size - done >= fCapacity) {
+                size_t n = this->readFD(dst + done, size - done);
+                if (n == 0) {
+                    break;
+                }
+                done += n;
+                continue;
+            }
+
+            fStart = 0;
+            fEnd = this->readFD(fBuffer.get(), fCapacity);
+            if (fEnd == 0) {
+                break;
+            }
+        }
+
+        size_t n = std::min(size - done, fEnd - fStart);
+        if (dst) {
+            memcpy(dst + done, fBuffer.get() + fStart, n);
+        }
+        fStart += n;
+        done += n;
+    }
+
+    return done;
+}
+
+size_t SkFDStream::peek(void* buffer, size_t size) const {
+    size_t n = std::min(size, fEnd - fStart);
+    memcpy(buffer, fBuffer.get() + fStart, n);
+    return n;
+}
+
+bool SkFDStream::isAtEnd() const {
+    return fEOF && fStart == fEnd;
+}
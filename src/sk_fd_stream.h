@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include <sk_stream.h>
+#include <sk_templates_private.h>
+
+/**
+ *  SkFDStream reads a file descriptor: a file, a pipe, a socket or stdin.
+ *
+ *  Reads go through a large read-ahead buffer so that pulling a frame a few rows at a time
+ *  costs few system calls, and requests at least as large as the buffer are read straight
+ *  into the caller's memory.  Like every SkStream, read() blocks until the request is filled
+ *  or the descriptor reaches end of file; a read error ends the stream the same way and is
+ *  reported by failed().
+ */
+class SkFDStream : public SkStream {
+public:
+    static constexpr size_t kDefaultReadAhead = 1 << 20;
+
+    /**
+     *  Opens |path| for reading.  Returns nullptr if it cannot be opened.
+     */
+    static std::unique_ptr<SkFDStream> MakeFromFile(const char path[],
+                                                    size_t readAhead = kDefaultReadAhead);
+
+    /**
+     *  Reads |fd| from its current position, closing it on destruction if |ownsFd|.  Files
+     *  are advised for sequential reading and, on Linux, pipes are asked for a kernel buffer
+     *  of |readAhead| bytes so the writer is not stalled on every row.
+     */
+    SkFDStream(int fd, bool ownsFd, size_t readAhead = kDefaultReadAhead);
+    ~SkFDStream() override;
+
+    size_t read(void* buffer, size_t size) override;
+
+    /**
+     *  Peeks at bytes already read ahead, without blocking for more.
+     */
+    size_t peek(void* buffer, size_t size) const override;
+    bool isAtEnd() const override;
+
+    bool failed() const { return fFailed; }
+
+private:
+    // Reads up to |size| bytes from the descriptor, retrying interrupted and would-block
+    // reads.  Returns 0 at end of file or on error.
+    size_t readFD(void* buffer, size_t size);
+
+    const int              fFD;
+    const bool             fOwnsFD;
+    const size_t           fCapacity;
+    SkAutoTMalloc<uint8_t> fBuffer;
+    size_t                 fStart;
+    size_t                 fEnd;
+    bool                   fEOF;
+    bool                   fFailed;
+};
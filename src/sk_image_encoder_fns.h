@@ -1,8 +1,26 @@
 #pragma once
 
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
 #include <skcms.h>
 
-typedef void (*transform_scanline_proc)(char* dst, const char* src, int width, int bpp);
+#include <sk_cpu.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define SK_ENCODER_FNS_HSW 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define SK_ENCODER_FNS_NEON 1
+#endif
+
+/*
+ *  The row kernels index their rows with int, so longer runs of pixels are handed to them in
+ *  pieces of at most kMaxProcPixels.
+ */
+static constexpr int kMaxProcPixels = 1 << 24;
 
 static void skcms(char* dst, const char* src, int n,
                   skcms_PixelFormat srcFmt, skcms_AlphaFormat srcAlpha,
@@ -11,20 +29,458 @@ static void skcms(char* dst, const char* src, int n,
                                    dst, dstFmt, dstAlpha, nullptr, n);
 }
 
-static inline void transform_scanline_bgrA(char* dst, const char* src, int width, int) {
+static inline void transform_scanline_memcpy(char* dst, const char* src, int width, int bpp) {
+    memcpy(dst, src, width * bpp);
+}
+
+static inline void transform_scanline_565(char* dst, const char* src, int width, int) {
+    skcms(dst, src, width,
+          skcms_PixelFormat_BGR_565, skcms_AlphaFormat_Unpremul,
+          skcms_PixelFormat_RGB_888, skcms_AlphaFormat_Unpremul);
+}
+
+/*
+ *  Premultiplied RGBA half floats to unpremultiplied big-endian 16-bit RGBA, as png stores it.
+ *  The math matches skcms bit for bit, NaNs and negative alphas included: scale by 1/a unless
+ *  that is +inf or NaN (then 0), clamp with min(v, 1) keeping NaN and max(m, 0) dropping it,
+ *  scale by 65535 and round half up.  The clamps are compare-and-select rather than the native
+ *  min/max, whose NaN handling differs between instruction sets.  Each kernel returns the
+ *  number of pixels it converted; skcms handles the rest.
+ */
+#if defined(SK_ENCODER_FNS_HSW)
+// Two pixels per 128-bit load, one per 128-bit lane once widened to floats.
+__attribute__((target("avx2,f16c")))
+static inline __m256i F16_premul_to_unorm16_hsw(const char* src) {
+    const __m256 zero = _mm256_setzero_ps(),
+                 one  = _mm256_set1_ps(1.0f),
+                 inf  = _mm256_set1_ps(INFINITY);
+
+    __m256 px = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)src));
+    __m256 inv = _mm256_div_ps(one, _mm256_permute_ps(px, 0xFF));
+    inv = _mm256_and_ps(inv, _mm256_cmp_ps(inv, inf, _CMP_LT_OQ));
+    __m256 v = _mm256_blend_ps(_mm256_mul_ps(px, inv), px, 0x88);
+    // minps and maxps return their second operand when either is NaN.
+    v = _mm256_max_ps(_mm256_min_ps(one, v), zero);
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(65535.0f)),
+                                             _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2,f16c")))
+static int F16_premul_to_16161616BE_hsw(char* dst, const char* src, int width) {
+    const __m256i swapBytes = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        // Lanes hold pixels {0, 2} and {1, 3} after packing; put them back in order.
+        __m256i packed = _mm256_packus_epi32(F16_premul_to_unorm16_hsw(src + 8 * i),
+                                             F16_premul_to_unorm16_hsw(src + 8 * i + 16));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + 8 * i), _mm256_shuffle_epi8(packed, swapBytes));
+    }
+    return i;
+}
+#endif
+
+#if defined(SK_ENCODER_FNS_NEON)
+static int F16_premul_to_16161616BE_neon(char* dst, const char* src, int width) {
+    const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f),
+                      inf = vdupq_n_f32(INFINITY);
+    const uint32x4_t alphaLane = { 0, 0, 0, ~0u };
+
+    for (int i = 0; i < width; i++) {
+        float32x4_t px = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16((const uint16_t*)src + 4 * i)));
+        float32x4_t inv = vdivq_f32(one, vdupq_laneq_f32(px, 3));
+        inv = vbslq_f32(vcltq_f32(inv, inf), inv, zero);
+        float32x4_t v = vbslq_f32(alphaLane, px, vmulq_f32(px, inv));
+        // vminq and vmaxq propagate NaN, so select instead.
+        v = vbslq_f32(vcgtq_f32(v, one), one, v);
+        v = vbslq_f32(vcgtq_f32(v, zero), v, zero);
+        uint16x4_t u = vmovn_u32(vcvtq_u32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), v, 65535.0f)));
+        vst1_u8((uint8_t*)dst + 8 * i, vrev16_u8(vreinterpret_u8_u16(u)));
+    }
+    return width;
+}
+#endif
+
+static inline void transform_scanline_F16_premul(char* dst, const char* src, int width, int) {
+    int done = 0;
+#if defined(SK_ENCODER_FNS_HSW)
+    if (SkCpu::Supports(SkCpu::AVX2)) {
+        done = F16_premul_to_16161616BE_hsw(dst, src, width);
+    }
+#elif defined(SK_ENCODER_FNS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        done = F16_premul_to_16161616BE_neon(dst, src, width);
+    }
+#endif
+    if (done < width) {
+        skcms(dst + 8 * done, src + 8 * done, width - done,
+              skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_PremulAsEncoded,
+              skcms_PixelFormat_RGBA_16161616BE, skcms_AlphaFormat_Unpremul);
+    }
+}
+
+static inline void transform_scanline_F16(char* dst, const char* src, int width, int) {
+    skcms(dst, src, width,
+          skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_Unpremul,
+          skcms_PixelFormat_RGBA_16161616BE, skcms_AlphaFormat_Unpremul);
+}
+
+static inline void transform_scanline_F16_opaque(char* dst, const char* src, int width, int) {
+    skcms(dst, src, width,
+          skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_Opaque,
+          skcms_PixelFormat_RGB_161616BE, skcms_AlphaFormat_Opaque);
+}
+
+/*
+ *  Unpremultiplied and opaque 8-bit rows only need their bytes moved.  swizzle_8888 optionally
+ *  swaps red and blue and ORs |alphaBits| into every alpha byte; strip_alpha_8888 drops the
+ *  alpha byte, optionally swapping red and blue.  The swap is a template parameter so each
+ *  kernel compiles to a single fixed shuffle.  The SIMD kernels return the number of pixels
+ *  they converted; the scalar loops finish the row.
+ */
+#if defined(SK_ENCODER_FNS_HSW)
+template <bool kSwapRB>
+__attribute__((target("ssse3")))
+static int swizzle_8888_ssse3(char* dst, const char* src, int width, uint8_t alphaBits) {
+    const __m128i order = kSwapRB
+            ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+            : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i alpha = _mm_set1_epi32((int)((uint32_t)alphaBits << 24));
+
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(px, order), alpha));
+    }
+    return i;
+}
+
+template <bool kSwapRB>
+__attribute__((target("ssse3")))
+static int strip_alpha_8888_ssse3(char* dst, const char* src, int width) {
+    const __m128i order = kSwapRB
+            ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+            : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    // Each store writes 16 bytes for 12 bytes of output, so stop while it still fits the row.
+    int i = 0;
+    for (; i + 6 <= width; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+        _mm_storeu_si128((__m128i*)(dst + 3 * i), _mm_shuffle_epi8(px, order));
+    }
+    return i;
+}
+#endif
+
+#if defined(SK_ENCODER_FNS_NEON)
+template <bool kSwapRB>
+static int swizzle_8888_neon(char* dst, const char* src, int width, uint8_t alphaBits) {
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t*)src + 4 * i);
+        if (kSwapRB) {
+            uint8x8_t r = px.val[0];
+            px.val[0] = px.val[2];
+            px.val[2] = r;
+        }
+        px.val[3] = vorr_u8(px.val[3], vdup_n_u8(alphaBits));
+        vst4_u8((uint8_t*)dst + 4 * i, px);
+    }
+    return i;
+}
+
+template <bool kSwapRB>
+static int strip_alpha_8888_neon(char* dst, const char* src, int width) {
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t*)src + 4 * i);
+        uint8x8x3_t rgb = {{ px.val[kSwapRB ? 2 : 0], px.val[1], px.val[kSwapRB ? 0 : 2] }};
+        vst3_u8((uint8_t*)dst + 3 * i, rgb);
+    }
+    return i;
+}
+#endif
+
+template <bool kSwapRB>
+static inline void swizzle_8888(char* dst, const char* src, int width, uint8_t alphaBits) {
+    int i = 0;
+#if defined(SK_ENCODER_FNS_HSW)
+    if (SkCpu::Supports(SkCpu::SSSE3)) {
+        i = swizzle_8888_ssse3<kSwapRB>(dst, src, width, alphaBits);
+    }
+#elif defined(SK_ENCODER_FNS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        i = swizzle_8888_neon<kSwapRB>(dst, src, width, alphaBits);
+    }
+#endif
+    const int r = kSwapRB ? 2 : 0, b = kSwapRB ? 0 : 2;
+    for (; i < width; i++) {
+        dst[4 * i + 0] = src[4 * i + r];
+        dst[4 * i + 1] = src[4 * i + 1];
+        dst[4 * i + 2] = src[4 * i + b];
+        dst[4 * i + 3] = (char)(src[4 * i + 3] | alphaBits);
+    }
+}
+
+template <bool kSwapRB>
+static inline void strip_alpha_8888(char* dst, const char* src, int width) {
+    int i = 0;
+#if defined(SK_ENCODER_FNS_HSW)
+    if (SkCpu::Supports(SkCpu::SSSE3)) {
+        i = strip_alpha_8888_ssse3<kSwapRB>(dst, src, width);
+    }
+#elif defined(SK_ENCODER_FNS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        i = strip_alpha_8888_neon<kSwapRB>(dst, src, width);
+    }
+#endif
+    const int r = kSwapRB ? 2 : 0, b = kSwapRB ? 0 : 2;
+    for (; i < width; i++) {
+        dst[3 * i + 0] = src[4 * i + r];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + b];
+    }
+}
+
+/*
+ *  Premultiplied 8-bit rows to unpremultiplied, optionally swapping red and blue.  The math is
+ *  skcms's, op for op, so the output is bit-exact with it: channels load as v * (1/255), are
+ *  scaled by 1 / (a * (1/255)), or 0 when a is 0, clamp to [0, 1] and store as
+ *  (int)(c * 255 + 0.5).  No fixed-point multiply reproduces that, since float rounding settles
+ *  exact halves differently from one alpha to the next.
+ *
+ *  The scales come from a table built at compile time, so nothing divides per pixel.  Opaque
+ *  pixels come out unchanged and transparent ones as zero, so groups of either skip the math.
+ *  The alpha byte is always kept as it is, which is also what skcms stores.
+ */
+struct SkUnpremulScales {
+    float fScale[256];
+
+    constexpr SkUnpremulScales() : fScale() {
+        for (int a = 1; a < 256; a++) {
+            fScale[a] = 1.0f / (a * (1 / 255.0f));
+        }
+    }
+};
+
+static constexpr SkUnpremulScales kUnpremulScales;
+
+static inline uint8_t unpremul_channel(uint8_t v, float scale) {
+    float c = v * (1 / 255.0f) * scale;
+    c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+    return (uint8_t)(int)(c * 255 + 0.5f);
+}
+
+#if defined(SK_ENCODER_FNS_HSW)
+// Splits pixels into one channel per 32-bit lane, scales them and packs them back, red and
+// blue swapped by the shifts they are packed with.
+template <bool kSwapRB>
+__attribute__((target("avx2")))
+static inline __m256i unpremul_8888_hsw(__m256i px) {
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    const __m256 k    = _mm256_set1_ps(1 / 255.0f),
+                 zero = _mm256_setzero_ps(),
+                 one  = _mm256_set1_ps(1.0f),
+                 c255 = _mm256_set1_ps(255.0f),
+                 half = _mm256_set1_ps(0.5f);
+
+    __m256i a = _mm256_srli_epi32(px, 24);
+    __m256 scale = _mm256_i32gather_ps(kUnpremulScales.fScale, a, 4);
+
+    __m256i out = _mm256_slli_epi32(a, 24);
+    for (int c = 0; c < 3; c++) {
+        __m256 v = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8 * c), byte));
+        v = _mm256_mul_ps(_mm256_mul_ps(v, k), scale);
+        v = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+        __m256i u = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, c255), half));
+        const int shift = kSwapRB && c != 1 ? 16 - 8 * c : 8 * c;
+        out = _mm256_or_si256(out, _mm256_slli_epi32(u, shift));
+    }
+    return out;
+}
+
+template <bool kSwapRB>
+__attribute__((target("avx2")))
+static int unpremul_8888_avx2(char* dst, const char* src, int width) {
+    const __m256i order = kSwapRB
+            ? _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                               2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+            : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                               0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+        __m256i alpha = _mm256_and_si256(px, alphaMask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1) {
+            px = _mm256_shuffle_epi8(px, order);
+        } else if (_mm256_testz_si256(alpha, alpha)) {
+            px = _mm256_setzero_si256();
+        } else {
+            px = unpremul_8888_hsw<kSwapRB>(px);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + 4 * i), px);
+    }
+    return i;
+}
+
+template <bool kSwapRB>
+__attribute__((target("sse2")))
+static int unpremul_8888_sse2(char* dst, const char* src, int width) {
+    const __m128i byte = _mm_set1_epi32(0xFF),
+                  alphaMask = _mm_set1_epi32((int)0xFF000000);
+    const __m128 k    = _mm_set1_ps(1 / 255.0f),
+                 zero = _mm_setzero_ps(),
+                 one  = _mm_set1_ps(1.0f),
+                 c255 = _mm_set1_ps(255.0f),
+                 half = _mm_set1_ps(0.5f);
+
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+        __m128i alpha = _mm_and_si128(px, alphaMask);
+        __m128i out;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) == 0xFFFF) {
+            out = _mm_setzero_si128();
+        } else {
+            // SSE2 has no byte shuffle, so opaque pixels are repacked by the same shifts.
+            const bool opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF;
+            const uint8_t* p = (const uint8_t*)src + 4 * i;
+            __m128 scale = zero;
+            if (!opaque) {
+                scale = _mm_setr_ps(kUnpremulScales.fScale[p[3]], kUnpremulScales.fScale[p[7]],
+                                    kUnpremulScales.fScale[p[11]], kUnpremulScales.fScale[p[15]]);
+            }
+            out = alpha;
+            for (int c = 0; c < 3; c++) {
+                __m128i u = _mm_and_si128(_mm_srli_epi32(px, 8 * c), byte);
+                if (!opaque) {
+                    __m128 v = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(u), k), scale);
+                    v = _mm_min_ps(_mm_max_ps(v, zero), one);
+                    u = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, c255), half));
+                }
+                const int shift = kSwapRB && c != 1 ? 16 - 8 * c : 8 * c;
+                out = _mm_or_si128(out, _mm_slli_epi32(u, shift));
+            }
+        }
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), out);
+    }
+    return i;
+}
+#endif
+
+#if defined(SK_ENCODER_FNS_NEON)
+static inline uint8x8_t unpremul_channel_neon(uint8x8_t v, float32x4_t scaleLo,
+                                              float32x4_t scaleHi) {
+    const float32x4_t k = vdupq_n_f32(1 / 255.0f), zero = vdupq_n_f32(0.0f),
+                      one = vdupq_n_f32(1.0f), c255 = vdupq_n_f32(255.0f),
+                      half = vdupq_n_f32(0.5f);
+
+    uint16x8_t wide = vmovl_u8(v);
+    float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))),
+                hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide)));
+    lo = vminq_f32(vmaxq_f32(vmulq_f32(vmulq_f32(lo, k), scaleLo), zero), one);
+    hi = vminq_f32(vmaxq_f32(vmulq_f32(vmulq_f32(hi, k), scaleHi), zero), one);
+    uint32x4_t ulo = vcvtq_u32_f32(vaddq_f32(vmulq_f32(lo, c255), half)),
+               uhi = vcvtq_u32_f32(vaddq_f32(vmulq_f32(hi, c255), half));
+    return vmovn_u16(vcombine_u16(vmovn_u32(ulo), vmovn_u32(uhi)));
+}
+
+template <bool kSwapRB>
+static int unpremul_8888_neon(char* dst, const char* src, int width) {
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        uint8x8x4_t px = vld4_u8((const uint8_t*)src + 4 * i);
+        const uint64_t alpha = vget_lane_u64(vreinterpret_u64_u8(px.val[3]), 0);
+        if (alpha == 0) {
+            px.val[0] = px.val[1] = px.val[2] = vdup_n_u8(0);
+        } else if (alpha != ~0ull) {
+            float scales[8];
+            for (int j = 0; j < 8; j++) {
+                scales[j] = kUnpremulScales.fScale[(uint8_t)src[4 * (i + j) + 3]];
+            }
+            const float32x4_t lo = vld1q_f32(scales), hi = vld1q_f32(scales + 4);
+            for (int c = 0; c < 3; c++) {
+                px.val[c] = unpremul_channel_neon(px.val[c], lo, hi);
+            }
+        }
+        if (kSwapRB) {
+            uint8x8_t r = px.val[0];
+            px.val[0] = px.val[2];
+            px.val[2] = r;
+        }
+        vst4_u8((uint8_t*)dst + 4 * i, px);
+    }
+    return i;
+}
+#endif
+
+template <bool kSwapRB>
+static inline void unpremul_8888(char* dst, const char* src, int width) {
+    int i = 0;
+#if defined(SK_ENCODER_FNS_HSW)
+    if (SkCpu::Supports(SkCpu::AVX2)) {
+        i = unpremul_8888_avx2<kSwapRB>(dst, src, width);
+    }
+    if (SkCpu::Supports(SkCpu::SSE2)) {
+        i += unpremul_8888_sse2<kSwapRB>(dst + 4 * i, src + 4 * i, width - i);
+    }
+#elif defined(SK_ENCODER_FNS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        i = unpremul_8888_neon<kSwapRB>(dst, src, width);
+    }
+#endif
+    const int r = kSwapRB ? 2 : 0, b = kSwapRB ? 0 : 2;
+    for (; i < width; i++) {
+        const uint8_t* p = (const uint8_t*)src + 4 * i;
+        const float scale = kUnpremulScales.fScale[p[3]];
+        uint8_t rgb[3] = { unpremul_channel(p[r], scale),
+                           unpremul_channel(p[1], scale),
+                           unpremul_channel(p[b], scale) };
+        dst[4 * i + 0] = (char)rgb[0];
+        dst[4 * i + 1] = (char)rgb[1];
+        dst[4 * i + 2] = (char)rgb[2];
+        dst[4 * i + 3] = (char)p[3];
+    }
+}
+
+static inline void transform_scanline_565_to_bgra(char* dst, const char* src, int width, int) {
+    skcms(dst, src, width,
+        skcms_PixelFormat_BGR_565, skcms_AlphaFormat_Unpremul,
+        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul);
+}
+
+static inline void transform_scanline_A8_to_bgra(char* dst, const char* src, int width, int) {
+    skcms(dst, src, width,
+        skcms_PixelFormat_A_8, skcms_AlphaFormat_Unpremul,
+        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul);
+}
+
+static inline void transform_scanline_G8_to_bgra(char* dst, const char* src, int width, int) {
     skcms(dst, src, width,
-          skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_PremulAsEncoded,
-          skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul);
+        skcms_PixelFormat_G_8, skcms_AlphaFormat_Unpremul,
+        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul);
 }
 
-static inline void transform_scanline_BGRA(char* dst, const char* src, int width, int) {
+static inline void transform_scanline_F16_premul_to_bgra(char* dst, const char* src, int width,
+                                                         int) {
     skcms(dst, src, width,
-          skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul,
-          skcms_PixelFormat_RGBA_8888, skcms_AlphaFormat_Unpremul);
+        skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_PremulAsEncoded,
+        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul);
 }
 
-static inline void transform_scanline_bgrA_same(char* dst, const char* src, int width, int) {
+static inline void transform_scanline_F16_to_bgra(char* dst, const char* src, int width, int) {
     skcms(dst, src, width,
-        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_PremulAsEncoded,
+        skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_Unpremul,
         skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Unpremul);
 }
+
+static inline void transform_scanline_F16_opaque_to_bgra(char* dst, const char* src, int width,
+                                                         int) {
+    skcms(dst, src, width,
+        skcms_PixelFormat_RGBA_hhhh, skcms_AlphaFormat_Opaque,
+        skcms_PixelFormat_BGRA_8888, skcms_AlphaFormat_Opaque);
+}
+
@@ -8,7 +8,7 @@ static inline bool SkPixmapIsValid(const SkPixmap& src) {
         return false;
     }
 
-    if (!src.addr() || src.rowBytes() < src.info().minRowBytes()) {
+    if (!src.addr() || src.rowBytes() < src.info().minRowBytes64()) {
         return false;
     }
 
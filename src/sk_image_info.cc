@@ -7,10 +7,28 @@
 int SkColorTypeBytesPerPixel(SkColorType ct) {
     switch (ct) {
         case kUnknown_SkColorType:            return 0;
+        case kAlpha_8_SkColorType:            return 1;
+        case kRGB_565_SkColorType:            return 2;
+        case kRGBA_8888_SkColorType:          return 4;
         case kBGRA_8888_SkColorType:          return 4;
+        case kGray_8_SkColorType:             return 1;
+        case kRGBA_F16_SkColorType:           return 8;
     }
 }
 
+bool SkColorTypeIsAlwaysOpaque(SkColorType ct) {
+    switch (ct) {
+        case kUnknown_SkColorType:            return false;
+        case kAlpha_8_SkColorType:            return false;
+        case kRGB_565_SkColorType:            return true;
+        case kRGBA_8888_SkColorType:          return false;
+        case kBGRA_8888_SkColorType:          return false;
+        case kGray_8_SkColorType:             return true;
+        case kRGBA_F16_SkColorType:           return false;
+    }
+    return false;
+}
+
 int SkColorInfo::bytesPerPixel() const { return SkColorTypeBytesPerPixel(fColorType); }
 
 int SkColorInfo::shiftPerPixel() const { return SkColorTypeShiftPerPixel(fColorType); }
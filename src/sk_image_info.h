@@ -1,9 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 
 #include <sk_size.h>
 #include <sk_color.h>
+#include <sk_color_space.h>
 #include <sk_math.h>
 #include <sk_template_fits_in.h>
 
@@ -20,10 +22,22 @@
 */
 enum SkAlphaType {
     kUnknown_SkAlphaType,                          //!< uninitialized
+    kOpaque_SkAlphaType,                           //!< pixel is opaque
     kPremul_SkAlphaType,                           //!< pixel components are premultiplied by alpha
-    kLastEnum_SkAlphaType = kPremul_SkAlphaType, //!< last valid value
+    kUnpremul_SkAlphaType,                         //!< pixel components are independent of alpha
+    kLastEnum_SkAlphaType = kUnpremul_SkAlphaType, //!< last valid value
 };
 
+/** Returns true if SkAlphaType equals kOpaque_SkAlphaType.
+    kOpaque_SkAlphaType is a hint that the SkColorType is opaque, or that all
+    alpha values are set to their 1.0 equivalent. If SkAlphaType is
+    kOpaque_SkAlphaType, and SkColorType is not opaque, then the result of
+    drawing any pixel with a alpha value less than 1.0 is undefined.
+*/
+static inline bool SkAlphaTypeIsOpaque(SkAlphaType at) {
+    return kOpaque_SkAlphaType == at;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /** \enum SkImageInfo::SkColorType
@@ -33,7 +47,12 @@ enum SkAlphaType {
 */
 enum SkColorType {
     kUnknown_SkColorType,      //!< uninitialized
+    kAlpha_8_SkColorType,      //!< pixel with alpha in 8-bit byte
+    kRGB_565_SkColorType,      //!< pixel with 5 bits red, 6 bits green, 5 bits blue, in 16-bit word
+    kRGBA_8888_SkColorType,    //!< pixel with 8 bits for red, green, blue, alpha; in 32-bit word
     kBGRA_8888_SkColorType,    //!< pixel with 8 bits for blue, green, red, alpha; in 32-bit word
+    kGray_8_SkColorType,       //!< pixel with grayscale level in 8-bit byte
+    kRGBA_F16_SkColorType,     //!< pixel with half floats for red, green, blue, alpha; in 64-bit word
     kN32_SkColorType          = kBGRA_8888_SkColorType,//!< native 32-bit BGRA encoding
 };
 
@@ -43,6 +62,12 @@ enum SkColorType {
 */
 int SkColorTypeBytesPerPixel(SkColorType ct);
 
+/** Returns true if SkColorType always decodes alpha to 1.0, making the pixel
+    fully opaque. If true, SkColorType does not reserve bits to encode alpha.
+    @return    true if alpha is always set to 1.0
+*/
+bool SkColorTypeIsAlwaysOpaque(SkColorType ct);
+
 /** \struct SkColorInfo
     Describes pixel and encoding. SkImageInfo can be created from SkColorInfo by
     providing dimensions.
@@ -64,8 +89,8 @@ public:
         combination is supported.
         @return        created SkColorInfo
     */
-    SkColorInfo(SkColorType ct, SkAlphaType at)
-            : fColorType(ct), fAlphaType(at) {}
+    SkColorInfo(SkColorType ct, SkAlphaType at, std::shared_ptr<SkColorSpace> cs = nullptr)
+            : fColorSpace(std::move(cs)), fColorType(ct), fAlphaType(at) {}
 
     SkColorInfo(const SkColorInfo&) = default;
     SkColorInfo(SkColorInfo&&) = default;
@@ -73,18 +98,22 @@ public:
     SkColorInfo& operator=(const SkColorInfo&) = default;
     SkColorInfo& operator=(SkColorInfo&&) = default;
 
+    SkColorSpace* colorSpace() const { return fColorSpace.get(); }
+    std::shared_ptr<SkColorSpace> refColorSpace() const { return fColorSpace; }
     SkColorType colorType() const { return fColorType; }
     SkAlphaType alphaType() const { return fAlphaType; }
 
     bool isOpaque() const {
-        return false;
+        return SkAlphaTypeIsOpaque(fAlphaType)
+            || SkColorTypeIsAlwaysOpaque(fColorType);
     }
 
     bool gammaCloseToSRGB() const { return false; }
 
     /** Does other represent the same color type, alpha type, and color space? */
     bool operator==(const SkColorInfo& other) const {
-        return fColorType == other.fColorType && fAlphaType == other.fAlphaType;
+        return fColorType == other.fColorType && fAlphaType == other.fAlphaType &&
+               fColorSpace == other.fColorSpace;
     }
 
     /** Does other represent a different color type, alpha type, or color space? */
@@ -96,14 +125,14 @@ public:
         SkColorType, in which case SkAlphaType in SkColorInfo is ignored.
     */
     SkColorInfo makeAlphaType(SkAlphaType newAlphaType) const {
-        return SkColorInfo(this->colorType(), newAlphaType);
+        return SkColorInfo(this->colorType(), newAlphaType, this->refColorSpace());
     }
 
     /** Creates new SkColorInfo with same SkAlphaType, SkColorSpace, with SkColorType
         set to newColorType.
     */
     SkColorInfo makeColorType(SkColorType newColorType) const {
-        return SkColorInfo(newColorType, this->alphaType());
+        return SkColorInfo(newColorType, this->alphaType(), this->refColorSpace());
     }
 
     /** Returns number of bytes per pixel required by SkColorType.
@@ -121,6 +150,7 @@ public:
     int shiftPerPixel() const;
 
 private:
+    std::shared_ptr<SkColorSpace> fColorSpace;
     SkColorType fColorType = SkColorType::kUnknown_SkColorType;
     SkAlphaType fAlphaType = SkAlphaType::kUnknown_SkAlphaType;
 };
@@ -154,11 +184,13 @@ public:
         @param cs      range of colors; may be nullptr
         @return        created SkImageInfo
     */
-    static SkImageInfo Make(int width, int height, SkColorType ct, SkAlphaType at) {
-        return SkImageInfo({width, height}, { ct, at });
+    static SkImageInfo Make(int width, int height, SkColorType ct, SkAlphaType at,
+                            std::shared_ptr<SkColorSpace> cs = nullptr) {
+        return SkImageInfo({width, height}, { ct, at, std::move(cs) });
     }
-    static SkImageInfo Make(SkISize dimensions, SkColorType ct, SkAlphaType at) {
-        return SkImageInfo(dimensions, { ct, at });
+    static SkImageInfo Make(SkISize dimensions, SkColorType ct, SkAlphaType at,
+                            std::shared_ptr<SkColorSpace> cs = nullptr) {
+        return SkImageInfo(dimensions, { ct, at, std::move(cs) });
     }
 
     /** Creates SkImageInfo from integral dimensions width and height, kN32_SkColorType,
@@ -213,6 +245,35 @@ public:
 
     SkAlphaType alphaType() const { return fColorInfo.alphaType(); }
 
+    /** Returns SkColorSpace, the range of colors. The returned SkColorSpace is immutable.
+        @return  SkColorSpace, or nullptr
+    */
+    SkColorSpace* colorSpace() const { return fColorInfo.colorSpace(); }
+
+    /** Returns shared pointer to SkColorSpace, the range of colors.
+        @return  SkColorSpace, or nullptr
+    */
+    std::shared_ptr<SkColorSpace> refColorSpace() const { return fColorInfo.refColorSpace(); }
+
+    /** Creates SkImageInfo with the same SkColorType, SkAlphaType and SkColorSpace,
+        with dimensions set to width and height.
+        @param newWidth   pixel column count; must be zero or greater
+        @param newHeight  pixel row count; must be zero or greater
+        @return           created SkImageInfo
+    */
+    SkImageInfo makeWH(int newWidth, int newHeight) const {
+        return SkImageInfo({newWidth, newHeight}, fColorInfo);
+    }
+
+    /** Creates SkImageInfo with same SkColorType, SkAlphaType, width, and height,
+        with SkColorSpace set to cs.
+        @param cs  range of colors; may be nullptr
+        @return    created SkImageInfo
+    */
+    SkImageInfo makeColorSpace(std::shared_ptr<SkColorSpace> cs) const {
+        return Make(fDimensions, this->colorType(), this->alphaType(), std::move(cs));
+    }
+
     /** Returns if SkImageInfo describes an empty area of pixels by checking if either
         width or height is zero or smaller.
         @return  true if either dimension is zero or smaller
@@ -259,8 +320,7 @@ public:
     int shiftPerPixel() const { return fColorInfo.shiftPerPixel(); }
 
     /** Returns minimum bytes per row, computed from pixel width() and SkColorType, which
-        specifies bytesPerPixel(). SkBitmap maximum value for row bytes must fit
-        in 31 bits.
+        specifies bytesPerPixel().
         @return  width() times bytesPerPixel() as unsigned 64-bit integer
     */
     uint64_t minRowBytes64() const {
@@ -268,13 +328,13 @@ public:
     }
 
     /** Returns minimum bytes per row, computed from pixel width() and SkColorType, which
-        specifies bytesPerPixel(). SkBitmap maximum value for row bytes must fit
-        in 31 bits.
+        specifies bytesPerPixel(). Rows are not limited to 31 bits; returns zero only
+        when the row does not fit size_t.
         @return  width() times bytesPerPixel() as size_t
     */
     size_t minRowBytes() const {
         uint64_t minRowBytes = this->minRowBytes64();
-        if (!SkTFitsIn<int32_t>(minRowBytes)) {
+        if (!SkTFitsIn<size_t>(minRowBytes)) {
             return 0;
         }
         return (size_t)minRowBytes;
@@ -6,7 +6,12 @@
 static int SkColorTypeShiftPerPixel(SkColorType ct) {
     switch (ct) {
         case kUnknown_SkColorType:            return 0;
+        case kAlpha_8_SkColorType:            return 0;
+        case kRGB_565_SkColorType:            return 1;
+        case kRGBA_8888_SkColorType:          return 2;
         case kBGRA_8888_SkColorType:          return 2;
+        case kGray_8_SkColorType:             return 0;
+        case kRGBA_F16_SkColorType:           return 3;
     }
 }
 
@@ -26,14 +31,15 @@ static inline bool SkColorInfoIsValid(const SkColorInfo& info) {
 
 /**
  *  Returns true if |info| contains a valid combination of width, height and colorInfo.
+ *  Sizes are computed in size_t, so any positive dimensions are valid as long as a row
+ *  fits in memory.
  */
 static inline bool SkImageInfoIsValid(const SkImageInfo& info) {
     if (info.width() <= 0 || info.height() <= 0) {
         return false;
     }
 
-    const int kMaxDimension = SK_MaxS32 >> 2;
-    if (info.width() > kMaxDimension || info.height() > kMaxDimension) {
+    if (info.minRowBytes() == 0) {
         return false;
     }
 
@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include <sk_oriented_rows.h>
+
+// Rotated blocks span this many bytes of each src row, one cache line.
+static constexpr int kBlockBytes = 64;
+
+static SkPixmap oriented_shape(const SkImageInfo& info, SkEncodedOrigin origin) {
+    SkImageInfo oriented = info;
+    if (SkEncodedOriginSwapsWidthHeight(origin)) {
+        oriented = info.makeWH(info.height(), info.width());
+    }
+    return SkPixmap(oriented, nullptr, oriented.minRowBytes());
+}
+
+static int block_rows(const SkImageInfo& info, SkEncodedOrigin origin) {
+    if (SkEncodedOriginSwapsWidthHeight(origin)) {
+        return std::max(1, kBlockBytes / info.bytesPerPixel());
+    }
+    return 1;
+}
+
+static bool needs_block(SkEncodedOrigin origin) {
+    return origin != kTopLeft_SkEncodedOrigin && origin != kBottomLeft_SkEncodedOrigin;
+}
+
+template <typename T>
+static void mirror_row(T* dst, const T* src, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = src[width - 1 - x];
+    }
+}
+
+// Fills |rows| oriented rows of |width| pixels, where oriented pixel (x, i) is src pixel
+// (firstCol + i * colStep, firstRow + x * rowStep).
+template <typename T>
+static void gather_columns(T* dst, int width, int rows, const SkPixmap& src,
+                           int firstCol, int colStep, int firstRow, int rowStep) {
+    for (int x = 0; x < width; x++) {
+        const T* srcRow = (const T*)src.addr(0, firstRow + x * rowStep) + firstCol;
+        T* dstPixel = dst + x;
+        for (int i = 0; i < rows; i++) {
+            *dstPixel = srcRow[i * colStep];
+            dstPixel += width;
+        }
+    }
+}
+
+template <typename T>
+static void fill_block(T* dst, const SkPixmap& src, SkEncodedOrigin origin, int top, int rows) {
+    const int w = src.width(), h = src.height();
+    switch (origin) {
+        case kTopRight_SkEncodedOrigin:
+            mirror_row(dst, (const T*)src.addr(0, top), w);
+            break;
+        case kBottomRight_SkEncodedOrigin:
+            mirror_row(dst, (const T*)src.addr(0, h - 1 - top), w);
+            break;
+        case kLeftTop_SkEncodedOrigin:
+            gather_columns(dst, h, rows, src, top, 1, 0, 1);
+            break;
+        case kRightTop_SkEncodedOrigin:
+            gather_columns(dst, h, rows, src, top, 1, h - 1, -1);
+            break;
+        case kRightBottom_SkEncodedOrigin:
+            gather_columns(dst, h, rows, src, w - 1 - top, -1, h - 1, -1);
+            break;
+        case kLeftBottom_SkEncodedOrigin:
+            gather_columns(dst, h, rows, src, w - 1 - top, -1, 0, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+SkOrientedRows::SkOrientedRows(const SkPixmap& src, SkEncodedOrigin origin)
+    : fSrc(src)
+    , fOrigin(origin)
+    , fShape(oriented_shape(src.info(), origin))
+    , fBlockRows(block_rows(src.info(), origin))
+    , fBlock(needs_block(origin) ? fBlockRows * fShape.rowBytes() : 0)
+    , fBlockTop(-1)
+{}
+
+const void* SkOrientedRows::row(int y) {
+    switch (fOrigin) {
+        case kTopLeft_SkEncodedOrigin:
+            return fSrc.addr(0, y);
+        case kBottomLeft_SkEncodedOrigin:
+            return fSrc.addr(0, fSrc.height() - 1 - y);
+        default:
+            break;
+    }
+
+    if (fBlockTop < 0 || y < fBlockTop || y >= fBlockTop + fBlockRows) {
+        this->fillBlock(y - y % fBlockRows);
+    }
+    return fBlock.get() + (y - fBlockTop) * fShape.rowBytes();
+}
+
+size_t SkOrientedRows::ScratchBytes(const SkImageInfo& info, SkEncodedOrigin origin) {
+    if (!needs_block(origin)) {
+        return 0;
+    }
+    return block_rows(info, origin) * oriented_shape(info, origin).rowBytes();
+}
+
+void SkOrientedRows::fillBlock(int top) {
+    const int rows = std::min(fBlockRows, fShape.height() - top);
+    switch (fSrc.info().bytesPerPixel()) {
+        case 1:
+            fill_block((uint8_t*)fBlock.get(), fSrc, fOrigin, top, rows);
+            break;
+        case 2:
+            fill_block((uint16_t*)fBlock.get(), fSrc, fOrigin, top, rows);
+            break;
+        case 4:
+            fill_block((uint32_t*)fBlock.get(), fSrc, fOrigin, top, rows);
+            break;
+        case 8:
+            fill_block((uint64_t*)fBlock.get(), fSrc, fOrigin, top, rows);
+            break;
+    }
+    fBlockTop = top;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <sk_encoded_origin.h>
+#include <sk_pixmap.h>
+#include <sk_templates_private.h>
+
+/**
+ *  Presents the rows of |src| as they appear once displayed with |origin| applied, so an
+ *  encoder can write a flipped or rotated image in the same pass that reads the pixels.
+ *
+ *  Vertical flips walk the src rows bottom-up and hand them out in place.  Mirrored and
+ *  rotated orientations are produced a block of rows at a time into scratch storage; for the
+ *  90 degree cases each block covers a cache line's worth of src columns, so every src row
+ *  is read one cache line at a time rather than one pixel at a time.
+ */
+class SkOrientedRows {
+public:
+    SkOrientedRows(const SkPixmap& src, SkEncodedOrigin origin);
+
+    /**
+     *  A pixmap without pixels describing the oriented image.
+     */
+    const SkPixmap& shape() const { return fShape; }
+
+    /**
+     *  Returns oriented row |y|.  The pointer stays valid until a row from a different block
+     *  is requested, so rows should be read top to bottom.
+     */
+    const void* row(int y);
+
+    /**
+     *  Bytes of scratch storage a src of |info| needs to be presented with |origin|.
+     */
+    static size_t ScratchBytes(const SkImageInfo& info, SkEncodedOrigin origin);
+
+private:
+    void fillBlock(int top);
+
+    const SkPixmap         fSrc;
+    const SkEncodedOrigin  fOrigin;
+    const SkPixmap         fShape;
+    const int              fBlockRows;
+    SkAutoTMalloc<uint8_t> fBlock;
+    int                    fBlockTop;
+};
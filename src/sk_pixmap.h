@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 
 #include <sk_color.h>
 #include <sk_image_info.h>
+#include <sk_rect.h>
 
 /** \class SkPixmap
     SkPixmap provides a utility to pair SkImageInfo with pixels and row bytes.
@@ -75,7 +77,9 @@ public:
         @param colorSpace  SkColorSpace moved to SkImageInfo
         example: https://fiddle.skia.org/c/@Pixmap_setColorSpace
     */
-    void setColorSpace(void *colorSpace = nullptr);
+    void setColorSpace(std::shared_ptr<SkColorSpace> colorSpace) {
+        fInfo = fInfo.makeColorSpace(std::move(colorSpace));
+    }
 
     /** Returns width, height, SkAlphaType, SkColorType, and SkColorSpace.
         @return  reference to SkImageInfo
@@ -121,7 +125,7 @@ public:
         immutable.
         @return  SkColorSpace in SkImageInfo, or nullptr
     */
-    void* colorSpace() const { return nullptr; }
+    SkColorSpace* colorSpace() const { return fInfo.colorSpace(); }
 
     /** Returns smart pointer to SkColorSpace, the range of colors, associated with
         SkImageInfo. The smart pointer tracks the number of objects sharing this
@@ -129,7 +133,7 @@ public:
         The returned SkColorSpace is immutable.
         @return  SkColorSpace in SkImageInfo wrapped in a smart pointer
     */
-    void* refColorSpace() const { return nullptr; }
+    std::shared_ptr<SkColorSpace> refColorSpace() const { return fInfo.refColorSpace(); }
 
     /** Returns true if SkAlphaType is kOpaque_SkAlphaType.
         Does not check if SkColorType allows alpha, or if any pixel value has
@@ -159,6 +163,25 @@ public:
     */
     size_t computeByteSize() const { return fInfo.computeByteSize(fRowBytes); }
 
+    /** Sets subset width, height, pixel address to intersection of SkPixmap with area,
+        if intersection is not empty; and return true. Otherwise, leave subset unchanged
+        and return false.
+        @param subset  storage for width, height, pixel address of intersection
+        @param area    bounds to intersect with SkPixmap
+        @return        true if intersection of SkPixmap and area is not empty
+    */
+    bool extractSubset(SkPixmap* subset, const SkIRect& area) const {
+        const SkIRect r = SkIRect::MakeLTRB(std::max(area.fLeft, 0), std::max(area.fTop, 0),
+                                            std::min(area.fRight, this->width()),
+                                            std::min(area.fBottom, this->height()));
+        if (r.isEmpty()) {
+            return false;
+        }
+        *subset = SkPixmap(fInfo.makeWH(r.width(), r.height()), this->addr(r.fLeft, r.fTop),
+                           fRowBytes);
+        return true;
+    }
+
     /** Returns true if all pixels are opaque. SkColorType determines how pixels
         are encoded, and whether pixel describes alpha. Returns true for SkColorType
         without alpha in each pixel; for other SkColorType, returns true if all
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <sk_png_content_class.h>
+
+// Rows measured, each against the row above it.  Enough to see a screenshot's panels and
+// text without costing more than a fraction of a percent of the encode.
+static constexpr int kSampleRows = 32;
+
+// One more than a palette holds.
+static constexpr int kMaxCountedColors = 257;
+
+// UI keeps most bytes exactly predicted even where antialiasing and gradients add colors;
+// photo noise leaves about half of them off by one or more.
+static constexpr float kFlatPredictedBytes = 0.7f;
+
+// Uniformly random bytes leave a mean residual of 64; predictable content stays far below.
+static constexpr float kNoiseResidual = 40;
+
+namespace {
+// Counts distinct pixel values up to kMaxCountedColors with open addressing.
+class ColorCounter {
+public:
+    ColorCounter() { memset(fUsed, 0, sizeof(fUsed)); }
+
+    int count() const { return fCount; }
+    bool full() const { return fCount >= kMaxCountedColors; }
+
+    void add(uint32_t color) {
+        uint32_t i = (color * 2654435761u) >> (32 - kBits);
+        while (fUsed[i]) {
+            if (fColors[i] == color) {
+                return;
+            }
+            i = (i + 1) & (kSlots - 1);
+        }
+        fUsed[i] = true;
+        fColors[i] = color;
+        fCount++;
+    }
+
+private:
+    // At most half full, so probes stay short.
+    static constexpr int kBits = 10;
+    static constexpr int kSlots = 1 << kBits;
+
+    uint32_t fColors[kSlots];
+    bool     fUsed[kSlots];
+    int      fCount = 0;
+};
+}
+
+static int paeth_residual(int a, int b, int c, int x) {
+    const int p = a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    const int predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+    // Residuals are stored modulo 256, so a difference of 255 costs as little as 1.
+    return abs((int)(int8_t)(uint8_t)(x - predicted));
+}
+
+SkPngContentClass SkClassifyPngContent(const SkPixmap& src, SkPngContentStats* stats) {
+    SkPngContentStats measured;
+    switch (src.colorType()) {
+        case kAlpha_8_SkColorType:
+        case kGray_8_SkColorType:
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType:
+            break;
+        default:
+            if (stats) {
+                *stats = measured;
+            }
+            return SkPngContentClass::kUnknown;
+    }
+
+    const int w = src.width(), h = src.height();
+    const int bpp = src.info().bytesPerPixel();
+    const size_t rowBytes = src.info().minRowBytes();
+    const int rows = std::min(kSampleRows, h - 1);
+
+    ColorCounter colors;
+    uint64_t residual = 0, predicted = 0;
+    int repeated = 0;
+    for (int i = 0; i < rows; i++) {
+        const int y = 1 + (int)((int64_t)i * (h - 1) / rows);
+        const uint8_t* row = (const uint8_t*)src.addr(0, y);
+        const uint8_t* above = (const uint8_t*)src.addr(0, y - 1);
+        if (memcmp(row, above, rowBytes) == 0) {
+            repeated++;
+            continue;
+        }
+
+        for (size_t j = 0; j < rowBytes; j++) {
+            const int a = j < (size_t)bpp ? 0 : row[j - bpp];
+            const int c = j < (size_t)bpp ? 0 : above[j - bpp];
+            const int r = paeth_residual(a, above[j], c, row[j]);
+            residual += r;
+            predicted += r == 0;
+        }
+        for (int x = 0; x < w && !colors.full(); x++) {
+            uint32_t color = 0;
+            memcpy(&color, row + x * bpp, bpp);
+            colors.add(color);
+        }
+    }
+
+    // A single row has nothing above it to measure; treat it as one unrepeated row of colors.
+    if (rows <= 0) {
+        for (int x = 0; x < w && !colors.full(); x++) {
+            uint32_t color = 0;
+            memcpy(&color, src.addr(x, 0), bpp);
+            colors.add(color);
+        }
+    }
+
+    measured.fColors = colors.count();
+    if (rows > 0) {
+        // Repeated rows count as residual-free, as filtering Up makes them.
+        measured.fResidual = (float)residual / ((float)rows * rowBytes);
+        measured.fRepeatedRows = (float)repeated / rows;
+        if (repeated < rows) {
+            measured.fPredictedBytes = (float)predicted / ((float)(rows - repeated) * rowBytes);
+        }
+    }
+    if (stats) {
+        *stats = measured;
+    }
+
+    if (measured.fColors < kMaxCountedColors || measured.fPredictedBytes >= kFlatPredictedBytes) {
+        return SkPngContentClass::kFlat;
+    }
+    if (measured.fResidual >= kNoiseResidual) {
+        return SkPngContentClass::kNoise;
+    }
+    return SkPngContentClass::kContinuousTone;
+}
+
+void SkApplyPngContentClass(SkPngContentClass contentClass, SkPngEncoder::Options* options) {
+    using FilterFlag = SkPngEncoder::FilterFlag;
+    using ZLibStrategy = SkPngEncoder::Options::ZLibStrategy;
+    const FilterFlag subUp = FilterFlag::kSub | FilterFlag::kUp;
+
+    switch (contentClass) {
+        case SkPngContentClass::kFlat:
+            // Repeated glyphs and panels are long matches, which a full search at a
+            // moderate level finds; Sub and Up flatten the runs between them.
+            options->fFilterFlags = subUp;
+            options->fZLibStrategy = ZLibStrategy::kDefault;
+            options->fZLibLevel = 3;
+            break;
+        case SkPngContentClass::kContinuousTone:
+            // Filtered residuals rarely repeat far back, so run-length matching loses
+            // nothing to a full search and skips its cost.  Paeth buys little over Sub and
+            // Up once deflate only looks for runs.
+            options->fFilterFlags = subUp;
+            options->fZLibStrategy = ZLibStrategy::kRLE;
+            options->fZLibLevel = 1;
+            break;
+        case SkPngContentClass::kNoise:
+            // There are no matches worth searching for, but entropy coding still shrinks
+            // whatever channels are not random, such as a constant alpha.
+            options->fFilterFlags = FilterFlag::kNone;
+            options->fZLibStrategy = ZLibStrategy::kHuffmanOnly;
+            options->fZLibLevel = 1;
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <sk_pixmap.h>
+#include <sk_png_encoder.h>
+
+/**
+ *  How an image's rows are expected to compress, judged from a sample of them.
+ */
+enum class SkPngContentClass {
+    /** Not a format the classifier measures; the encoder options are left as they are. */
+    kUnknown,
+    /** Few colors or mostly exact predictions, e.g. UI and text.  Long matches pay for a
+        higher zlib level. */
+    kFlat,
+    /** Many colors whose neighbours predict them, e.g. photos and gradients. */
+    kContinuousTone,
+    /** Residuals as large as random data; deflate cannot shrink it. */
+    kNoise,
+};
+
+/**
+ *  What SkClassifyPngContent() measured over the sampled rows.
+ */
+struct SkPngContentStats {
+    /** Distinct pixel values, counted up to one more than a palette holds. */
+    int fColors = 0;
+
+    /** Mean magnitude of the Paeth residual per byte, in [0, 128]. */
+    float fResidual = 0;
+
+    /** Fraction of the bytes of unrepeated sampled rows that Paeth predicts exactly. */
+    float fPredictedBytes = 0;
+
+    /** Fraction of the sampled rows that repeat the row above them. */
+    float fRepeatedRows = 0;
+};
+
+/**
+ *  Classifies |src| from a few rows spread over its height.  Only formats with 8-bit
+ *  channels are measured; others are kUnknown.  |stats| may be null.
+ */
+SkPngContentClass SkClassifyPngContent(const SkPixmap& src, SkPngContentStats* stats = nullptr);
+
+/**
+ *  Sets the filters, zlib strategy and zlib level of |options| that encode |contentClass|
+ *  fastest without growing the output.  kUnknown leaves |options| unchanged.
+ */
+void SkApplyPngContentClass(SkPngContentClass contentClass, SkPngEncoder::Options* options);
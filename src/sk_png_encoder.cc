@@ -1,14 +1,25 @@
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 #include <sk_png_encoder.h>
-#include <sk_image_encoder_fns.h>
+#include <sk_color_space_xform_row.h>
+#include <sk_executor.h>
+#include <sk_fast_deflate.h>
 #include <sk_image_encoder_private.h>
 #include <sk_msan.h>
+#include <sk_row_transform.h>
 
 #include <skcms.h>
 #include <png.h>
+#include <zlib.h>
 
 static_assert(PNG_FILTER_NONE  == (int)SkPngEncoder::FilterFlag::kNone,  "Skia libpng filter err.");
 static_assert(PNG_FILTER_SUB   == (int)SkPngEncoder::FilterFlag::kSub,   "Skia libpng filter err.");
@@ -34,24 +45,168 @@ static void sk_write_fn(png_structp png_ptr, png_bytep data, png_size_t len) {
     }
 }
 
+// What libpng's filter heuristic adds up for a filtered byte: its distance from zero, mod 256.
+static inline unsigned filter_cost(uint8_t v) {
+    return v < 128 ? v : 256 - v;
+}
+
+// True when libpng, choosing among |filters| for a |row| of one repeated pixel below |above|,
+// would pick Sub.  It picks the filter whose filtered bytes cost least, the earlier one on a
+// tie, in the order None, Sub, Up, Avg, Paeth.  Sub leaves only the first pixel, and None
+// that pixel over again for every other one; the rest are summed only until they reach Sub.
+static bool libpng_picks_sub(const uint8_t* row, const uint8_t* above, size_t rowBytes,
+                             int bytesPerPixel, int filters) {
+    unsigned sub = 0;
+    for (int i = 0; i < bytesPerPixel; i++) {
+        sub += filter_cost(row[i]);
+    }
+    if (sub == 0 && (filters & PNG_FILTER_NONE)) {
+        return false;
+    }
+
+    if (filters & PNG_FILTER_UP) {
+        unsigned sum = 0;
+        for (size_t i = 0; i < rowBytes && sum < sub; i++) {
+            sum += filter_cost(row[i] - above[i]);
+        }
+        if (sum < sub) {
+            return false;
+        }
+    }
+    if (filters & PNG_FILTER_AVG) {
+        unsigned sum = 0;
+        for (size_t i = 0; i < rowBytes && sum < sub; i++) {
+            const int left = i < (size_t)bytesPerPixel ? 0 : row[i - bytesPerPixel];
+            sum += filter_cost(row[i] - ((left + above[i]) >> 1));
+        }
+        if (sum < sub) {
+            return false;
+        }
+    }
+    if (filters & PNG_FILTER_PAETH) {
+        unsigned sum = 0;
+        for (size_t i = 0; i < rowBytes && sum < sub; i++) {
+            const bool first = i < (size_t)bytesPerPixel;
+            const int a = first ? 0 : row[i - bytesPerPixel],
+                      b = above[i],
+                      c = first ? 0 : above[i - bytesPerPixel];
+            const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+            sum += filter_cost(row[i] - (pa <= pb && pa <= pc ? a : pb <= pc ? b : c));
+        }
+        if (sum < sub) {
+            return false;
+        }
+    }
+    return true;
+}
+
 class SkPngEncoderMgr final {
 public:
 
     /*
      * Create the decode manager
-     * Does not take ownership of stream
+     * Does not take ownership of stream or limits
      */
-    static std::unique_ptr<SkPngEncoderMgr> Make(SkWStream* stream);
+    static std::unique_ptr<SkPngEncoderMgr> Make(SkWStream* stream, SkEncodeLimits* limits);
 
     bool setHeader(const SkImageInfo& srcInfo, const SkPngEncoder::Options& options);
-    bool setColorSpace(const SkImageInfo& info);
+    bool setColorSpace(const SkImageInfo& info, const SkPngEncoder::Options& options);
     bool writeInfo(const SkImageInfo& srcInfo);
-    void chooseProc(const SkImageInfo& srcInfo);
+    bool chooseTransform(const SkImageInfo& srcInfo);
+
+    // Replaces the header setHeader() chose with a one-bit palette png whose only entry is
+    // |pngPixel|, a pixel in the format setHeader() chose.
+    bool setUniformHeader(const SkImageInfo& srcInfo, const uint8_t* pngPixel);
+
+    // Converts |rows| src rows of |width| pixels, |srcRowBytes| apart, into png rows
+    // |dstRowBytes| apart.
+    void transformRows(char* dst, size_t dstRowBytes, const char* src, size_t srcRowBytes,
+                       int width, int rows) const {
+        if (!fConvertColorSpace) {
+            (*fTransform)(dst, dstRowBytes, src, srcRowBytes, width, rows);
+            return;
+        }
+        for (int y = 0; y < rows; y++) {
+            fXform(dst + y * dstRowBytes, src + y * srcRowBytes, width);
+        }
+    }
+
+    // How a src row relates to the row before it and to itself.
+    enum class RowHint {
+        kNone,
+        kRepeat,   // identical to the row before it
+        kUniform,  // one pixel repeated across the row
+    };
+
+    // True when rows of one color may be filled from one transformed pixel.  Every row
+    // transform converts a pixel alone as it does within a row, so this is any row of more
+    // than one pixel.
+    bool fillsUniformRows() const {
+        return fPngRowBytes > (size_t)fPngBytesPerPixel;
+    }
+
+    // Converts one src pixel and repeats it across a png row of |width| pixels.
+    void transformUniformRow(char* dst, const char* src, int width) const {
+        this->transformRows(dst, 0, src, 0, 1, 1);
+        const size_t rowBytes = (size_t)fPngBytesPerPixel * width;
+        for (size_t filled = fPngBytesPerPixel; filled < rowBytes; filled *= 2) {
+            memcpy(dst + filled, dst, std::min(filled, rowBytes - filled));
+        }
+    }
+
+    // Writes the next png row.  A repeated row filters to zeros with Up, and a uniform row to
+    // zeros past its first pixel with Sub, so they get that filter instead of libpng trying
+    // each one on them.  A row of zeros is zeros already; None keeps a stretch of them one run
+    // of zeros for zlib.  Those are the filters libpng would pick; a uniform row only gets Sub
+    // when libpng_picks_sub() says so against the row before it, and is otherwise left to
+    // libpng, so the output is what libpng writes on its own.  libpng picks the buffers the
+    // filters need from the filters set for the first row, so that row keeps them all.
+    //
+    // A uniform row of the same color as a uniform row before it is a repeat too, which is
+    // noticed even when the row before it is gone, so bands filter the same as whole images.
+    void writeRow(png_bytep row, RowHint hint) {
+        if (hint == RowHint::kUniform) {
+            if (fUniformPixelRows && memcmp(fUniformPixel, row, fPngBytesPerPixel) == 0) {
+                hint = RowHint::kRepeat;
+            }
+            memcpy(fUniformPixel, row, fPngBytesPerPixel);
+            fUniformPixelRows = true;
+        } else if (hint == RowHint::kNone) {
+            fUniformPixelRows = false;
+        }
+
+        int filters = fFilters;
+        if (hint != RowHint::kNone && fWroteRow) {
+            const bool zeros = row[0] == 0 && memcmp(row, row + 1, fPngRowBytes - 1) == 0;
+            if (zeros && (fFilters & PNG_FILTER_NONE)) {
+                filters = PNG_FILTER_NONE;
+            } else if (hint == RowHint::kRepeat && (fFilters & PNG_FILTER_UP)) {
+                filters = PNG_FILTER_UP;
+            } else if (hint == RowHint::kUniform && fAboveRow &&
+                       libpng_picks_sub(row, fAboveRow.get(), fPngRowBytes, fPngBytesPerPixel,
+                                        fFilters)) {
+                filters = PNG_FILTER_SUB;
+            }
+        }
+        if (filters != fRowFilters) {
+            png_set_filter(fPngPtr, PNG_FILTER_TYPE_BASE, filters);
+            fRowFilters = filters;
+        }
+        png_write_rows(fPngPtr, &row, 1);
+        if (fAboveRow) {
+            memcpy(fAboveRow.get(), row, fPngRowBytes);
+        }
+        fWroteRow = true;
+    }
 
     png_structp pngPtr() { return fPngPtr; }
     png_infop infoPtr() { return fInfoPtr; }
     int pngBytesPerPixel() const { return fPngBytesPerPixel; }
-    transform_scanline_proc proc() const { return fProc; }
+
+    // True when src rows are already laid out as png rows and go to libpng as they are.
+    bool passesRowsThrough() const {
+        return !fConvertColorSpace && fTransform->fIsCopy;
+    }
 
     ~SkPngEncoderMgr() {
         png_destroy_write_struct(&fPngPtr, &fInfoPtr);
@@ -59,18 +214,32 @@ public:
 
 private:
 
-    SkPngEncoderMgr(png_structp pngPtr, png_infop infoPtr)
+    SkPngEncoderMgr(png_structp pngPtr, png_infop infoPtr,
+                    std::unique_ptr<SkLimitedWStream> limitedStream)
         : fPngPtr(pngPtr)
         , fInfoPtr(infoPtr)
+        , fLimitedStream(std::move(limitedStream))
     {}
 
     png_structp             fPngPtr;
     png_infop               fInfoPtr;
     int                     fPngBytesPerPixel;
-    transform_scanline_proc fProc;
+    size_t                  fPngRowBytes;
+    int                     fFilters;
+    int                     fRowFilters;
+    bool                    fWroteRow = false;
+    uint8_t                 fUniformPixel[8];
+    bool                    fUniformPixelRows = false;
+    // The png row written last, kept when a uniform row may need it to choose Sub.
+    SkAutoTMalloc<uint8_t>  fAboveRow;
+    const SkRowTransform*   fTransform = nullptr;
+    SkColorSpaceXformRow    fXform;
+    bool                    fConvertColorSpace = false;
+    const std::vector<uint8_t>* fICCPChunk = nullptr;
+    std::unique_ptr<SkLimitedWStream> fLimitedStream;
 };
 
-std::unique_ptr<SkPngEncoderMgr> SkPngEncoderMgr::Make(SkWStream* stream) {
+std::unique_ptr<SkPngEncoderMgr> SkPngEncoderMgr::Make(SkWStream* stream, SkEncodeLimits* limits) {
     png_structp pngPtr =
             png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, sk_error_fn, nullptr);
     if (!pngPtr) {
@@ -83,8 +252,50 @@ std::unique_ptr<SkPngEncoderMgr> SkPngEncoderMgr::Make(SkWStream* stream) {
         return nullptr;
     }
 
+    // libpng refuses images over a million pixels wide or tall unless told otherwise; allow
+    // everything the format can describe.
+    png_set_user_limits(pngPtr, PNG_UINT_31_MAX, PNG_UINT_31_MAX);
+
+    std::unique_ptr<SkLimitedWStream> limitedStream;
+    if (limits) {
+        limitedStream.reset(new SkLimitedWStream(stream, limits));
+        stream = limitedStream.get();
+    }
+
     png_set_write_fn(pngPtr, (void*)stream, sk_write_fn, nullptr);
-    return std::unique_ptr<SkPngEncoderMgr>(new SkPngEncoderMgr(pngPtr, infoPtr));
+    return std::unique_ptr<SkPngEncoderMgr>(
+            new SkPngEncoderMgr(pngPtr, infoPtr, std::move(limitedStream)));
+}
+
+// Bytes per pixel of the png setHeader() writes for |info|, or 0 if it has no png format.
+static int png_bytes_per_pixel(const SkImageInfo& info) {
+    switch (info.colorType()) {
+        case kRGBA_F16_SkColorType:
+            return info.isOpaque() ? 6 : 8;
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType:
+            return info.isOpaque() ? 3 : 4;
+        case kRGB_565_SkColorType:
+            return 3;
+        case kAlpha_8_SkColorType:
+        case kGray_8_SkColorType:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int zlib_strategy(SkPngEncoder::Options::ZLibStrategy strategy) {
+    switch (strategy) {
+        case SkPngEncoder::Options::ZLibStrategy::kFiltered:
+            return Z_FILTERED;
+        case SkPngEncoder::Options::ZLibStrategy::kHuffmanOnly:
+            return Z_HUFFMAN_ONLY;
+        case SkPngEncoder::Options::ZLibStrategy::kRLE:
+            return Z_RLE;
+        default:
+            return Z_DEFAULT_STRATEGY;
+    }
 }
 
 bool SkPngEncoderMgr::setHeader(const SkImageInfo& srcInfo, const SkPngEncoder::Options& options) {
@@ -96,18 +307,38 @@ bool SkPngEncoderMgr::setHeader(const SkImageInfo& srcInfo, const SkPngEncoder::
     png_color_8 sigBit;
     int bitDepth = 8;
     switch (srcInfo.colorType()) {
+        case kRGBA_F16_SkColorType:
+            sigBit.red = 16;
+            sigBit.green = 16;
+            sigBit.blue = 16;
+            sigBit.alpha = 16;
+            bitDepth = 16;
+            pngColorType = srcInfo.isOpaque() ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
+            break;
+        case kRGBA_8888_SkColorType:
         case kBGRA_8888_SkColorType:
             sigBit.red = 8;
             sigBit.green = 8;
             sigBit.blue = 8;
             sigBit.alpha = 8;
             pngColorType = srcInfo.isOpaque() ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
-            fPngBytesPerPixel = srcInfo.isOpaque() ? 3 : 4;
+            break;
+        case kRGB_565_SkColorType:
+            sigBit.red = 5;
+            sigBit.green = 6;
+            sigBit.blue = 5;
+            pngColorType = PNG_COLOR_TYPE_RGB;
+            break;
+        case kAlpha_8_SkColorType:  // store coverage as the gray level
+        case kGray_8_SkColorType:
+            sigBit.gray = 8;
+            pngColorType = PNG_COLOR_TYPE_GRAY;
             break;
         default:
             return false;
     }
 
+    fPngBytesPerPixel = png_bytes_per_pixel(srcInfo);
     png_set_IHDR(fPngPtr, fInfoPtr, srcInfo.width(), srcInfo.height(),
                  bitDepth, pngColorType,
                  PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
@@ -117,10 +348,23 @@ bool SkPngEncoderMgr::setHeader(const SkImageInfo& srcInfo, const SkPngEncoder::
     int filters = (int)options.fFilterFlags & (int)SkPngEncoder::FilterFlag::kAll;
     assert(filters == (int)options.fFilterFlags);
     png_set_filter(fPngPtr, PNG_FILTER_TYPE_BASE, filters);
+    // libpng only keeps the previous row, which Up needs, when Up is in this first set.
+    fFilters = fRowFilters = filters;
+    fPngRowBytes = (size_t)fPngBytesPerPixel * srcInfo.width();
+    if ((filters & PNG_FILTER_SUB) && (filters & (filters - 1)) && this->fillsUniformRows()) {
+        fAboveRow.reset(fPngRowBytes);
+    }
 
     int zlibLevel = std::min(std::max(0, options.fZLibLevel), 9);
     assert(zlibLevel == options.fZLibLevel);
     png_set_compression_level(fPngPtr, zlibLevel);
+    if (options.fZLibStrategy != SkPngEncoder::Options::ZLibStrategy::kDefault) {
+        png_set_compression_strategy(fPngPtr, zlib_strategy(options.fZLibStrategy));
+    }
+
+    if (options.fWriteOffset) {
+        png_set_oFFs(fPngPtr, fInfoPtr, options.fOffsetX, options.fOffsetY, PNG_OFFSET_PIXEL);
+    }
 
     // Set comments in tEXt chunk
     const SkDataTable* comments = options.fComments;
@@ -152,33 +396,49 @@ bool SkPngEncoderMgr::setHeader(const SkImageInfo& srcInfo, const SkPngEncoder::
     return true;
 }
 
-static transform_scanline_proc choose_proc(const SkImageInfo& info) {
-    switch (info.colorType()) {
-        case kUnknown_SkColorType:
-            break;
-
-        case kBGRA_8888_SkColorType:
-            switch (info.alphaType()) {
-                case kPremul_SkAlphaType:
-                    return transform_scanline_bgrA;
-                default:
-                    assert(false);
-                    return nullptr;
-            }
+// The skcms format and alpha of the png pixels setHeader() chose for |info|.
+static void png_pixel_format(const SkImageInfo& info, skcms_PixelFormat* fmt,
+                             skcms_AlphaFormat* alpha) {
+    const bool opaque = info.isOpaque();
+    *alpha = opaque ? skcms_AlphaFormat_Opaque : skcms_AlphaFormat_Unpremul;
+    if (info.colorType() == kRGBA_F16_SkColorType) {
+        *fmt = opaque ? skcms_PixelFormat_RGB_161616BE : skcms_PixelFormat_RGBA_16161616BE;
+    } else {
+        *fmt = opaque ? skcms_PixelFormat_RGB_888 : skcms_PixelFormat_RGBA_8888;
     }
-    assert(false);
-    return nullptr;
-}
-
-static void set_icc(png_structp png_ptr, png_infop info_ptr, const SkImageInfo& info) {
-    return;
 }
 
-bool SkPngEncoderMgr::setColorSpace(const SkImageInfo& info) {
+bool SkPngEncoderMgr::setColorSpace(const SkImageInfo& info,
+                                    const SkPngEncoder::Options& options) {
     if (setjmp(png_jmpbuf(fPngPtr))) {
         return false;
     }
 
+    SkColorSpace* cs = info.colorSpace();
+    if (!cs) {
+        return true;
+    }
+
+    if (!cs->isSRGB() &&
+        options.fColorSpaceHandling == SkPngEncoder::Options::ColorSpaceHandling::kEmbed) {
+        // libpng would deflate the profile again for every image; write the chunk the
+        // color space keeps already compressed instead.
+        fICCPChunk = &cs->iccpChunk();
+        return !fICCPChunk->empty();
+    }
+
+    if (!cs->isSRGB()) {
+        skcms_PixelFormat fmt;
+        skcms_AlphaFormat alpha;
+        png_pixel_format(info, &fmt, &alpha);
+        fConvertColorSpace = fXform.init(info, fmt, alpha);
+        if (!fConvertColorSpace) {
+            // Gray and alpha rows have no gamut to convert; leave them untagged.
+            return true;
+        }
+    }
+
+    png_set_sRGB(fPngPtr, fInfoPtr, PNG_sRGB_INTENT_PERCEPTUAL);
     return true;
 }
 
@@ -187,12 +447,85 @@ bool SkPngEncoderMgr::writeInfo(const SkImageInfo& srcInfo) {
         return false;
     }
 
+    if (fICCPChunk) {
+        // iCCP has to precede PLTE and IDAT, which png_write_info_before_PLTE leaves room for.
+        png_write_info_before_PLTE(fPngPtr, fInfoPtr);
+        png_write_chunk(fPngPtr, (png_const_bytep)"iCCP",
+                        fICCPChunk->data(), fICCPChunk->size());
+    }
     png_write_info(fPngPtr, fInfoPtr);
     return true;
 }
 
-void SkPngEncoderMgr::chooseProc(const SkImageInfo& srcInfo) {
-    fProc = choose_proc(srcInfo);
+bool SkPngEncoderMgr::chooseTransform(const SkImageInfo& srcInfo) {
+    fTransform = SkChooseRowTransform(srcInfo, SkRowDst::kPng);
+    return fTransform && fTransform->fDstBytesPerPixel == fPngBytesPerPixel;
+}
+
+bool SkPngEncoderMgr::setUniformHeader(const SkImageInfo& srcInfo, const uint8_t* pngPixel) {
+    if (setjmp(png_jmpbuf(fPngPtr))) {
+        return false;
+    }
+
+    png_color color;
+    color.red = pngPixel[0];
+    color.green = fPngBytesPerPixel == 1 ? pngPixel[0] : pngPixel[1];
+    color.blue = fPngBytesPerPixel == 1 ? pngPixel[0] : pngPixel[2];
+
+    png_set_IHDR(fPngPtr, fInfoPtr, srcInfo.width(), srcInfo.height(),
+                 1, PNG_COLOR_TYPE_PALETTE,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
+                 PNG_FILTER_TYPE_BASE);
+    png_set_PLTE(fPngPtr, fInfoPtr, &color, 1);
+    if (fPngBytesPerPixel == 4 && pngPixel[3] != 0xFF) {
+        png_set_tRNS(fPngPtr, fInfoPtr, &pngPixel[3], 1, nullptr);
+    }
+    // Every bit of the palette entry is significant.
+    png_set_invalid(fPngPtr, fInfoPtr, PNG_INFO_sBIT);
+
+    // The rows are all zeros, which run-length matching finds as well as a full search.
+    fFilters = fRowFilters = PNG_FILTER_NONE;
+    fAboveRow.reset(0);
+    png_set_filter(fPngPtr, PNG_FILTER_TYPE_BASE, fFilters);
+    png_set_compression_strategy(fPngPtr, Z_RLE);
+    fPngRowBytes = ((size_t)srcInfo.width() + 7) / 8;
+    return true;
+}
+
+static bool write_chunk(png_structp pngPtr, const char* name, const void* data, size_t size) {
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        return false;
+    }
+    png_write_chunk(pngPtr, (png_const_bytep)name, (png_const_bytep)data, size);
+    return true;
+}
+
+namespace {
+// Writes each piece of the fast engine's deflate stream as an IDAT.  libpng wrote the chunks
+// before them and never starts deflating itself, so it is left to write the chunks alone.
+class SkPngIDATStream final : public SkWStream {
+public:
+    explicit SkPngIDATStream(png_structp pngPtr) : fPngPtr(pngPtr) {}
+
+    bool write(const void* buffer, size_t size) override {
+        fBytesWritten += size;
+        return write_chunk(fPngPtr, "IDAT", buffer, size);
+    }
+
+    size_t bytesWritten() const override { return fBytesWritten; }
+
+private:
+    png_structp fPngPtr;
+    size_t      fBytesWritten = 0;
+};
+}
+
+// True when the first row of |src| is one pixel repeated, so all of |src| may be that color.
+static bool first_row_is_uniform(const SkPixmap& src) {
+    const char* first = (const char*)src.addr();
+    const size_t rowBytes = src.info().minRowBytes();
+    const int bytesPerPixel = src.info().bytesPerPixel();
+    return memcmp(first, first + bytesPerPixel, rowBytes - bytesPerPixel) == 0;
 }
 
 std::unique_ptr<SkEncoder> SkPngEncoder::Make(SkWStream* dst, const SkPixmap& src,
@@ -201,7 +534,42 @@ std::unique_ptr<SkEncoder> SkPngEncoder::Make(SkWStream* dst, const SkPixmap& sr
         return nullptr;
     }
 
-    std::unique_ptr<SkPngEncoderMgr> encoderMgr = SkPngEncoderMgr::Make(dst);
+    // A palette entry has no room for 16-bit channels.  Only the first row is read here; the
+    // rest is read by the first calls to encodeRows(), before the header is written.
+    const bool mayBeUniform = src.colorType() != kRGBA_F16_SkColorType &&
+                              first_row_is_uniform(src);
+    std::unique_ptr<SkOrientedRows> rows;
+    if (options.fOrigin != kTopLeft_SkEncodedOrigin) {
+        rows.reset(new SkOrientedRows(src, options.fOrigin));
+    }
+
+    std::unique_ptr<SkPngEncoder> encoder =
+            MakeImpl(dst, rows ? rows->shape() : src, options, !mayBeUniform);
+    if (!encoder) {
+        return nullptr;
+    }
+    if (mayBeUniform) {
+        encoder->fUniformSrc = src;
+        encoder->fUniformRows = 1;
+    }
+    if (rows) {
+        encoder->setOrientedRows(std::move(rows));
+    }
+    return encoder;
+}
+
+std::unique_ptr<SkEncoder> SkPngEncoder::MakeForRows(SkWStream* dst, const SkPixmap& shape,
+                                                     const Options& options) {
+    if (!SkImageInfoIsValid(shape.info())) {
+        return nullptr;
+    }
+
+    return MakeImpl(dst, shape, options, true);
+}
+
+std::unique_ptr<SkPngEncoder> SkPngEncoder::MakeImpl(SkWStream* dst, const SkPixmap& src,
+                                                     const Options& options, bool writeInfo) {
+    std::unique_ptr<SkPngEncoderMgr> encoderMgr = SkPngEncoderMgr::Make(dst, options.fLimits);
     if (!encoderMgr) {
         return nullptr;
     }
@@ -210,43 +578,405 @@ std::unique_ptr<SkEncoder> SkPngEncoder::Make(SkWStream* dst, const SkPixmap& sr
         return nullptr;
     }
 
-    if (!encoderMgr->setColorSpace(src.info())) {
+    if (!encoderMgr->setColorSpace(src.info(), options)) {
         return nullptr;
     }
 
-    if (!encoderMgr->writeInfo(src.info())) {
+    if (!encoderMgr->chooseTransform(src.info())) {
         return nullptr;
     }
 
-    encoderMgr->chooseProc(src.info());
+    if (writeInfo && !encoderMgr->writeInfo(src.info())) {
+        return nullptr;
+    }
 
-    return std::unique_ptr<SkPngEncoder>(new SkPngEncoder(std::move(encoderMgr), src));
+    std::unique_ptr<SkPngEncoder> encoder(new SkPngEncoder(std::move(encoderMgr), src));
+    encoder->setLimits(options.fLimits);
+    encoder->fPipelined = options.fPipelined;
+    if (options.fEngine == Options::Engine::kFast) {
+        // The first row is filtered Up against zeros, which leaves it as it is.
+        const int bytesPerPixel = encoder->fEncoderMgr->pngBytesPerPixel();
+        const size_t rowBytes = (size_t)bytesPerPixel * src.width();
+        encoder->fIDATStream.reset(new SkPngIDATStream(encoder->fEncoderMgr->pngPtr()));
+        encoder->fFastDeflate.reset(new SkFastDeflate(encoder->fIDATStream.get(), bytesPerPixel));
+        encoder->fFastRows.reset(2 * rowBytes + 1);
+        memset(encoder->fFastRows.get(), 0, rowBytes);
+    }
+    return encoder;
+}
+
+bool SkPngEncoder::scanUniform(int numRows) {
+    const SkPixmap& src = fUniformSrc;
+    const size_t rowBytes = src.info().minRowBytes();
+    bool uniform = !fBand;
+
+    // As many src pixels as |numRows| encoded rows hold, whichever way the image is turned.
+    const uint64_t pixels = (uint64_t)numRows * fSrc.width();
+    const uint64_t srcRows = (pixels + src.width() - 1) / src.width();
+    const int end = (int)std::min<uint64_t>(src.height(), fUniformRows + srcRows);
+    for (; uniform && fUniformRows < end; fUniformRows++) {
+        if (!this->checkLimits()) {
+            return false;
+        }
+        uniform = memcmp(src.addr(), src.addr(0, fUniformRows), rowBytes) == 0;
+    }
+    if (uniform && fUniformRows < src.height()) {
+        return true;
+    }
+
+    const void* pixel = src.addr();
+    fUniformSrc = SkPixmap();
+    if (!uniform) {
+        return fEncoderMgr->writeInfo(fSrc.info());
+    }
+
+    uint8_t pngPixel[4];
+    fEncoderMgr->transformRows((char*)pngPixel, 0, (const char*)pixel, 0, 1, 1);
+    if (!fEncoderMgr->setUniformHeader(fSrc.info(), pngPixel) ||
+        !fEncoderMgr->writeInfo(fSrc.info())) {
+        return false;
+    }
+
+    // Every pixel is palette index zero; the row is kept in fStorage, which is larger.
+    fUniform = true;
+    memset(fStorage.get(), 0, ((size_t)fSrc.width() + 7) / 8);
+    return true;
 }
 
 SkPngEncoder::SkPngEncoder(std::unique_ptr<SkPngEncoderMgr> encoderMgr, const SkPixmap& src)
-    : INHERITED(src, encoderMgr->pngBytesPerPixel() * src.width())
+    : INHERITED(src, (size_t)encoderMgr->pngBytesPerPixel() * src.width())
     , fEncoderMgr(std::move(encoderMgr))
 {}
 
 SkPngEncoder::~SkPngEncoder() {}
 
+// Rows handed from the transform task to the encoding thread at a time, and the number of
+// such blocks that may be in flight. Smaller runs are not worth starting a task for.
+static constexpr int kPipelineRowsPerBlock = 16;
+static constexpr int kPipelineBlocks = 4;
+static constexpr int kMinPipelinedRows = 4 * kPipelineRowsPerBlock;
+
+namespace {
+struct PipelineBlock {
+    SkAutoTMalloc<uint8_t> fPixels;
+    int                    fRows;
+    // After the first row of the block, repeated rows are not transformed; the png row
+    // before them is written again.
+    SkPngEncoderMgr::RowHint fHints[kPipelineRowsPerBlock];
+};
+
+// Blocks shared by the encoding thread and an executor task that transforms them ahead of
+// it.  Whichever of the two finds the next block untaken transforms it, one block at a time,
+// so the encoding thread never waits for a task no pool thread has picked up.  The task holds
+// its own reference: it may start after the encode is over, and then returns untouched.
+struct Pipeline {
+    std::mutex                               fLock;
+    std::condition_variable                  fCV;
+    PipelineBlock                            fBlocks[kPipelineBlocks];
+    std::function<bool(int, PipelineBlock*)> fTransform;
+    int                                      fNumBlocks = 0;
+    int                                      fProduced = 0;
+    int                                      fConsumed = 0;
+    bool                                     fProducing = false;
+    bool                                     fFailed = false;
+    bool                                     fStopped = false;
+
+    /** Transforms the next block.  |lock| holds fLock, and is released meanwhile. */
+    void produce(std::unique_lock<std::mutex>* lock) {
+        const int b = fProduced;
+        fProducing = true;
+        lock->unlock();
+        const bool ok = fTransform(b, &fBlocks[b % kPipelineBlocks]);
+        lock->lock();
+        fProducing = false;
+        if (ok) {
+            fProduced++;
+        } else {
+            fFailed = true;
+        }
+        fCV.notify_all();
+    }
+
+    /** Runs on the executor, transforming blocks while there is room for them. */
+    static void Run(std::shared_ptr<Pipeline> pipeline) {
+        std::unique_lock<std::mutex> lock(pipeline->fLock);
+        for (;;) {
+            pipeline->fCV.wait(lock, [&] {
+                return pipeline->fStopped || pipeline->fFailed ||
+                       pipeline->fProduced == pipeline->fNumBlocks ||
+                       (!pipeline->fProducing &&
+                        pipeline->fProduced - pipeline->fConsumed < kPipelineBlocks);
+            });
+            if (pipeline->fStopped || pipeline->fFailed ||
+                pipeline->fProduced == pipeline->fNumBlocks) {
+                return;
+            }
+            pipeline->produce(&lock);
+        }
+    }
+};
+}
+
+// Screenshots repeat whole rows of background, and backgrounds and gradients fill rows with
+// one color; those rows skip most of the transform and filter work.  A row is compared with
+// the one |stride| bytes before it when |hasPrevious|.
+static SkPngEncoderMgr::RowHint classify_row(const char* row, size_t stride, size_t rowBytes,
+                                             int bytesPerPixel, bool hasPrevious,
+                                             bool uniformRows) {
+    if (hasPrevious && memcmp(row - stride, row, rowBytes) == 0) {
+        return SkPngEncoderMgr::RowHint::kRepeat;
+    }
+    if (uniformRows && memcmp(row, row + bytesPerPixel, rowBytes - bytesPerPixel) == 0) {
+        return SkPngEncoderMgr::RowHint::kUniform;
+    }
+    return SkPngEncoderMgr::RowHint::kNone;
+}
+
+// png_error() longjmps; keep the jump inside a frame with no destructors to skip.
+static bool write_rows(SkPngEncoderMgr* encoderMgr, png_bytep* rows,
+                       const SkPngEncoderMgr::RowHint* hints, int numRows) {
+    if (setjmp(png_jmpbuf(encoderMgr->pngPtr()))) {
+        return false;
+    }
+    for (int y = 0; y < numRows; y++) {
+        encoderMgr->writeRow(rows[y], hints[y]);
+    }
+    return true;
+}
+
+static bool write_end(png_structp pngPtr, png_infop infoPtr) {
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        return false;
+    }
+    png_write_end(pngPtr, infoPtr);
+    return true;
+}
+
+bool SkPngEncoder::encodeRowsUniform(int numRows) {
+    if (setjmp(png_jmpbuf(fEncoderMgr->pngPtr()))) {
+        return false;
+    }
+
+    png_bytep row = (png_bytep) fStorage.get();
+    for (int y = 0; y < numRows; y++) {
+        if (!this->checkLimits()) {
+            return false;
+        }
+        png_write_rows(fEncoderMgr->pngPtr(), &row, 1);
+    }
+
+    fCurrRow += numRows;
+    if (fCurrRow == fSrc.height()) {
+        png_write_end(fEncoderMgr->pngPtr(), fEncoderMgr->infoPtr());
+    }
+
+    return true;
+}
+
+bool SkPngEncoder::encodeRowsFast(int numRows) {
+    const size_t rowBytes = (size_t)fEncoderMgr->pngBytesPerPixel() * fSrc.width();
+    const size_t srcRowBytes = fSrc.info().minRowBytes();
+    uint8_t* above = fFastRows.get();
+    uint8_t* filtered = above + rowBytes;
+    for (int y = 0; y < numRows; y++) {
+        if (!this->checkLimits()) {
+            return false;
+        }
+
+        const void* srcRow = this->rowAddr(fCurrRow + y);
+        sk_msan_assert_initialized(srcRow, (const uint8_t*)srcRow + srcRowBytes);
+        fEncoderMgr->transformRows((char*)filtered + 1, 0, (const char*)srcRow, srcRowBytes,
+                                   fSrc.width(), 1);
+        SkFastDeflate::FilterUp(filtered + 1, above, rowBytes);
+        filtered[0] = PNG_FILTER_VALUE_UP;
+        if (!fFastDeflate->write(filtered, rowBytes + 1)) {
+            return false;
+        }
+    }
+
+    fCurrRow += numRows;
+    if (fCurrRow == fSrc.height()) {
+        return fFastDeflate->finish() &&
+               write_chunk(fEncoderMgr->pngPtr(), "IEND", nullptr, 0);
+    }
+
+    return true;
+}
+
+bool SkPngEncoder::encodeRowsPipelined(int numRows) {
+    const size_t rowBytes = (size_t)fEncoderMgr->pngBytesPerPixel() * fSrc.width();
+    const int firstRow = fCurrRow;
+
+    std::shared_ptr<Pipeline> pipeline(new Pipeline);
+    pipeline->fNumBlocks = (numRows + kPipelineRowsPerBlock - 1) / kPipelineRowsPerBlock;
+    for (int i = 0; i < kPipelineBlocks; i++) {
+        pipeline->fBlocks[i].fPixels.reset(kPipelineRowsPerBlock * rowBytes);
+    }
+
+    const size_t srcRowStride = this->srcRowStride();
+    const size_t srcRowBytes = fSrc.info().minRowBytes();
+    const int srcBytesPerPixel = fSrc.info().bytesPerPixel();
+    const bool uniformRows = fEncoderMgr->fillsUniformRows();
+
+    // Only called while this function waits for it to return.
+    pipeline->fTransform = [&](int b, PipelineBlock* block) {
+        if (!this->checkLimits()) {
+            return false;
+        }
+
+        const int top = firstRow + b * kPipelineRowsPerBlock;
+        block->fRows = std::min(kPipelineRowsPerBlock, firstRow + numRows - top);
+        if (srcRowStride) {
+            // Evenly spaced rows between hinted rows take one call for the whole run.
+            const char* srcRows = (const char*)this->rowAddr(top);
+            for (int y = 0; y < block->fRows; y++) {
+                const char* srcRow = srcRows + y * srcRowStride;
+                sk_msan_assert_initialized(srcRow, srcRow + srcRowBytes);
+                block->fHints[y] = classify_row(srcRow, srcRowStride, srcRowBytes,
+                                                srcBytesPerPixel, top + y > firstRow,
+                                                uniformRows);
+            }
+            for (int y = 0; y < block->fRows;) {
+                if (y > 0 && block->fHints[y] == SkPngEncoderMgr::RowHint::kRepeat) {
+                    y++;
+                    continue;
+                }
+                if (block->fHints[y] == SkPngEncoderMgr::RowHint::kUniform) {
+                    fEncoderMgr->transformUniformRow((char*)block->fPixels.get() + y * rowBytes,
+                                                     srcRows + y * srcRowStride, fSrc.width());
+                    y++;
+                    continue;
+                }
+                int end = y + 1;
+                while (end < block->fRows &&
+                       block->fHints[end] == SkPngEncoderMgr::RowHint::kNone) {
+                    end++;
+                }
+                fEncoderMgr->transformRows((char*)block->fPixels.get() + y * rowBytes,
+                                           rowBytes, srcRows + y * srcRowStride,
+                                           srcRowStride, fSrc.width(), end - y);
+                y = end;
+            }
+        } else {
+            for (int y = 0; y < block->fRows; y++) {
+                const void* srcRow = this->rowAddr(top + y);
+                sk_msan_assert_initialized(srcRow, (const uint8_t*)srcRow + srcRowBytes);
+                block->fHints[y] = SkPngEncoderMgr::RowHint::kNone;
+                fEncoderMgr->transformRows((char*)block->fPixels.get() + y * rowBytes,
+                                           rowBytes, (const char*)srcRow, srcRowBytes,
+                                           fSrc.width(), 1);
+            }
+        }
+        return true;
+    };
+
+    SkExecutor::GetDefault().add([pipeline] { Pipeline::Run(pipeline); });
+
+    bool success = true;
+    png_bytep rowPtrs[kPipelineRowsPerBlock];
+    for (int b = 0; b < pipeline->fNumBlocks && success; b++) {
+        PipelineBlock* block;
+        {
+            std::unique_lock<std::mutex> lock(pipeline->fLock);
+            while (pipeline->fProduced <= b && !pipeline->fFailed) {
+                if (pipeline->fProducing) {
+                    pipeline->fCV.wait(lock);
+                } else {
+                    pipeline->produce(&lock);
+                }
+            }
+            if (pipeline->fFailed) {
+                success = false;
+                break;
+            }
+            block = &pipeline->fBlocks[b % kPipelineBlocks];
+        }
+
+        for (int y = 0; y < block->fRows; y++) {
+            const bool repeat = y > 0 && block->fHints[y] == SkPngEncoderMgr::RowHint::kRepeat;
+            rowPtrs[y] = repeat ? rowPtrs[y - 1] : block->fPixels.get() + y * rowBytes;
+        }
+        success = write_rows(fEncoderMgr.get(), rowPtrs, block->fHints, block->fRows);
+
+        std::lock_guard<std::mutex> lock(pipeline->fLock);
+        pipeline->fConsumed++;
+        pipeline->fCV.notify_all();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(pipeline->fLock);
+        pipeline->fStopped = true;
+        pipeline->fCV.notify_all();
+        pipeline->fCV.wait(lock, [&] { return !pipeline->fProducing; });
+    }
+    if (!success) {
+        return false;
+    }
+
+    fCurrRow += numRows;
+    if (fCurrRow == fSrc.height()) {
+        return write_end(fEncoderMgr->pngPtr(), fEncoderMgr->infoPtr());
+    }
+
+    return true;
+}
+
 bool SkPngEncoder::onEncodeRows(int numRows) {
+    if (fUniformSrc.addr()) {
+        if (!this->scanUniform(numRows)) {
+            return false;
+        }
+        if (fUniformSrc.addr()) {
+            return true;
+        }
+    }
+
+    if (fUniform) {
+        return this->encodeRowsUniform(numRows);
+    }
+
+    if (fFastDeflate) {
+        return this->encodeRowsFast(numRows);
+    }
+
+    if (fPipelined && numRows >= kMinPipelinedRows && !fEncoderMgr->passesRowsThrough()) {
+        return this->encodeRowsPipelined(numRows);
+    }
+
     if (setjmp(png_jmpbuf(fEncoderMgr->pngPtr()))) {
         return false;
     }
 
-    const void* srcRow = fSrc.addr(0, fCurrRow);
+    // Rows within one call stay in place when they are evenly spaced, so each may be compared
+    // with the row before it.
+    const size_t srcRowStride = this->srcRowStride();
+    const size_t srcRowBytes = fSrc.info().minRowBytes();
+    const bool uniformRows = fEncoderMgr->fillsUniformRows();
     for (int y = 0; y < numRows; y++) {
-        sk_msan_assert_initialized(srcRow,
-                                   (const uint8_t*)srcRow + (fSrc.width() << fSrc.shiftPerPixel()));
-        fEncoderMgr->proc()((char*)fStorage.get(),
-                            (const char*)srcRow,
-                            fSrc.width(),
-                            SkColorTypeBytesPerPixel(fSrc.colorType()));
+        if (!this->checkLimits()) {
+            return false;
+        }
+
+        const void* srcRow = this->rowAddr(fCurrRow + y);
+        sk_msan_assert_initialized(srcRow, (const uint8_t*)srcRow + srcRowBytes);
+        const SkPngEncoderMgr::RowHint hint =
+                classify_row((const char*)srcRow, srcRowStride, srcRowBytes,
+                             fSrc.info().bytesPerPixel(), y > 0 && srcRowStride, uniformRows);
 
-        png_bytep rowPtr = (png_bytep) fStorage.get();
-        png_write_rows(fEncoderMgr->pngPtr(), &rowPtr, 1);
-        srcRow = SkTAddOffset<const void>(srcRow, fSrc.rowBytes());
+        // libpng copies each row before filtering, so src rows may be handed over directly.
+        // A repeated row is still in |fStorage| from the row before.
+        png_bytep rowPtr = (png_bytep) srcRow;
+        if (!fEncoderMgr->passesRowsThrough()) {
+            if (hint == SkPngEncoderMgr::RowHint::kUniform) {
+                fEncoderMgr->transformUniformRow((char*)fStorage.get(), (const char*)srcRow,
+                                                 fSrc.width());
+            } else if (hint != SkPngEncoderMgr::RowHint::kRepeat) {
+                fEncoderMgr->transformRows((char*)fStorage.get(), 0,
+                                           (const char*)srcRow, srcRowBytes, fSrc.width(), 1);
+            }
+            rowPtr = (png_bytep) fStorage.get();
+        }
+        fEncoderMgr->writeRow(rowPtr, hint);
     }
 
     fCurrRow += numRows;
@@ -259,5 +989,115 @@ bool SkPngEncoder::onEncodeRows(int numRows) {
 
 bool SkPngEncoder::Encode(SkWStream* dst, const SkPixmap& src, const Options& options) {
     auto encoder = SkPngEncoder::Make(dst, src, options);
-    return encoder.get() && encoder->encodeRows(src.height());
+    const int rows = SkEncodedOriginSwapsWidthHeight(options.fOrigin) ? src.width() : src.height();
+    return encoder.get() && encoder->encodeRows(rows);
+}
+
+// Length, type and CRC around every chunk's data.
+static constexpr uint64_t kChunkOverhead = 12;
+
+// png_struct and png_info, with room for what they point to besides rows.
+static constexpr size_t kLibpngStructBytes = 4096;
+
+// deflate_state and its pending buffer beyond the window and hash chains, which depend on
+// the window bits and memory level libpng leaves at 15 and 8.
+static constexpr size_t kDeflateStateBytes = 8192;
+static constexpr size_t kDeflateWindowBytes = (1 << (15 + 2)) + (1 << (8 + 9));
+
+static SkImageInfo oriented_info(const SkImageInfo& info, SkEncodedOrigin origin) {
+    return SkEncodedOriginSwapsWidthHeight(origin) ? info.makeWH(info.height(), info.width())
+                                                   : info;
+}
+
+size_t SkPngEncoder::MaxEncodedSize(const SkImageInfo& srcInfo, const Options& options) {
+    const SkImageInfo info = oriented_info(srcInfo, options.fOrigin);
+    const int bytesPerPixel = png_bytes_per_pixel(info);
+    if (!SkImageInfoIsValid(info) || !bytesPerPixel) {
+        return 0;
+    }
+
+    // A filter byte leads each row.  zlib bounds its output for any level and strategy by
+    // stored blocks and their headers, plus the two byte header and adler32 around them;
+    // libpng writes it PNG_ZBUF_SIZE bytes to an IDAT.  The fast engine stores any block that
+    // would come out larger, and writes larger IDATs.
+    const uint64_t raw = (uint64_t)info.height() * (1 + (uint64_t)bytesPerPixel * info.width());
+    const uint64_t deflated = raw + ((raw + 7) >> 3) + ((raw + 63) >> 6) + 5 + 6;
+    uint64_t size = deflated + kChunkOverhead * ((deflated + PNG_ZBUF_SIZE - 1) / PNG_ZBUF_SIZE);
+
+    // Signature, IHDR, sBIT and IEND, and the PLTE and tRNS that replace sBIT for uniform
+    // images.
+    size += 8 + (13 + kChunkOverhead) + (4 + kChunkOverhead) + kChunkOverhead;
+    size += (3 + kChunkOverhead) + (1 + kChunkOverhead);
+
+    if (const SkColorSpace* cs = info.colorSpace()) {
+        if (!cs->isSRGB() && options.fColorSpaceHandling == Options::ColorSpaceHandling::kEmbed) {
+            size += cs->iccpChunk().size() + kChunkOverhead;
+        } else {
+            size += 1 + kChunkOverhead;
+        }
+    }
+
+    if (options.fWriteOffset) {
+        size += 9 + kChunkOverhead;
+    }
+
+    if (const SkDataTable* comments = options.fComments) {
+        for (int i = 0; i + 1 < comments->count(); i += 2) {
+            const size_t keyword = std::min<size_t>(strlen(comments->atStr(i)),
+                                                    PNG_KEYWORD_MAX_LENGTH);
+            size += keyword + 1 + strlen(comments->atStr(i + 1)) + kChunkOverhead;
+        }
+    }
+
+    return size < SIZE_MAX ? (size_t)size : SIZE_MAX;
+}
+
+size_t SkPngEncoder::WorkingMemory(const SkImageInfo& srcInfo, const Options& options) {
+    const SkImageInfo info = oriented_info(srcInfo, options.fOrigin);
+    const int bytesPerPixel = png_bytes_per_pixel(info);
+    if (!SkImageInfoIsValid(info) || !bytesPerPixel) {
+        return 0;
+    }
+
+    const uint64_t rowBytes = (uint64_t)bytesPerPixel * info.width();
+
+    // libpng only writes the chunks around the fast engine's IDATs.  Rows are transformed
+    // straight into the filtered row, next to the row above it; the encoder's own row is
+    // allocated all the same.
+    if (options.fEngine == Options::Engine::kFast) {
+        const uint64_t bytes = kLibpngStructBytes + SkFastDeflate::WorkingMemory() +
+                               3 * rowBytes + 1 +
+                               SkOrientedRows::ScratchBytes(srcInfo, options.fOrigin);
+        return bytes < SIZE_MAX ? (size_t)bytes : SIZE_MAX;
+    }
+
+    // libpng filters out of a copy of each row, keeps the row before it for Up, Avg and
+    // Paeth, and tries candidate filters in two more rows when it has a choice.
+    const int filters = (int)options.fFilterFlags & (int)FilterFlag::kAll;
+    int libpngRows = 1;
+    if (filters & ((int)FilterFlag::kUp | (int)FilterFlag::kAvg | (int)FilterFlag::kPaeth)) {
+        libpngRows++;
+    }
+    if (filters & (filters - 1)) {
+        libpngRows += 2;
+    }
+
+    uint64_t bytes = kLibpngStructBytes + kDeflateStateBytes + kDeflateWindowBytes +
+                     PNG_ZBUF_SIZE + libpngRows * (rowBytes + 1);
+
+    // The row before each uniform row, to tell whether libpng would filter it with Sub.
+    if ((filters & (int)FilterFlag::kSub) && (filters & (filters - 1))) {
+        bytes += rowBytes;
+    }
+
+    // The row transformed for libpng, or the blocks of them in flight when pipelined.
+    if (options.fPipelined && info.height() >= kMinPipelinedRows) {
+        bytes += kPipelineBlocks * kPipelineRowsPerBlock * rowBytes;
+    } else {
+        bytes += rowBytes;
+    }
+
+    bytes += SkOrientedRows::ScratchBytes(srcInfo, options.fOrigin);
+
+    return bytes < SIZE_MAX ? (size_t)bytes : SIZE_MAX;
 }
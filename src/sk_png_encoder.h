@@ -6,7 +6,10 @@
 #include <sk_stream.h>
 #include <sk_encoder.h>
 #include <sk_data_table.h>
+#include <sk_encode_limits.h>
+#include <sk_encoded_origin.h>
 
+class SkFastDeflate;
 class SkPngEncoderMgr;
 class SkPngEncoder : public SkEncoder {
 public:
@@ -47,18 +50,96 @@ public:
          */
         int fZLibLevel = 6;
 
+        /**
+         *  The zlib strategy, passed to deflateInit2().  kFiltered suits rows that filtering
+         *  leaves as small residuals, kRLE finds the runs of flat content nearly as well as a
+         *  full search in less time, and kHuffmanOnly skips matching for data with none.
+         *
+         *  Our default value leaves the choice to libpng, which uses Z_FILTERED when rows
+         *  may be filtered.
+         */
+        enum class ZLibStrategy {
+            kDefault,
+            kFiltered,
+            kHuffmanOnly,
+            kRLE,
+        };
+        ZLibStrategy fZLibStrategy = ZLibStrategy::kDefault;
+
         /**
          *  Represents comments in the tEXt ancillary chunk of the png.
          *  The 2i-th entry is the keyword for the i-th comment,
          *  and the (2i + 1)-th entry is the text for the i-th comment.
          */
         SkDataTable *fComments;
+
+        /**
+         *  If non-null, the encode fails once these limits are exceeded. They are checked
+         *  between rows and on every write from the deflate loop. Unowned; must outlive
+         *  the encoder.
+         */
+        SkEncodeLimits* fLimits = nullptr;
+
+        /**
+         *  If true, rows are converted to the png pixel format ahead of libpng by a task on
+         *  SkExecutor::GetDefault(), and handed in blocks to libpng, which filters and deflates
+         *  them on the encoding thread.  The encoding thread converts a block itself rather
+         *  than wait for a task that has not started.  The encoded bytes are the same either
+         *  way.
+         */
+        bool fPipelined = false;
+
+        /**
+         *  Orientation applied to |src| as it is encoded, so the png shows the pixels as they
+         *  would be displayed with this origin.  The 90 degree rotations swap the encoded
+         *  width and height.
+         */
+        SkEncodedOrigin fOrigin = kTopLeft_SkEncodedOrigin;
+
+        /**
+         *  How a |src| color space other than sRGB reaches the png.  kEmbed keeps the pixels
+         *  as they are and writes the color space as an iCCP chunk; kConvertToSRGB converts
+         *  each row to sRGB in the same pass that prepares it for libpng and tags the png
+         *  as sRGB.  An sRGB |src| is tagged sRGB, and a |src| with no color space is
+         *  written untagged either way.
+         */
+        enum class ColorSpaceHandling {
+            kEmbed,
+            kConvertToSRGB,
+        };
+        ColorSpaceHandling fColorSpaceHandling = ColorSpaceHandling::kEmbed;
+
+        /**
+         *  If true, an oFFs chunk places the png at (fOffsetX, fOffsetY), in pixels, on a
+         *  larger canvas, e.g. the image it was trimmed from.
+         */
+        bool fWriteOffset = false;
+        int32_t fOffsetX = 0;
+        int32_t fOffsetY = 0;
+
+        /**
+         *  What filters and deflates the rows.  kLibpng hands them to libpng and zlib with the
+         *  settings above.  kFast filters every row with Up and deflates it with SkFastDeflate,
+         *  which looks at each byte once; it is several times faster than zlib at level 1 for
+         *  pngs a little larger, and any decoder reads them.  kFast ignores fFilterFlags,
+         *  fZLibLevel, fZLibStrategy and fPipelined.
+         *
+         *  Our default value keeps the output byte for byte what libpng writes.
+         */
+        enum class Engine {
+            kLibpng,
+            kFast,
+        };
+        Engine fEngine = Engine::kLibpng;
     };
 
     /**
      *  Encode the |src| pixels to the |dst| stream.
      *  |options| may be used to control the encoding behavior.
      *
+     *  A |src| of a single 8-bit color is written as a one-bit palette png of that color,
+     *  a few dozen bytes however large it is.  Make() writes it the same way.
+     *
      *  Returns true on success.  Returns false on an invalid or unsupported |src|.
      */
     static bool Encode(SkWStream* dst, const SkPixmap& src, const Options& options);
@@ -69,19 +150,82 @@ public:
      *
      *  |dst| is unowned but must remain valid for the lifetime of the object.
      *
+     *  When the first row of |src| is a single color, the header waits until the rest of
+     *  |src| is known to be that color or not.  encodeRows() reads ahead for it, as many
+     *  pixels per call as the rows asked for hold and checking limits before every row, and
+     *  encodes no row until then; rowsEncoded() tells how far it got.  Encoding the rows in
+     *  steps writes the same png as encoding them at once.
+     *
      *  This returns nullptr on an invalid or unsupported |src|.
      */
     static std::unique_ptr<SkEncoder> Make(SkWStream* dst, const SkPixmap& src,
                                            const Options& options);
 
+    /**
+     *  Create a png encoder for an image whose rows are all supplied later through
+     *  encodeRows(const SkPixmap&).  Only the info of |shape| is used, so it may have no
+     *  pixels, but it must remain valid for the lifetime of the object, as must |dst|.
+     *
+     *  The header is written before any row is seen, so an image of a single color is
+     *  written as any other, not as the palette png Encode() and Make() write for it.
+     *
+     *  This returns nullptr on an invalid or unsupported |shape|.
+     */
+    static std::unique_ptr<SkEncoder> MakeForRows(SkWStream* dst, const SkPixmap& shape,
+                                                  const Options& options);
+
+    /**
+     *  The largest png Encode() may write for a |src| of |info| with |options|: every row
+     *  stored without compression, and every chunk the options call for.
+     *
+     *  Returns 0 for an invalid or unsupported |info|.
+     */
+    static size_t MaxEncodedSize(const SkImageInfo& info, const Options& options);
+
+    /**
+     *  Bytes an encode of a |src| of |info| with |options| allocates besides its output:
+     *  libpng's row buffers, deflate's window and hash chains, and the rows waiting to be
+     *  handed to libpng, or the buffers of the fast engine.
+     *
+     *  Returns 0 for an invalid or unsupported |info|.
+     */
+    static size_t WorkingMemory(const SkImageInfo& info, const Options& options);
+
     ~SkPngEncoder() override;
 
+private:
+    // Writes the header unless |writeInfo| is false, which leaves it to scanUniform().
+    static std::unique_ptr<SkPngEncoder> MakeImpl(SkWStream* dst, const SkPixmap& src,
+                                                  const Options& options, bool writeInfo);
+
+    // Compares another |numRows| encoded rows' worth of fUniformSrc with its first pixel.
+    // Once a row differs, writes the header setHeader() chose; once all of them match,
+    // writes a one-bit palette png header of that pixel instead and sets fUniform.
+    bool scanUniform(int numRows);
+
+    bool encodeRowsUniform(int numRows);
+    bool encodeRowsPipelined(int numRows);
+    bool encodeRowsFast(int numRows);
+
 protected:
     bool onEncodeRows(int numRows) override;
 
     SkPngEncoder(std::unique_ptr<SkPngEncoderMgr>, const SkPixmap& src);
 
     std::unique_ptr<SkPngEncoderMgr> fEncoderMgr;
+    bool                             fPipelined = false;
+    // Set by Make() when the first src row is one color, and reset by scanUniform() once it
+    // has told whether every src row is that color, reading rows up to fUniformRows.
+    SkPixmap                         fUniformSrc;
+    int                              fUniformRows = 0;
+    // Set by scanUniform(): every row is the all-zero row in fStorage.
+    bool                             fUniform = false;
+
+    // Set for the fast engine: the deflate stream goes to IDATs through fIDATStream, from
+    // the row above and the filtered row in fFastRows.
+    std::unique_ptr<SkWStream>       fIDATStream;
+    std::unique_ptr<SkFastDeflate>   fFastDeflate;
+    SkAutoTMalloc<uint8_t>           fFastRows;
     typedef SkEncoder INHERITED;
 };
 
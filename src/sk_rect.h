@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+/** \struct SkIRect
+    SkIRect holds four 32-bit integer coordinates describing the upper and
+    lower bounds of a rectangle. SkIRect may be created from outer bounds or
+    from position, width, and height. SkIRect describes an area; if its right
+    is less than or equal to its left, or if its bottom is less than or equal to
+    its top, it is considered empty.
+*/
+struct SkIRect {
+    int32_t fLeft;   //!< smaller x-axis bounds
+    int32_t fTop;    //!< smaller y-axis bounds
+    int32_t fRight;  //!< larger x-axis bounds
+    int32_t fBottom; //!< larger y-axis bounds
+
+    /** Returns constructed SkIRect set to (0, 0, 0, 0).
+        @return  bounds (0, 0, 0, 0)
+    */
+    static constexpr SkIRect MakeEmpty() {
+        return SkIRect{0, 0, 0, 0};
+    }
+
+    /** Returns constructed SkIRect set to (0, 0, w, h).
+        @param w  width of constructed SkIRect
+        @param h  height of constructed SkIRect
+        @return   bounds (0, 0, w, h)
+    */
+    static constexpr SkIRect MakeWH(int32_t w, int32_t h) {
+        return SkIRect{0, 0, w, h};
+    }
+
+    /** Returns constructed SkIRect set to (l, t, r, b). Does not sort input; SkIRect may
+        result in fLeft greater than fRight, or fTop greater than fBottom.
+        @param l  integer stored in fLeft
+        @param t  integer stored in fTop
+        @param r  integer stored in fRight
+        @param b  integer stored in fBottom
+        @return   bounds (l, t, r, b)
+    */
+    static constexpr SkIRect MakeLTRB(int32_t l, int32_t t, int32_t r, int32_t b) {
+        return SkIRect{l, t, r, b};
+    }
+
+    /** Returns constructed SkIRect set to: (x, y, x + w, y + h).
+        Does not validate input; w or h may be negative.
+        @param x  stored in fLeft
+        @param y  stored in fTop
+        @param w  added to x and stored in fRight
+        @param h  added to y and stored in fBottom
+        @return   bounds at (x, y) with width w and height h
+    */
+    static constexpr SkIRect MakeXYWH(int32_t x, int32_t y, int32_t w, int32_t h) {
+        return SkIRect{x, y, x + w, y + h};
+    }
+
+    /** Returns left edge of SkIRect, if sorted.
+        @return  fLeft
+    */
+    constexpr int32_t x() const { return fLeft; }
+
+    /** Returns top edge of SkIRect, if sorted.
+        @return  fTop
+    */
+    constexpr int32_t y() const { return fTop; }
+
+    /** Returns span on the x-axis. This does not check if SkIRect is sorted.
+        @return  fRight minus fLeft
+    */
+    constexpr int32_t width() const { return fRight - fLeft; }
+
+    /** Returns span on the y-axis. This does not check if SkIRect is sorted.
+        @return  fBottom minus fTop
+    */
+    constexpr int32_t height() const { return fBottom - fTop; }
+
+    /** Returns true if fLeft is equal to or greater than fRight, or if fTop is equal
+        to or greater than fBottom. Call sort() to reverse rectangles with negative
+        width() or height().
+        @return  true if width() or height() are zero or negative
+    */
+    bool isEmpty() const { return fRight <= fLeft || fBottom <= fTop; }
+};
+
+static inline bool operator==(const SkIRect& a, const SkIRect& b) {
+    return a.fLeft == b.fLeft && a.fTop == b.fTop &&
+           a.fRight == b.fRight && a.fBottom == b.fBottom;
+}
+
+static inline bool operator!=(const SkIRect& a, const SkIRect& b) { return !(a == b); }
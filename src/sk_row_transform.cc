@@ -0,0 +1,187 @@
+#include <algorithm>
+
+#include <sk_image_encoder_fns.h>
+#include <sk_row_transform.h>
+
+static constexpr int src_bpp(SkColorType ct) {
+    switch (ct) {
+        case kAlpha_8_SkColorType:
+        case kGray_8_SkColorType:
+            return 1;
+        case kRGB_565_SkColorType:
+            return 2;
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType:
+            return 4;
+        case kRGBA_F16_SkColorType:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static constexpr int dst_bpp(SkColorType ct, SkAlphaType at, SkRowDst dst) {
+    if (dst == SkRowDst::kBGRA_8888) {
+        return 4;
+    }
+    switch (ct) {
+        case kAlpha_8_SkColorType:
+        case kGray_8_SkColorType:
+            return 1;
+        case kRGB_565_SkColorType:
+            return 3;
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType:
+            return at == kOpaque_SkAlphaType ? 3 : 4;
+        case kRGBA_F16_SkColorType:
+            return at == kOpaque_SkAlphaType ? 6 : 8;
+        default:
+            return 0;
+    }
+}
+
+static constexpr bool is_copy(SkColorType ct, SkAlphaType at, SkRowDst dst) {
+    if (dst == SkRowDst::kBGRA_8888) {
+        return ct == kBGRA_8888_SkColorType && at == kUnpremul_SkAlphaType;
+    }
+    return ct == kAlpha_8_SkColorType || ct == kGray_8_SkColorType ||
+           (ct == kRGBA_8888_SkColorType && at == kUnpremul_SkAlphaType);
+}
+
+// Every condition is a constant, so each instantiation compiles to a single kernel call.
+template <SkColorType kCT, SkAlphaType kAT, SkRowDst kDst>
+static inline void transform_row(char* dst, const char* src, int width) {
+    constexpr bool kPng = kDst == SkRowDst::kPng;
+    constexpr int kSrcBpp = src_bpp(kCT);
+
+    if (is_copy(kCT, kAT, kDst)) {
+        transform_scanline_memcpy(dst, src, width, kSrcBpp);
+        return;
+    }
+
+    switch (kCT) {
+        case kAlpha_8_SkColorType:
+            transform_scanline_A8_to_bgra(dst, src, width, kSrcBpp);
+            return;
+        case kGray_8_SkColorType:
+            transform_scanline_G8_to_bgra(dst, src, width, kSrcBpp);
+            return;
+        case kRGB_565_SkColorType:
+            if (kPng) {
+                transform_scanline_565(dst, src, width, kSrcBpp);
+            } else {
+                transform_scanline_565_to_bgra(dst, src, width, kSrcBpp);
+            }
+            return;
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType: {
+            // png rows are RGB ordered; BGRA output is BGR ordered.
+            constexpr bool kSwapRB = (kCT == kBGRA_8888_SkColorType) == kPng;
+            if (kAT == kPremul_SkAlphaType) {
+                unpremul_8888<kSwapRB>(dst, src, width);
+            } else if (kAT == kOpaque_SkAlphaType && kPng) {
+                strip_alpha_8888<kSwapRB>(dst, src, width);
+            } else {
+                swizzle_8888<kSwapRB>(dst, src, width, kAT == kOpaque_SkAlphaType ? 0xFF : 0);
+            }
+            return;
+        }
+        case kRGBA_F16_SkColorType:
+            if (kPng) {
+                if (kAT == kPremul_SkAlphaType) {
+                    transform_scanline_F16_premul(dst, src, width, kSrcBpp);
+                } else if (kAT == kUnpremul_SkAlphaType) {
+                    transform_scanline_F16(dst, src, width, kSrcBpp);
+                } else {
+                    transform_scanline_F16_opaque(dst, src, width, kSrcBpp);
+                }
+            } else {
+                if (kAT == kPremul_SkAlphaType) {
+                    transform_scanline_F16_premul_to_bgra(dst, src, width, kSrcBpp);
+                } else if (kAT == kUnpremul_SkAlphaType) {
+                    transform_scanline_F16_to_bgra(dst, src, width, kSrcBpp);
+                } else {
+                    transform_scanline_F16_opaque_to_bgra(dst, src, width, kSrcBpp);
+                }
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+template <SkColorType kCT, SkAlphaType kAT, SkRowDst kDst>
+static void transform_rows(char* dst, size_t dstRowBytes, const char* src, size_t srcRowBytes,
+                           int width, int rows) {
+    constexpr size_t kSrcBpp = src_bpp(kCT);
+    constexpr size_t kDstBpp = dst_bpp(kCT, kAT, kDst);
+
+    // Packed rows are one run of pixels, handed to the kernel in as few pieces as it takes.
+    size_t pixels = width;
+    if (srcRowBytes == pixels * kSrcBpp && dstRowBytes == pixels * kDstBpp) {
+        pixels *= rows;
+        rows = 1;
+    }
+
+    for (int y = 0; y < rows; y++) {
+        char* dstRow = dst + y * dstRowBytes;
+        const char* srcRow = src + y * srcRowBytes;
+        for (size_t done = 0; done < pixels; done += kMaxProcPixels) {
+            const int n = (int)std::min<size_t>(kMaxProcPixels, pixels - done);
+            transform_row<kCT, kAT, kDst>(dstRow + done * kDstBpp, srcRow + done * kSrcBpp, n);
+        }
+    }
+}
+
+#define SK_ROW_TRANSFORM(ct, at, dst) \
+    { transform_rows<ct, at, dst>, dst_bpp(ct, at, dst), is_copy(ct, at, dst) }
+
+// Indexed by SkAlphaType.
+#define SK_ROW_TRANSFORMS(ct, dst)                           \
+    {                                                        \
+        { nullptr, 0, false },                               \
+        SK_ROW_TRANSFORM(ct, kOpaque_SkAlphaType, dst),      \
+        SK_ROW_TRANSFORM(ct, kPremul_SkAlphaType, dst),      \
+        SK_ROW_TRANSFORM(ct, kUnpremul_SkAlphaType, dst),    \
+    }
+
+// Indexed by SkColorType, then SkAlphaType.
+static constexpr SkRowTransform kPngRowTransforms[][kLastEnum_SkAlphaType + 1] = {
+    { { nullptr, 0, false }, { nullptr, 0, false },
+      { nullptr, 0, false }, { nullptr, 0, false } },
+    SK_ROW_TRANSFORMS(kAlpha_8_SkColorType,   SkRowDst::kPng),
+    SK_ROW_TRANSFORMS(kRGB_565_SkColorType,   SkRowDst::kPng),
+    SK_ROW_TRANSFORMS(kRGBA_8888_SkColorType, SkRowDst::kPng),
+    SK_ROW_TRANSFORMS(kBGRA_8888_SkColorType, SkRowDst::kPng),
+    SK_ROW_TRANSFORMS(kGray_8_SkColorType,    SkRowDst::kPng),
+    SK_ROW_TRANSFORMS(kRGBA_F16_SkColorType,  SkRowDst::kPng),
+};
+
+static constexpr SkRowTransform kBGRARowTransforms[][kLastEnum_SkAlphaType + 1] = {
+    { { nullptr, 0, false }, { nullptr, 0, false },
+      { nullptr, 0, false }, { nullptr, 0, false } },
+    SK_ROW_TRANSFORMS(kAlpha_8_SkColorType,   SkRowDst::kBGRA_8888),
+    SK_ROW_TRANSFORMS(kRGB_565_SkColorType,   SkRowDst::kBGRA_8888),
+    SK_ROW_TRANSFORMS(kRGBA_8888_SkColorType, SkRowDst::kBGRA_8888),
+    SK_ROW_TRANSFORMS(kBGRA_8888_SkColorType, SkRowDst::kBGRA_8888),
+    SK_ROW_TRANSFORMS(kGray_8_SkColorType,    SkRowDst::kBGRA_8888),
+    SK_ROW_TRANSFORMS(kRGBA_F16_SkColorType,  SkRowDst::kBGRA_8888),
+};
+
+#undef SK_ROW_TRANSFORMS
+#undef SK_ROW_TRANSFORM
+
+static constexpr int kRowTransformColorTypes =
+        sizeof(kPngRowTransforms) / sizeof(kPngRowTransforms[0]);
+static_assert(kRowTransformColorTypes == kRGBA_F16_SkColorType + 1,
+              "every SkColorType needs row transforms");
+
+const SkRowTransform* SkChooseRowTransform(const SkImageInfo& info, SkRowDst dst) {
+    const int ct = info.colorType(), at = info.alphaType();
+    if (ct <= kUnknown_SkColorType || ct >= kRowTransformColorTypes ||
+        at <= kUnknown_SkAlphaType || at > kLastEnum_SkAlphaType) {
+        return nullptr;
+    }
+
+    return dst == SkRowDst::kPng ? &kPngRowTransforms[ct][at] : &kBGRARowTransforms[ct][at];
+}
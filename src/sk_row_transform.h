@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <sk_image_info.h>
+
+/**
+ *  The pixel layouts rows are transformed into.
+ */
+enum class SkRowDst {
+    /** What SkPngEncoder hands libpng: 8-bit gray, 8-bit RGB(A), or big-endian 16-bit RGB(A)
+     *  for half floats, with the alpha channel dropped from opaque images. */
+    kPng,
+    /** Unpremultiplied BGRA_8888, keeping the src alpha type. */
+    kBGRA_8888,
+};
+
+/**
+ *  Transforms |rows| rows of |width| pixels, |srcRowBytes| apart at |src|, into rows
+ *  |dstRowBytes| apart at |dst|.
+ */
+typedef void (*SkRowTransformProc)(char* dst, size_t dstRowBytes, const char* src,
+                                   size_t srcRowBytes, int width, int rows);
+
+/**
+ *  One row transform, instantiated from a template for a single combination of src color
+ *  type, alpha type and destination, so its row loop and pixel kernel are inlined together.
+ *  The indirect call is paid once per band of rows rather than once per row.
+ */
+struct SkRowTransform {
+    SkRowTransformProc fProc;
+    int                fDstBytesPerPixel;
+
+    /** True when dst pixels are the src bytes unchanged. */
+    bool               fIsCopy;
+
+    void operator()(char* dst, size_t dstRowBytes, const char* src, size_t srcRowBytes,
+                    int width, int rows) const {
+        fProc(dst, dstRowBytes, src, srcRowBytes, width, rows);
+    }
+};
+
+/**
+ *  Returns the transform of |info|'s pixels into |dst|, looked up in a table built at compile
+ *  time, or nullptr if |info| has an unknown color or alpha type.
+ */
+const SkRowTransform* SkChooseRowTransform(const SkImageInfo& info, SkRowDst dst);
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <sk_stream.h>
 #include <sk_string.h>
 
@@ -76,4 +78,62 @@ bool SkWStream::writeStream(SkStream* stream, size_t length) {
         length -= n;
     }
     return true;
-}
\ No newline at end of file
+}
+SkMemoryStream::SkMemoryStream(const void* data, size_t length)
+    : fData((const uint8_t*)data)
+    , fLength(length)
+    , fOffset(0)
+{}
+
+size_t SkMemoryStream::read(void* buffer, size_t size) {
+    size_t dataSize = fLength;
+
+    if (size > dataSize - fOffset) {
+        size = dataSize - fOffset;
+    }
+    if (buffer) {
+        memcpy(buffer, fData + fOffset, size);
+    }
+    fOffset += size;
+    return size;
+}
+
+size_t SkMemoryStream::peek(void* buffer, size_t size) const {
+    assert(buffer != nullptr);
+
+    const size_t currentOffset = fOffset;
+    const size_t bytesToPeek = std::min(size, fLength - currentOffset);
+    memcpy(buffer, fData + currentOffset, bytesToPeek);
+    return bytesToPeek;
+}
+
+bool SkMemoryStream::isAtEnd() const {
+    return fOffset == fLength;
+}
+
+bool SkMemoryStream::rewind() {
+    fOffset = 0;
+    return true;
+}
+
+bool SkMemoryStream::seek(size_t position) {
+    fOffset = position > fLength ? fLength : position;
+    return true;
+}
+
+bool SkMemoryStream::move(long offset) {
+    if (offset < 0 && (size_t)-offset > fOffset) {
+        return this->seek(0);
+    }
+    return this->seek(fOffset + offset);
+}
+
+SkMemoryStream* SkMemoryStream::onDuplicate() const {
+    return new SkMemoryStream(fData, fLength);
+}
+
+SkMemoryStream* SkMemoryStream::onFork() const {
+    std::unique_ptr<SkMemoryStream> that(this->onDuplicate());
+    that->seek(fOffset);
+    return that.release();
+}
@@ -154,6 +154,42 @@ private:
     SkStreamRewindable* onDuplicate() const override = 0;
 };
 
+/** SkMemoryStream reads a block of memory, which the caller must keep alive. */
+class SkMemoryStream : public SkStreamRewindable {
+public:
+    SkMemoryStream(const void* data, size_t length);
+
+    size_t read(void* buffer, size_t size) override;
+    size_t peek(void* buffer, size_t size) const override;
+    bool isAtEnd() const override;
+
+    bool rewind() override;
+    std::unique_ptr<SkMemoryStream> duplicate() const {
+        return std::unique_ptr<SkMemoryStream>(this->onDuplicate());
+    }
+    std::unique_ptr<SkMemoryStream> fork() const {
+        return std::unique_ptr<SkMemoryStream>(this->onFork());
+    }
+
+    bool hasPosition() const override { return true; }
+    size_t getPosition() const override { return fOffset; }
+    bool seek(size_t position) override;
+    bool move(long offset) override;
+
+    bool hasLength() const override { return true; }
+    size_t getLength() const override { return fLength; }
+
+    const void* getMemoryBase() override { return fData; }
+
+private:
+    SkMemoryStream* onDuplicate() const override;
+    SkMemoryStream* onFork() const override;
+
+    const uint8_t* fData;
+    size_t         fLength;
+    size_t         fOffset;
+};
+
 class SkWStream {
 public:
     virtual ~SkWStream();
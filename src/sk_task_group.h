@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include <sk_executor.h>
+
+class SkTaskGroup {
+public:
+    // Tasks added to this SkTaskGroup will run on its executor.
+    explicit SkTaskGroup(SkExecutor& executor = SkExecutor::GetDefault());
+    ~SkTaskGroup() { this->wait(); }
+
+    // Add a task to this SkTaskGroup.
+    void add(std::function<void(void)> fn);
+
+    // Add a batch of N tasks, all calling fn with different arguments.
+    void batch(int N, std::function<void(int)> fn);
+
+    // Returns true if all Tasks previously add()ed to this SkTaskGroup have run.
+    // It is safe to reuse this SkTaskGroup once done().
+    bool done() const;
+
+    // Block until done(), helping out with queued work while waiting.
+    void wait();
+
+private:
+    SkTaskGroup(const SkTaskGroup&) = delete;
+    SkTaskGroup& operator=(const SkTaskGroup&) = delete;
+
+    std::atomic<int32_t> fPending;
+    SkExecutor&          fExecutor;
+};
@@ -0,0 +1,195 @@
+#include <string.h>
+
+#include <sk_cpu.h>
+#include <sk_visible_bounds.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define SK_VISIBLE_BOUNDS_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define SK_VISIBLE_BOUNDS_NEON 1
+#endif
+
+// Pixels are visible when any bit of their alpha is set.  Each format's alpha bits are given
+// as a mask over 16 bytes of pixels, which every pixel size divides, so rows are scanned as
+// plain bytes in blocks of 16 that start on a pixel.
+namespace {
+struct AlphaMask {
+    uint8_t fBytes[16];
+};
+}
+
+static bool alpha_mask(const SkImageInfo& info, AlphaMask* mask) {
+    memset(mask->fBytes, 0, sizeof(mask->fBytes));
+    switch (info.colorType()) {
+        case kAlpha_8_SkColorType:
+            memset(mask->fBytes, 0xFF, sizeof(mask->fBytes));
+            return true;
+        case kRGBA_8888_SkColorType:
+        case kBGRA_8888_SkColorType:
+            if (info.isOpaque()) {
+                return false;
+            }
+            for (int i = 3; i < 16; i += 4) {
+                mask->fBytes[i] = 0xFF;
+            }
+            return true;
+        case kRGBA_F16_SkColorType:
+            if (info.isOpaque()) {
+                return false;
+            }
+            // The alpha half is the last of each pixel, little-endian; -0 is transparent too.
+            for (int i = 6; i < 16; i += 8) {
+                mask->fBytes[i] = 0xFF;
+                mask->fBytes[i + 1] = 0x7F;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+#if defined(SK_VISIBLE_BOUNDS_SSE2)
+// The SIMD scans stop at the block holding the first masked bit and leave finding the byte
+// to the scalar loop.
+__attribute__((target("sse2")))
+static size_t first_visible_block_sse2(const uint8_t* row, size_t n, const AlphaMask& mask) {
+    const __m128i m = _mm_loadu_si128((const __m128i*)mask.fBytes);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(row + i)), m);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Blocks are taken back from |end|, a multiple of 16.
+__attribute__((target("sse2")))
+static size_t last_visible_block_sse2(const uint8_t* row, size_t end, const AlphaMask& mask) {
+    const __m128i m = _mm_loadu_si128((const __m128i*)mask.fBytes);
+    for (; end >= 16; end -= 16) {
+        const __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(row + end - 16)), m);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+    }
+    return end;
+}
+#endif
+
+#if defined(SK_VISIBLE_BOUNDS_NEON)
+static size_t first_visible_block_neon(const uint8_t* row, size_t n, const AlphaMask& mask) {
+    const uint8x16_t m = vld1q_u8(mask.fBytes);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (vmaxvq_u8(vandq_u8(vld1q_u8(row + i), m))) {
+            break;
+        }
+    }
+    return i;
+}
+
+static size_t last_visible_block_neon(const uint8_t* row, size_t end, const AlphaMask& mask) {
+    const uint8x16_t m = vld1q_u8(mask.fBytes);
+    for (; end >= 16; end -= 16) {
+        if (vmaxvq_u8(vandq_u8(vld1q_u8(row + end - 16), m))) {
+            break;
+        }
+    }
+    return end;
+}
+#endif
+
+// Returns the offset of the first byte of |row| with a masked bit set, or |n| if none is.
+static size_t first_visible(const uint8_t* row, size_t n, const AlphaMask& mask) {
+    size_t i = 0;
+#if defined(SK_VISIBLE_BOUNDS_SSE2)
+    if (SkCpu::Supports(SkCpu::SSE2)) {
+        i = first_visible_block_sse2(row, n, mask);
+    }
+#elif defined(SK_VISIBLE_BOUNDS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        i = first_visible_block_neon(row, n, mask);
+    }
+#endif
+    for (; i < n; i++) {
+        if (row[i] & mask.fBytes[i % 16]) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// Returns one past the offset of the last byte of |row| with a masked bit set, or 0 if none
+// is.
+static size_t last_visible(const uint8_t* row, size_t n, const AlphaMask& mask) {
+    // The partial block at the end goes first so the SIMD blocks stay on the mask's phase.
+    size_t end = n;
+    for (; end > (n & ~(size_t)15); end--) {
+        if (row[end - 1] & mask.fBytes[(end - 1) % 16]) {
+            return end;
+        }
+    }
+#if defined(SK_VISIBLE_BOUNDS_SSE2)
+    if (SkCpu::Supports(SkCpu::SSE2)) {
+        end = last_visible_block_sse2(row, end, mask);
+    }
+#elif defined(SK_VISIBLE_BOUNDS_NEON)
+    if (SkCpu::Supports(SkCpu::NEON)) {
+        end = last_visible_block_neon(row, end, mask);
+    }
+#endif
+    for (; end > 0; end--) {
+        if (row[end - 1] & mask.fBytes[(end - 1) % 16]) {
+            return end;
+        }
+    }
+    return 0;
+}
+
+bool SkComputeVisibleBounds(const SkPixmap& src, SkIRect* bounds) {
+    const int w = src.width(), h = src.height();
+    AlphaMask mask;
+    if (!alpha_mask(src.info(), &mask)) {
+        *bounds = SkIRect::MakeWH(w, h);
+        return true;
+    }
+
+    const int bpp = src.info().bytesPerPixel();
+    const size_t rowBytes = src.info().minRowBytes();
+    auto row = [&](int y) { return (const uint8_t*)src.addr(0, y); };
+
+    int top = 0;
+    while (top < h && first_visible(row(top), rowBytes, mask) == rowBytes) {
+        top++;
+    }
+    if (top == h) {
+        *bounds = SkIRect::MakeEmpty();
+        return false;
+    }
+
+    int bottom = h;
+    while (first_visible(row(bottom - 1), rowBytes, mask) == rowBytes) {
+        bottom--;
+    }
+
+    // Each row only needs scanning as far as the columns already known to be visible.
+    int left = w, right = 0;
+    for (int y = top; y < bottom; y++) {
+        const uint8_t* r = row(y);
+        left = (int)(first_visible(r, (size_t)left * bpp, mask) / bpp);
+        if (right < w) {
+            const size_t skip = (size_t)right * bpp;
+            const size_t end = last_visible(r + skip, rowBytes - skip, mask);
+            if (end) {
+                right += (int)((end - 1) / bpp) + 1;
+            }
+        }
+    }
+
+    *bounds = SkIRect::MakeLTRB(left, top, right, bottom);
+    return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <sk_pixmap.h>
+#include <sk_rect.h>
+
+/**
+ *  Sets |bounds| to the smallest rectangle of |src| holding every pixel that is not fully
+ *  transparent, scanning in from each edge so the work grows with the transparent border
+ *  rather than with the whole image.  Color and alpha types without transparency are bounded
+ *  by all of |src|.
+ *
+ *  Returns false, leaving |bounds| empty, when every pixel is transparent.
+ */
+bool SkComputeVisibleBounds(const SkPixmap& src, SkIRect* bounds);
@@ -1,76 +1,935 @@
 #include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#include <sk_color_space.h>
+#include <sk_cpu.h>
+#include <sk_encode_limits.h>
+#include <sk_encoded_origin.h>
+#include <sk_fd_stream.h>
 #include <sk_image_info.h>
 #include <sk_pixmap.h>
+#include <sk_png_content_class.h>
+#include <sk_rect.h>
+#include <sk_visible_bounds.h>
 #include <vector_wstream.h>
 
+#include <callback_wstream.h>
+#include <completion_queue.h>
+#include <encode_estimate.h>
+#include <encode_scheduler.h>
+#include <push_encoder.h>
+#include <stepped_encoder.h>
+
 #include <png_codec.h>
 #include <simple_bgra_8888_transformer.h>
 
 #include <skbitmap_to_png.h>
 
-extern "C" TransformResult transform_to_png(int width, int height, size_t size, void *buf) {
-    auto info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType);
-    auto size_bytes = info.computeMinByteSize();
+struct TransformCancelToken {
+    std::atomic<bool> cancelled;
+};
+
+typedef TransformResult (*TransformProc)(int width, int height, size_t size, void *buf,
+                                         const TransformOptions *options);
+
+typedef TransformStatus (*StreamProc)(int width, int height, size_t size, void *buf,
+                                      const TransformOptions *options, SkWStream *dst);
+
+static TransformResult failure(TransformStatus status) {
+    TransformResult result{};
+    result.status = status;
+    result.content_class = kTransformContentUnclassified;
+    return result;
+}
+
+static TransformResult success(std::vector<unsigned char> *encoded) {
+    TransformResult result{};
+    result.handle = reinterpret_cast<void *>(encoded);
+    result.encoded = encoded->data();
+    result.size = encoded->size();
+    result.status = kTransformOk;
+    result.content_class = kTransformContentUnclassified;
+    return result;
+}
+
+static TransformStatus status_for(const SkEncodeLimits &limits) {
+    switch(limits.result()) {
+        case SkEncodeLimits::Result::kOk:
+            return kTransformEncodeFailed;
+        case SkEncodeLimits::Result::kDeadlineExceeded:
+            return kTransformDeadlineExceeded;
+        case SkEncodeLimits::Result::kCancelled:
+            return kTransformCancelled;
+        case SkEncodeLimits::Result::kOutputTooLarge:
+            return kTransformOutputTooLarge;
+    }
+
+    return kTransformEncodeFailed;
+}
+
+static SkEncodeLimits::Clock::time_point deadline_for(const TransformOptions *options) {
+    if(options == nullptr || options->deadline_ns == 0)
+        return SkEncodeLimits::Clock::time_point::max();
+
+    return SkEncodeLimits::Clock::time_point(
+        std::chrono::duration_cast<SkEncodeLimits::Clock::duration>(
+            std::chrono::nanoseconds(options->deadline_ns)));
+}
+
+static SkEncodeLimits make_limits(const TransformOptions *options) {
+    SkEncodeLimits limits;
+    if(options == nullptr)
+        return limits;
+
+    limits.setDeadline(deadline_for(options));
+    limits.setMaxOutputBytes(options->max_output_bytes);
+    if(options->cancel != nullptr)
+        limits.setCancelFlag(&options->cancel->cancelled);
+
+    return limits;
+}
+
+static EncodeScheduler::Lane lane_for(const TransformOptions *options) {
+    if(options != nullptr && options->priority == kTransformPriorityBulk)
+        return EncodeScheduler::kBulk;
+
+    return EncodeScheduler::kInteractive;
+}
+
+static int threads_for(const TransformOptions *options) {
+    if(options == nullptr)
+        return 1;
+
+    if(options->max_threads < 0)
+        return std::max(1, (int)std::thread::hardware_concurrency());
+
+    return std::max(1, options->max_threads);
+}
+
+static SkColorType color_type_for(const TransformOptions *options) {
+    if(options == nullptr)
+        return kBGRA_8888_SkColorType;
+
+    switch(options->color_type) {
+        case kTransformColorBGRA8888:
+            return kBGRA_8888_SkColorType;
+        case kTransformColorRGBA8888:
+            return kRGBA_8888_SkColorType;
+        case kTransformColorRGB565:
+            return kRGB_565_SkColorType;
+        case kTransformColorAlpha8:
+            return kAlpha_8_SkColorType;
+        case kTransformColorGray8:
+            return kGray_8_SkColorType;
+        case kTransformColorRGBAF16:
+            return kRGBA_F16_SkColorType;
+    }
+
+    return kUnknown_SkColorType;
+}
+
+static SkAlphaType alpha_type_for(const TransformOptions *options) {
+    if(options == nullptr)
+        return kPremul_SkAlphaType;
+
+    switch(options->alpha_type) {
+        case kTransformAlphaPremul:
+            return kPremul_SkAlphaType;
+        case kTransformAlphaUnpremul:
+            return kUnpremul_SkAlphaType;
+        case kTransformAlphaOpaque:
+            return kOpaque_SkAlphaType;
+    }
 
-    if(size_bytes != size) {
+    return kUnknown_SkAlphaType;
+}
+
+static bool color_space_for(const TransformOptions *options,
+                            std::shared_ptr<SkColorSpace> *color_space) {
+    *color_space = nullptr;
+    if(options == nullptr)
+        return true;
+
+    // sRGB input stays untagged so default output is unchanged.
+    switch(options->color_space) {
+        case kTransformColorSpaceSRGB:
+            return true;
+        case kTransformColorSpaceDisplayP3:
+            *color_space = SkColorSpace::MakeDisplayP3();
+            return true;
+        case kTransformColorSpaceAdobeRGB:
+            *color_space = SkColorSpace::MakeAdobeRGB();
+            return true;
+    }
+
+    return false;
+}
+
+static SkImageInfo info_for(int width, int height, const TransformOptions *options) {
+    std::shared_ptr<SkColorSpace> color_space;
+    color_space_for(options, &color_space);
+    return SkImageInfo::Make(width, height, color_type_for(options), alpha_type_for(options),
+                             std::move(color_space));
+}
+
+static bool validate_format(const SkImageInfo &info, const TransformOptions *options) {
+    if(info.colorType() == kUnknown_SkColorType || info.alphaType() == kUnknown_SkAlphaType) {
+        perror("unsupported color or alpha type");
+        return false;
+    }
+
+    std::shared_ptr<SkColorSpace> color_space;
+    if(!color_space_for(options, &color_space)) {
+        perror("unsupported color space");
+        return false;
+    }
+
+    return true;
+}
+
+static bool converts_to_srgb(const TransformOptions *options) {
+    return options != nullptr && options->convert_to_srgb != 0;
+}
+
+static SkPngEncoder::Options::ColorSpaceHandling color_space_handling_for(
+        const TransformOptions *options) {
+    return converts_to_srgb(options) ? SkPngEncoder::Options::ColorSpaceHandling::kConvertToSRGB
+                                     : SkPngEncoder::Options::ColorSpaceHandling::kEmbed;
+}
+
+static SkPngEncoder::Options::Engine png_engine_for(const TransformOptions *options) {
+    if(options != nullptr && options->png_engine == kTransformPngEngineFast)
+        return SkPngEncoder::Options::Engine::kFast;
+
+    return SkPngEncoder::Options::Engine::kLibpng;
+}
+
+// The BGRA transformer converts whatever color space its info carries, so
+// only pass one along when asked to convert.
+static SkImageInfo bgra_info_for(const SkPixmap &pixels, const TransformOptions *options) {
+    if(converts_to_srgb(options))
+        return pixels.info();
+
+    return pixels.info().makeColorSpace(nullptr);
+}
+
+static size_t row_bytes_for(const SkImageInfo &info, const TransformOptions *options) {
+    if(options == nullptr || options->row_bytes == 0)
+        return info.minRowBytes();
+
+    return options->row_bytes;
+}
+
+static bool validate_input(const SkImageInfo &info, const TransformOptions *options,
+                           size_t row_bytes, size_t size) {
+    if(!validate_format(info, options))
+        return false;
+
+    if(!info.validRowBytes(row_bytes)) {
+        perror("invalid row bytes");
+        return false;
+    }
+
+    auto size_bytes = info.computeByteSize(row_bytes);
+
+    // Padded rows may come from a buffer with a padded last row as well.
+    bool packed = row_bytes == info.minRowBytes();
+    if(SkImageInfo::ByteSizeOverflowed(size_bytes) || size < size_bytes ||
+       (packed && size != size_bytes)) {
         perror("invalid buffer size");
-        return { nullptr, 0 };
+        return false;
     }
 
-    if(width == 0 || height == 0) {
+    if(info.width() == 0 || info.height() == 0) {
         perror("invalid width or height given");
-        return { nullptr, 0 };
+        return false;
     }
 
-    auto pixels = SkPixmap(info, buf, info.minRowBytes());
-    auto encoded = new std::vector<unsigned char>;
+    return true;
+}
 
-    if(!PNGCodec::FastEncodeBGRASkBitmap(pixels, encoded))
-        return { nullptr, 0 };
-    
-    return {
-        reinterpret_cast<void *>(encoded),
-        encoded->data(),
-        encoded->size()
-    };
+static bool origin_for(const TransformOptions *options, SkEncodedOrigin *origin) {
+    *origin = kTopLeft_SkEncodedOrigin;
+    if(options == nullptr)
+        return true;
+
+    switch(options->orientation) {
+        case kTransformOrientationNone:
+            return true;
+        case kTransformOrientationFlipVertical:
+            *origin = kBottomLeft_SkEncodedOrigin;
+            return true;
+        case kTransformOrientationFlipHorizontal:
+            *origin = kTopRight_SkEncodedOrigin;
+            return true;
+        case kTransformOrientationRotate90:
+            *origin = kRightTop_SkEncodedOrigin;
+            return true;
+        case kTransformOrientationRotate180:
+            *origin = kBottomRight_SkEncodedOrigin;
+            return true;
+        case kTransformOrientationRotate270:
+            *origin = kLeftBottom_SkEncodedOrigin;
+            return true;
+    }
+
+    perror("unsupported orientation");
+    return false;
+}
+
+static bool has_geometry(const TransformOptions *options) {
+    return options != nullptr &&
+        (options->orientation != kTransformOrientationNone ||
+         options->crop_width != 0 || options->crop_height != 0);
+}
+
+// Validates the input and describes the pixels to encode: the crop rectangle
+// of |buf|, which is read in place, and the orientation to write it with. A
+// null |buf| describes the pixels without any to read.
+static bool prepare_input(int width, int height, size_t size, const void *buf,
+                          const TransformOptions *options, SkPixmap *pixels,
+                          SkEncodedOrigin *origin) {
+    auto info = info_for(width, height, options);
+
+    auto row_bytes = row_bytes_for(info, options);
+    if(!validate_input(info, options, row_bytes, size) || !origin_for(options, origin))
+        return false;
+
+    *pixels = SkPixmap(info, buf, row_bytes);
+    if(options == nullptr || (options->crop_width == 0 && options->crop_height == 0))
+        return true;
+
+    if(options->crop_width == 0 || options->crop_height == 0) {
+        perror("crop rectangle is empty");
+        return false;
+    }
+
+    if(options->crop_x < 0 || options->crop_y < 0 || options->crop_width < 0 ||
+       options->crop_height < 0 || options->crop_x > width - options->crop_width ||
+       options->crop_y > height - options->crop_height) {
+        perror("crop rectangle outside the input");
+        return false;
+    }
+
+    auto crop = info.makeWH(options->crop_width, options->crop_height);
+    *pixels = SkPixmap(crop, buf ? pixels->addr(options->crop_x, options->crop_y) : nullptr,
+                       row_bytes);
+    return true;
+}
+
+// Narrows |pixels| to the part of it that is not fully transparent and returns
+// where that part lands in the |origin| output.
+static SkIRect trim_transparent(SkPixmap *pixels, SkEncodedOrigin origin) {
+    SkIRect bounds;
+    if(!SkComputeVisibleBounds(*pixels, &bounds)) {
+        pixels->extractSubset(pixels, SkIRect::MakeWH(1, 1));
+        return SkIRect::MakeWH(1, 1);
+    }
+
+    auto placed = SkEncodedOriginMapRect(origin, pixels->width(), pixels->height(), bounds);
+    pixels->extractSubset(pixels, bounds);
+    return placed;
+}
+
+static TransformContentClass content_class_for(SkPngContentClass content_class) {
+    switch(content_class) {
+        case SkPngContentClass::kFlat:
+            return kTransformContentFlat;
+        case SkPngContentClass::kContinuousTone:
+            return kTransformContentContinuousTone;
+        case SkPngContentClass::kNoise:
+            return kTransformContentNoise;
+        default:
+            return kTransformContentUnclassified;
+    }
+}
+
+// Chooses how |pixels| are written as a png, trimming them first when asked
+// to, and fills in the geometry and settings chosen on |report| when it is not
+// null. Trimming and classifying need pixels to look at; without them the
+// fast defaults are used on the whole input.
+static SkPngEncoder::Options png_options_for(SkPixmap *pixels, SkEncodedOrigin origin,
+                                             const TransformOptions *options,
+                                             TransformResult *report) {
+    auto png_options = PNGCodec::FastEncodeOptions();
+    png_options.fOrigin = origin;
+    png_options.fPipelined = threads_for(options) > 1;
+    png_options.fColorSpaceHandling = color_space_handling_for(options);
+    png_options.fEngine = png_engine_for(options);
+    if(report != nullptr)
+        report->content_class = kTransformContentUnclassified;
+    if(options == nullptr || pixels->addr() == nullptr)
+        return png_options;
+
+    if(options->trim_transparent) {
+        auto placed = trim_transparent(pixels, origin);
+        png_options.fWriteOffset = options->trim_offset_chunk != 0;
+        png_options.fOffsetX = placed.x();
+        png_options.fOffsetY = placed.y();
+        if(report != nullptr) {
+            report->offset_x = placed.x();
+            report->offset_y = placed.y();
+        }
+    }
+
+    if(options->classify_content) {
+        auto content_class = SkClassifyPngContent(*pixels);
+        SkApplyPngContentClass(content_class, &png_options);
+        if(report != nullptr)
+            report->content_class = content_class_for(content_class);
+    }
+
+    return png_options;
+}
+
+// Helper threads a png encode with |png_options| asks for: the pipelined
+// libpng encode converts rows on one thread beside the encoding one.
+static int helpers_for(const SkPngEncoder::Options &png_options) {
+    if(!png_options.fPipelined || png_options.fEngine != SkPngEncoder::Options::Engine::kLibpng)
+        return 0;
+
+    return 1;
+}
+
+// Encodes the input as a png, filling in the geometry and settings chosen for
+// it on |report| when it is not null.
+static TransformStatus write_png(int width, int height, size_t size, void *buf,
+                                 const TransformOptions *options, SkWStream *dst,
+                                 TransformResult *report) {
+    SkPixmap pixels;
+    SkEncodedOrigin origin;
+    if(!prepare_input(width, height, size, buf, options, &pixels, &origin))
+        return kTransformInvalidInput;
+
+    auto limits = make_limits(options);
+
+    auto png_options = png_options_for(&pixels, origin, options, report);
+    png_options.fLimits = &limits;
+
+    EncodeScheduler::Helpers helper(EncodeScheduler::GetDefault(), lane_for(options),
+                                    helpers_for(png_options));
+    png_options.fPipelined = helper.count() > 0;
+
+    if(!PNGCodec::EncodeWithOptions(pixels, png_options, dst))
+        return status_for(limits);
+
+    return kTransformOk;
+}
+
+static TransformStatus write_png(int width, int height, size_t size, void *buf,
+                                 const TransformOptions *options, SkWStream *dst) {
+    return write_png(width, height, size, buf, options, dst, nullptr);
+}
+
+static TransformStatus write_bgra8888(int width, int height, size_t size, void *buf,
+                                      const TransformOptions *options, SkWStream *dst) {
+    SkPixmap pixels;
+    SkEncodedOrigin origin;
+    if(!prepare_input(width, height, size, buf, options, &pixels, &origin))
+        return kTransformInvalidInput;
+
+    auto limits = make_limits(options);
+
+    if(!SimpleBGRA8888Transformer::Encode(pixels, dst, bgra_info_for(pixels, options), &limits,
+                                          origin))
+        return status_for(limits);
+
+    return kTransformOk;
+}
+
+static TransformResult encode_png(int width, int height, size_t size, void *buf,
+                                  const TransformOptions *options) {
+    std::unique_ptr<std::vector<unsigned char>> encoded(new std::vector<unsigned char>);
+    VectorWStream dst(encoded.get());
+
+    TransformResult report = {};
+    auto status = write_png(width, height, size, buf, options, &dst, &report);
+    if(status != kTransformOk)
+        return failure(status);
+
+    auto result = success(encoded.release());
+    result.offset_x = report.offset_x;
+    result.offset_y = report.offset_y;
+    result.content_class = report.content_class;
+    return result;
+}
+
+static TransformResult encode_bgra8888(int width, int height, size_t size, void *buf,
+                                       const TransformOptions *options) {
+    SkPixmap pixels;
+    SkEncodedOrigin origin;
+    if(!prepare_input(width, height, size, buf, options, &pixels, &origin))
+        return failure(kTransformInvalidInput);
+
+    auto limits = make_limits(options);
+    auto info = bgra_info_for(pixels, options);
+    std::unique_ptr<std::vector<unsigned char>> encoded(new std::vector<unsigned char>);
+
+    // Bands split the output rows, so reoriented frames are transformed serially.
+    auto threads = threads_for(options);
+    if(threads > 1 && origin == kTopLeft_SkEncodedOrigin) {
+        // The calling thread transforms the first band in the slot it was
+        // admitted to; every other band needs a slot of its own.
+        EncodeScheduler::Helpers helpers(EncodeScheduler::GetDefault(), lane_for(options),
+                                         threads - 1);
+        if(helpers.count() > 0) {
+            // The output is always 4 bytes per pixel, whatever the input layout.
+            auto output_info = SkImageInfo::MakeN32(info.width(), info.height(),
+                                                    kPremul_SkAlphaType);
+            encoded->resize(output_info.computeMinByteSize());
+
+            if(!SimpleBGRA8888Transformer::EncodeParallel(pixels, encoded->data(), info,
+                                                          1 + helpers.count(), &limits))
+                return failure(status_for(limits));
+
+            return success(encoded.release());
+        }
+    }
+
+    VectorWStream dst(encoded.get());
+
+    if(!SimpleBGRA8888Transformer::Encode(pixels, &dst, info, &limits, origin))
+        return failure(status_for(limits));
+
+    return success(encoded.release());
+}
+
+static TransformResult run_scheduled(TransformProc transform, int width, int height, size_t size,
+                                     void *buf, const TransformOptions *options) {
+    EncodeScheduler::Scope scope(EncodeScheduler::GetDefault(), lane_for(options), size,
+                                 deadline_for(options));
+    if(!scope.admitted())
+        return failure(kTransformDeadlineExceeded);
+
+    return transform(width, height, size, buf, options);
+}
+
+extern "C" TransformResult transform_to_png(int width, int height, size_t size, void *buf) {
+    return transform_to_png_ex(width, height, size, buf, nullptr);
 }
 
 extern "C" TransformResult transform_to_bgra8888(int width, int height, size_t size, void *buf) {
-    auto info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType);
-    auto size_bytes = info.computeMinByteSize();
+    return transform_to_bgra8888_ex(width, height, size, buf, nullptr);
+}
 
-    if(size_bytes != size) {
-        perror("invalid buffer size");
-        return { nullptr, 0 };
+extern "C" TransformResult transform_to_png_ex(int width, int height, size_t size, void *buf,
+                                               const TransformOptions *options) {
+    return run_scheduled(encode_png, width, height, size, buf, options);
+}
+
+extern "C" TransformResult transform_to_bgra8888_ex(int width, int height, size_t size, void *buf,
+                                                    const TransformOptions *options) {
+    return run_scheduled(encode_bgra8888, width, height, size, buf, options);
+}
+
+static TransformStatus write_png_from_fd(int fd, int width, int height,
+                                         const TransformOptions *options, SkWStream *dst) {
+    auto info = info_for(width, height, options);
+
+    if(!validate_format(info, options))
+        return kTransformInvalidInput;
+
+    if(has_geometry(options)) {
+        perror("orientation and crop are not supported when reading rows");
+        return kTransformInvalidInput;
     }
 
-    if(width == 0 || height == 0) {
+    if(width <= 0 || height <= 0) {
         perror("invalid width or height given");
-        return { nullptr, 0 };
+        return kTransformInvalidInput;
+    }
+
+    auto row_bytes = row_bytes_for(info, options);
+    if(!info.validRowBytes(row_bytes)) {
+        perror("invalid row bytes");
+        return kTransformInvalidInput;
+    }
+
+    auto limits = make_limits(options);
+
+    auto png_options = PNGCodec::FastEncodeOptions();
+    png_options.fLimits = &limits;
+    png_options.fPipelined = threads_for(options) > 1;
+    png_options.fColorSpaceHandling = color_space_handling_for(options);
+    png_options.fEngine = png_engine_for(options);
+
+    EncodeScheduler::Helpers helper(EncodeScheduler::GetDefault(), lane_for(options),
+                                    helpers_for(png_options));
+    png_options.fPipelined = helper.count() > 0;
+
+    // The encoder refers to |shape| until it is destroyed.
+    SkPixmap shape(info, nullptr, info.minRowBytes());
+    auto encoder = SkPngEncoder::MakeForRows(dst, shape, png_options);
+    if(encoder == nullptr)
+        return kTransformEncodeFailed;
+
+    SkFDStream src(fd, false);
+    if(!encoder->encodeRows(&src, height, row_bytes)) {
+        if(limits.result() == SkEncodeLimits::Result::kOk && src.isAtEnd()) {
+            perror("input ended before the last row");
+            return kTransformInvalidInput;
+        }
+
+        return status_for(limits);
+    }
+
+    return kTransformOk;
+}
+
+extern "C" TransformResult transform_fd_to_png(int fd, int width, int height,
+                                               const TransformOptions *options) {
+    EncodeScheduler::Scope scope(EncodeScheduler::GetDefault(), lane_for(options),
+                                 SkFDStream::kDefaultReadAhead, deadline_for(options));
+    if(!scope.admitted())
+        return failure(kTransformDeadlineExceeded);
+
+    std::unique_ptr<std::vector<unsigned char>> encoded(new std::vector<unsigned char>);
+    VectorWStream dst(encoded.get());
+
+    auto status = write_png_from_fd(fd, width, height, options, &dst);
+    if(status != kTransformOk)
+        return failure(status);
+
+    return success(encoded.release());
+}
+
+extern "C" int transform_fd_to_png_stream(int fd, int width, int height,
+                                          const TransformOptions *options,
+                                          TransformWriteCallback write, void *user_data) {
+    if(write == nullptr) {
+        perror("invalid write callback given");
+        return kTransformInvalidInput;
+    }
+
+    EncodeScheduler::Scope scope(EncodeScheduler::GetDefault(), lane_for(options),
+                                 SkFDStream::kDefaultReadAhead, deadline_for(options));
+    if(!scope.admitted())
+        return kTransformDeadlineExceeded;
+
+    CallbackWStream dst(write, user_data);
+    return write_png_from_fd(fd, width, height, options, &dst);
+}
+
+static int run_streamed(StreamProc transform, int width, int height, size_t size, void *buf,
+                        const TransformOptions *options, TransformWriteCallback write,
+                        void *user_data) {
+    if(write == nullptr) {
+        perror("invalid write callback given");
+        return kTransformInvalidInput;
+    }
+
+    EncodeScheduler::Scope scope(EncodeScheduler::GetDefault(), lane_for(options), size,
+                                 deadline_for(options));
+    if(!scope.admitted())
+        return kTransformDeadlineExceeded;
+
+    CallbackWStream dst(write, user_data);
+    return transform(width, height, size, buf, options, &dst);
+}
+
+extern "C" int transform_to_png_stream(int width, int height, size_t size, void *buf,
+                                       const TransformOptions *options,
+                                       TransformWriteCallback write, void *user_data) {
+    return run_streamed(write_png, width, height, size, buf, options, write, user_data);
+}
+
+extern "C" int transform_to_bgra8888_stream(int width, int height, size_t size, void *buf,
+                                            const TransformOptions *options,
+                                            TransformWriteCallback write, void *user_data) {
+    return run_streamed(write_bgra8888, width, height, size, buf, options, write, user_data);
+}
+
+extern "C" size_t compute_min_bytesize(int width, int height) {
+    return compute_bytesize_ex(width, height, nullptr);
+}
+
+extern "C" size_t compute_bytesize(int width, int height, size_t row_bytes) {
+    TransformOptions options = {};
+    options.row_bytes = row_bytes;
+    return compute_bytesize_ex(width, height, &options);
+}
+
+extern "C" size_t compute_bytesize_ex(int width, int height, const TransformOptions *options) {
+    auto info = info_for(width, height, options);
+    auto row_bytes = row_bytes_for(info, options);
+    if(width < 0 || height < 0 || info.colorType() == kUnknown_SkColorType ||
+       !info.validRowBytes(row_bytes))
+        return SIZE_MAX;
+
+    return info.computeByteSize(row_bytes);
+}
+
+extern "C" TransformResult transform_to_png_strided(int width, int height, size_t row_bytes,
+                                                    size_t size, void *buf) {
+    TransformOptions options = {};
+    options.row_bytes = row_bytes;
+    return transform_to_png_ex(width, height, size, buf, &options);
+}
+
+extern "C" TransformResult transform_to_bgra8888_strided(int width, int height, size_t row_bytes,
+                                                         size_t size, void *buf) {
+    TransformOptions options = {};
+    options.row_bytes = row_bytes;
+    return transform_to_bgra8888_ex(width, height, size, buf, &options);
+}
+
+static int submit_async(TransformProc transform, const TransformJob *job,
+                        TransformCallback callback, void *user_data) {
+    if(job == nullptr) {
+        perror("invalid job given");
+        return -1;
+    }
+
+    auto copy = *job;
+    auto deliver = [copy, callback, user_data](TransformResult result) {
+        if(callback != nullptr) {
+            callback(result, user_data);
+            return;
+        }
+
+        CompletionQueue::GetDefault()->push({ user_data, copy.buf, result });
+    };
+
+    // A job whose deadline passes while it is queued completes without running.
+    EncodeScheduler::GetDefault()->schedule(lane_for(&copy.options), copy.size,
+                                            deadline_for(&copy.options),
+                                            [transform, copy, deliver] {
+        deliver(transform(copy.width, copy.height, copy.size, copy.buf, &copy.options));
+    }, [deliver] {
+        deliver(failure(kTransformDeadlineExceeded));
+    });
+
+    return 0;
+}
+
+extern "C" int transform_to_png_async(const TransformJob *job, TransformCallback callback, void *user_data) {
+    return submit_async(encode_png, job, callback, user_data);
+}
+
+extern "C" int transform_to_bgra8888_async(const TransformJob *job, TransformCallback callback, void *user_data) {
+    return submit_async(encode_bgra8888, job, callback, user_data);
+}
+
+extern "C" int transform_completion_fd() {
+    return CompletionQueue::GetDefault()->fd();
+}
+
+extern "C" size_t transform_drain_completions(TransformCompletion *out, size_t max) {
+    if(out == nullptr) {
+        return 0;
     }
 
-    auto pixels = SkPixmap(info, buf, info.minRowBytes());
-    auto encoded = new std::vector<unsigned char>;
+    return CompletionQueue::GetDefault()->drain(out, max);
+}
+
+static void *begin_stepped(SteppedEncoder::Kind kind, int width, int height, size_t size, void *buf,
+                           const TransformOptions *options) {
+    SkPixmap pixels;
+    SkEncodedOrigin origin;
+    if(!prepare_input(width, height, size, buf, options, &pixels, &origin))
+        return nullptr;
+
+    return SteppedEncoder::Make(kind, pixels.info(), pixels.addr(), pixels.rowBytes(),
+                                make_limits(options), origin,
+                                color_space_handling_for(options),
+                                png_engine_for(options)).release();
+}
+
+extern "C" void *transform_begin_png(int width, int height, size_t size, void *buf,
+                                     const TransformOptions *options) {
+    return begin_stepped(SteppedEncoder::kPng, width, height, size, buf, options);
+}
+
+extern "C" void *transform_begin_bgra8888(int width, int height, size_t size, void *buf,
+                                          const TransformOptions *options) {
+    return begin_stepped(SteppedEncoder::kBGRA8888, width, height, size, buf, options);
+}
 
-    encoded->clear();
-    VectorWStream dst(encoded);
+extern "C" TransformProgress transform_step(void *handle, uint32_t budget_us) {
+    auto encoder = reinterpret_cast<SteppedEncoder *>(handle);
+    if(encoder == nullptr)
+        return { 0, 0, 0, 1 };
 
-    if(!SimpleBGRA8888Transformer::Encode(pixels, &dst, info))
-        return { nullptr, 0 };
+    encoder->step(budget_us);
 
     return {
-        reinterpret_cast<void *>(encoded),
-        encoded->data(),
-        encoded->size()
+        encoder->rowsEncoded(),
+        encoder->rows(),
+        encoder->done(),
+        encoder->failed()
     };
 }
 
-extern "C" size_t compute_min_bytesize(int width, int height) {
-    auto info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType);
-    return info.computeMinByteSize();
+extern "C" TransformResult transform_finish(void *handle) {
+    std::unique_ptr<SteppedEncoder> encoder(reinterpret_cast<SteppedEncoder *>(handle));
+    if(encoder == nullptr)
+        return failure(kTransformInvalidInput);
+
+    if(encoder->failed())
+        return failure(status_for(encoder->limits()));
+
+    if(!encoder->done())
+        return failure(kTransformIncomplete);
+
+    return success(encoder->releaseOutput());
+}
+
+static void *begin_push(int width, int height, const TransformOptions *options,
+                        std::unique_ptr<SkWStream> output) {
+    auto info = info_for(width, height, options);
+
+    if(!validate_format(info, options))
+        return nullptr;
+
+    if(has_geometry(options)) {
+        perror("orientation and crop are not supported when pushing rows");
+        return nullptr;
+    }
+
+    if(width <= 0 || height <= 0) {
+        perror("invalid width or height given");
+        return nullptr;
+    }
+
+    return PushEncoder::Make(info, make_limits(options), threads_for(options) > 1,
+                             color_space_handling_for(options), png_engine_for(options),
+                             std::move(output)).release();
+}
+
+extern "C" void *png_encoder_begin(int width, int height, const TransformOptions *options) {
+    return begin_push(width, height, options, nullptr);
+}
+
+extern "C" void *png_encoder_begin_stream(int width, int height, const TransformOptions *options,
+                                          TransformWriteCallback write, void *user_data) {
+    if(write == nullptr) {
+        perror("invalid write callback given");
+        return nullptr;
+    }
+
+    return begin_push(width, height, options,
+                      std::unique_ptr<SkWStream>(new CallbackWStream(write, user_data)));
+}
+
+extern "C" int png_encoder_push_rows(void *handle, const void *rows, int count, size_t row_bytes) {
+    auto encoder = reinterpret_cast<PushEncoder *>(handle);
+    if(encoder == nullptr)
+        return kTransformInvalidInput;
+
+    if(encoder->failed())
+        return status_for(encoder->limits());
+
+    if(!encoder->push(rows, count, row_bytes))
+        return encoder->failed() ? status_for(encoder->limits()) : kTransformInvalidInput;
+
+    return kTransformOk;
+}
+
+extern "C" TransformResult png_encoder_finish(void *handle) {
+    std::unique_ptr<PushEncoder> encoder(reinterpret_cast<PushEncoder *>(handle));
+    if(encoder == nullptr)
+        return failure(kTransformInvalidInput);
+
+    if(!encoder->finish()) {
+        if(encoder->failed())
+            return failure(status_for(encoder->limits()));
+
+        return failure(kTransformIncomplete);
+    }
+
+    // Streamed output has already been handed to the write callback.
+    auto output = encoder->releaseOutput();
+    if(output == nullptr) {
+        TransformResult result{};
+        result.status = kTransformOk;
+        result.content_class = kTransformContentUnclassified;
+        return result;
+    }
+
+    return success(output);
+}
+
+extern "C" TransformEstimate estimate_encode(int width, int height, const TransformOptions *options,
+                                            size_t size, const void *sample_buf) {
+    TransformEstimate estimate = {};
+    estimate.status = kTransformInvalidInput;
+
+    // Without a sample the buffer only has to be describable.
+    if(sample_buf == nullptr)
+        size = compute_bytesize_ex(width, height, options);
+
+    SkPixmap pixels;
+    SkEncodedOrigin origin;
+    if(!prepare_input(width, height, size, sample_buf, options, &pixels, &origin))
+        return estimate;
+
+    auto png_options = png_options_for(&pixels, origin, options, nullptr);
+
+    EncodeEstimate encode;
+    if(!EstimatePngEncode(pixels, png_options, true, &encode))
+        return estimate;
+
+    estimate.status = kTransformOk;
+    estimate.max_output_bytes = encode.fMaxOutputBytes;
+    estimate.expected_output_bytes = encode.fExpectedOutputBytes;
+    estimate.peak_memory_bytes = encode.fPeakMemoryBytes;
+    estimate.expected_cpu_ns = encode.fExpectedCpuNs;
+    return estimate;
+}
+
+extern "C" uint64_t transform_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        SkEncodeLimits::Clock::now().time_since_epoch()).count();
+}
+
+extern "C" TransformCancelToken *transform_cancel_token_create() {
+    auto token = new TransformCancelToken;
+    token->cancelled = false;
+    return token;
+}
+
+extern "C" void transform_cancel(TransformCancelToken *token) {
+    if(token != nullptr)
+        token->cancelled = true;
+}
+
+extern "C" void transform_cancel_token_destroy(TransformCancelToken *token) {
+    delete token;
+}
+
+extern "C" void set_encode_limits(int max_concurrent, size_t max_inflight_bytes) {
+    EncodeScheduler::GetDefault()->setLimits(max_concurrent, max_inflight_bytes);
+}
+
+extern "C" EncodeStats get_encode_stats() {
+    auto stats = EncodeScheduler::GetDefault()->stats();
+
+    EncodeStats out;
+    out.running = stats.fRunning;
+    out.inflight_bytes = stats.fInflightBytes;
+
+    EncodeLaneStats *lanes[] = { &out.interactive, &out.bulk };
+    for(int i = 0; i < EncodeScheduler::kLaneCount; i++) {
+        auto &lane = stats.fLanes[i];
+        lanes[i]->admitted = lane.fAdmitted;
+        lanes[i]->queue_depth = lane.fQueueDepth;
+        lanes[i]->max_queue_depth = lane.fMaxQueueDepth;
+        lanes[i]->total_wait_us = lane.fTotalWaitUs;
+        lanes[i]->max_wait_us = lane.fMaxWaitUs;
+        lanes[i]->expired = lane.fExpired;
+    }
+
+    return out;
+}
+
+extern "C" const char *transform_cpu_variant() {
+    return SkCpu::Variant();
 }
 
 extern "C" void memfree(void *handle) {
@@ -1,15 +1,403 @@
+#pragma once
+
+#include <stdint.h>
 #include <stdlib.h>
 
+enum TransformStatus {
+    kTransformOk = 0,
+    kTransformInvalidInput,
+    kTransformEncodeFailed,
+    kTransformDeadlineExceeded,
+    kTransformCancelled,
+    kTransformOutputTooLarge,
+    // transform_finish() was called before the last transform_step(), or
+    // png_encoder_finish() before the last row was pushed.
+    kTransformIncomplete,
+};
+
 struct TransformResult {
     void *handle;
     void *encoded;
     size_t size;
+    int status;
+    // Position of the png within the output an untrimmed transform would
+    // have produced; zero unless TransformOptions::trim_transparent is set.
+    int offset_x;
+    int offset_y;
+    // The TransformContentClass TransformOptions::classify_content chose;
+    // kTransformContentUnclassified when it is off or the transform failed.
+    int content_class;
+};
+
+// Cancels every transform whose options refer to it; see transform_cancel().
+struct TransformCancelToken;
+
+enum TransformPriority {
+    // Latency-sensitive work, e.g. thumbnails. Always admitted before bulk work.
+    kTransformPriorityInteractive = 0,
+    // Throughput work, e.g. large batch renders.
+    kTransformPriorityBulk = 1,
+};
+
+// Pixel layout of the input.
+enum TransformColorType {
+    kTransformColorBGRA8888 = 0,
+    kTransformColorRGBA8888 = 1,
+    // 16-bit words with red in the high 5 bits and blue in the low 5 bits.
+    kTransformColorRGB565 = 2,
+    // One byte of coverage per pixel. Encodes to a grayscale png with coverage
+    // as the gray level, and to black BGRA_8888 with coverage as alpha.
+    kTransformColorAlpha8 = 3,
+    // One byte of gray level per pixel; encodes to a grayscale png.
+    kTransformColorGray8 = 4,
+    // Four half floats per pixel, red first. Encodes to a 16-bit per channel
+    // png; transform_to_bgra8888 quantises to 8 bits.
+    kTransformColorRGBAF16 = 5,
+};
+
+// How the alpha channel of the input relates to its color channels.
+enum TransformAlphaType {
+    // Color channels are multiplied by alpha and are divided out on encode.
+    kTransformAlphaPremul = 0,
+    // Color channels are independent of alpha and are copied as they are.
+    kTransformAlphaUnpremul = 1,
+    // Every pixel is opaque; the alpha channel is ignored, pngs are written
+    // without one and BGRA_8888 output gets alpha 255.
+    kTransformAlphaOpaque = 2,
+};
+
+// Flip or rotation applied to the input as it is encoded, so no reoriented
+// copy of the frame is needed.
+enum TransformOrientation {
+    kTransformOrientationNone = 0,
+    // Rows in bottom-up order, e.g. a GL readback.
+    kTransformOrientationFlipVertical = 1,
+    kTransformOrientationFlipHorizontal = 2,
+    // Rotations are clockwise; 90 and 270 swap the output width and height.
+    kTransformOrientationRotate90 = 3,
+    kTransformOrientationRotate180 = 4,
+    kTransformOrientationRotate270 = 5,
+};
+
+// Color space the input pixels are in.
+enum TransformColorSpace {
+    // Written untagged, as before color spaces were supported.
+    kTransformColorSpaceSRGB = 0,
+    kTransformColorSpaceDisplayP3 = 1,
+    kTransformColorSpaceAdobeRGB = 2,
+};
+
+// What a sample of the input's rows suggested about how it compresses.
+enum TransformContentClass {
+    // Not classified; the default encoder settings were used.
+    kTransformContentUnclassified = 0,
+    // Few colors or large flat areas, e.g. UI and text.
+    kTransformContentFlat = 1,
+    // Many colors that neighbouring pixels predict well, e.g. photos.
+    kTransformContentContinuousTone = 2,
+    // Close to random; entropy coded without searching for matches.
+    kTransformContentNoise = 3,
+};
+
+// What filters and deflates png rows.
+enum TransformPngEngine {
+    // libpng and zlib at level 1, as FastEncodeBGRASkBitmap encodes.
+    kTransformPngEngineLibpng = 0,
+    // Every row filtered Up and deflated by a single-pass coder that looks at
+    // each byte once: several times faster, for pngs about as large.
+    kTransformPngEngineFast = 1,
+};
+
+// Zero-initialized options select the defaults.
+struct TransformOptions {
+    int priority;
+
+    // Absolute deadline on the transform_now_ns() clock, zero for none. The
+    // transform fails with kTransformDeadlineExceeded once it passes, whether
+    // it is still queued or already encoding.
+    uint64_t deadline_ns;
+
+    // Checked between rows and on every output write; may be null.
+    TransformCancelToken *cancel;
+
+    // Fail with kTransformOutputTooLarge once the output would exceed this
+    // many bytes. Zero for unlimited.
+    size_t max_output_bytes;
+
+    // Worker threads one transform may use. 0 or 1 transforms on the calling
+    // thread; a negative value uses one thread per core. Threads beyond the
+    // calling one each take a slot of the encode limits, and are only used
+    // while slots are free. transform_to_bgra8888 splits the frame into that
+    // many row bands. transform_to_png, given more than one, converts pixels
+    // on a second thread while the calling thread filters and deflates; the
+    // output bytes are unchanged.
+    int max_threads;
+
+    // Distance in bytes between the starts of consecutive rows of the input,
+    // a multiple of the bytes per pixel of color_type no smaller than width
+    // pixels. Zero for tightly packed rows, where the buffer size must be
+    // exactly compute_bytesize_ex(); otherwise it must be at least that.
+    size_t row_bytes;
+
+    // A TransformColorType. RGB_565 input encodes to an opaque RGB png and to
+    // opaque BGRA_8888.
+    int color_type;
+
+    // A TransformAlphaType. Unpremultiplied and opaque input skips the
+    // unpremultiply division. Ignored for color types without alpha.
+    int alpha_type;
+
+    // A TransformOrientation, applied after cropping.
+    int orientation;
+
+    // Encodes only this rectangle of the input, in input pixels. Zero
+    // crop_width and crop_height encode the whole input; zero in only one of
+    // them is an empty rectangle and is rejected. The buffer size and
+    // row_bytes still describe the whole input.
+    int crop_x;
+    int crop_y;
+    int crop_width;
+    int crop_height;
+
+    // A TransformColorSpace. pngs of wide-gamut input carry its ICC profile in
+    // an iCCP chunk unless convert_to_srgb is set.
+    int color_space;
+
+    // Nonzero converts wide-gamut input to sRGB in the same pass that encodes
+    // it, and tags pngs as sRGB. BGRA_8888 output has no way to carry a color
+    // space, so without this it keeps the input's color values.
+    int convert_to_srgb;
+
+    // Nonzero encodes only the smallest rectangle holding every pixel that is
+    // not fully transparent, after cropping and before orientation, and
+    // reports where it sat in TransformResult::offset_x and offset_y. A fully
+    // transparent input encodes one transparent pixel at offset zero. Only
+    // the png transforms that take a whole buffer trim: the _ex, _stream and
+    // _async variants.
+    int trim_transparent;
+
+    // Nonzero also writes the trimmed offset into the png as an oFFs chunk,
+    // in pixels.
+    int trim_offset_chunk;
+
+    // Nonzero samples a few rows of the input to choose the png filters and
+    // zlib strategy and level, instead of the fast defaults, and reports the
+    // choice in TransformResult::content_class. Applies to the same png
+    // transforms as trim_transparent, and to input with 8-bit channels.
+    int classify_content;
+
+    // A TransformPngEngine, for every png transform. The fast engine ignores
+    // the filters and zlib settings classify_content chooses, and deflates on
+    // the calling thread whatever max_threads says.
+    int png_engine;
+};
+
+// Describes one frame, premultiplied BGRA_8888 unless options.color_type and
+// options.alpha_type say otherwise. |buf| is borrowed, not copied, by the
+// asynchronous entry points and must stay valid until completion.
+struct TransformJob {
+    int width;
+    int height;
+    size_t size;
+    void *buf;
+    TransformOptions options;
+};
+
+struct TransformCompletion {
+    void *user_data;
+    void *buf;
+    TransformResult result;
+};
+
+// Called on a worker thread. The callback owns |result| and releases it with memfree().
+typedef void (*TransformCallback)(TransformResult result, void *user_data);
+
+// Receives the output in order, |size| bytes at |data|, as it is produced, on
+// the thread doing the encoding. Return nonzero to continue; zero fails the
+// transform with kTransformEncodeFailed.
+typedef int (*TransformWriteCallback)(const void *data, size_t size, void *user_data);
+
+struct TransformProgress {
+    int rows_encoded;
+    int rows_total;
+    int done;
+    int failed;
+};
+
+struct EncodeLaneStats {
+    uint64_t admitted;
+    uint64_t queue_depth;
+    uint64_t max_queue_depth;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+    uint64_t expired;
+};
+
+struct EncodeStats {
+    int running;
+    size_t inflight_bytes;
+    EncodeLaneStats interactive;
+    EncodeLaneStats bulk;
+};
+
+// What a png transform is expected to cost; see estimate_encode().
+struct TransformEstimate {
+    // A TransformStatus.
+    int status;
+    // No png of the input can be larger.
+    size_t max_output_bytes;
+    // Projected from encoding a few bands of sampled rows.
+    size_t expected_output_bytes;
+    // Encoder buffers, deflate state and the growing output buffer.
+    size_t peak_memory_bytes;
+    // Projected CPU time on one thread of this host; max_threads spreads it
+    // over two threads without reducing it.
+    uint64_t expected_cpu_ns;
 };
 
 extern "C" {
     TransformResult transform_to_png(int width, int height, size_t size, void *buf);
     TransformResult transform_to_bgra8888(int width, int height, size_t size, void *buf);
+
+    // Bytes needed for a packed frame, computed in size_t so frames over 2 GiB
+    // are sized exactly. Returns SIZE_MAX on overflow.
     size_t compute_min_bytesize(int width, int height);
 
+    // Bytes needed for a frame with rows |row_bytes| apart; the last row need
+    // not be padded. Returns SIZE_MAX on overflow. Both sizes are for 4 bytes
+    // per pixel, the default BGRA_8888 input; compute_bytesize_ex() sizes the
+    // other color types.
+    size_t compute_bytesize(int width, int height, size_t row_bytes);
+
+    // Bytes needed for a frame of TransformOptions::color_type pixels with
+    // rows TransformOptions::row_bytes apart, or packed when that is zero;
+    // the last row need not be padded. |options| may be null. Returns
+    // SIZE_MAX on overflow, and for a color type or row_bytes the transforms
+    // reject.
+    size_t compute_bytesize_ex(int width, int height, const TransformOptions *options);
+
+    // Same as transform_to_png/transform_to_bgra8888 for padded rows, without
+    // repacking them first. Shorthand for the _ex variants with only
+    // TransformOptions::row_bytes set.
+    TransformResult transform_to_png_strided(int width, int height, size_t row_bytes,
+                                             size_t size, void *buf);
+    TransformResult transform_to_bgra8888_strided(int width, int height, size_t row_bytes,
+                                                  size_t size, void *buf);
+
+    // Same as above, admitted through the encode scheduler in the lane chosen by |options|.
+    // |options| may be null.
+    TransformResult transform_to_png_ex(int width, int height, size_t size, void *buf,
+                                        const TransformOptions *options);
+    TransformResult transform_to_bgra8888_ex(int width, int height, size_t size, void *buf,
+                                             const TransformOptions *options);
+
+    // Same as the _ex variants, handing the output to |write| as it is
+    // produced instead of collecting it, so memory use does not grow with the
+    // output. Returns a TransformStatus. transform_to_bgra8888_stream ignores
+    // TransformOptions::max_threads.
+    int transform_to_png_stream(int width, int height, size_t size, void *buf,
+                                const TransformOptions *options,
+                                TransformWriteCallback write, void *user_data);
+    int transform_to_bgra8888_stream(int width, int height, size_t size, void *buf,
+                                     const TransformOptions *options,
+                                     TransformWriteCallback write, void *user_data);
+
+    // Encodes a frame read from |fd| (a file, a pipe or a socket, e.g. 0 for
+    // stdin) as rows of TransformOptions::color_type pixels, row_bytes apart;
+    // the last row need not be padded. Only a band of rows and a read-ahead
+    // buffer are held in memory, and |fd| is left open. Fails with
+    // kTransformInvalidInput if the descriptor ends before the last row.
+    // Orientation and crop options are not supported. A frame of one color is
+    // encoded as any other: only the transforms given the whole frame up front
+    // see that it is one color and write a one-entry palette png, which
+    // decodes to the same pixels.
+    TransformResult transform_fd_to_png(int fd, int width, int height,
+                                        const TransformOptions *options);
+    int transform_fd_to_png_stream(int fd, int width, int height,
+                                   const TransformOptions *options,
+                                   TransformWriteCallback write, void *user_data);
+
+    // Queue the transform on the internal thread pool and return immediately.
+    // When |callback| is null the completion is pushed to the queue drained by
+    // transform_drain_completions() instead. A job whose deadline passes while
+    // it waits for admission completes with kTransformDeadlineExceeded without
+    // being run. Returns 0 on success, -1 otherwise.
+    int transform_to_png_async(const TransformJob *job, TransformCallback callback,
+                               void *user_data);
+    int transform_to_bgra8888_async(const TransformJob *job, TransformCallback callback,
+                                    void *user_data);
+
+    // Descriptor that becomes readable when queued completions are pending.
+    int transform_completion_fd();
+    size_t transform_drain_completions(TransformCompletion *out, size_t max);
+
+    // Resumable transforms for single-threaded hosts. begin borrows |buf| until
+    // transform_finish(). Each transform_step() encodes at least one row and
+    // stops once |budget_us| is spent; for a png whose first row is one color,
+    // the first steps may instead read ahead to tell whether the whole frame
+    // is, leaving rows_encoded at zero. transform_finish() releases the handle
+    // and returns the output once done, or an empty result with
+    // kTransformIncomplete otherwise.
+    // Stepped transforms bypass the encode scheduler, so options->priority does
+    // not apply to them; the caller paces them.
+    void *transform_begin_png(int width, int height, size_t size, void *buf,
+                              const TransformOptions *options);
+    void *transform_begin_bgra8888(int width, int height, size_t size, void *buf,
+                                   const TransformOptions *options);
+    TransformProgress transform_step(void *handle, uint32_t budget_us);
+    TransformResult transform_finish(void *handle);
+
+    // Incremental png encoding for frames produced a band at a time; only the
+    // pushed bands and the output are held in memory. push_rows() takes the
+    // next |count| rows of TransformOptions::color_type pixels, |row_bytes|
+    // apart, and returns a TransformStatus. With TransformOptions::max_threads
+    // above one, the band is copied and encoded on a worker while the caller
+    // renders the next one; otherwise it is encoded before push_rows()
+    // returns. png_encoder_finish() releases the handle and returns the output
+    // once all |height| rows were pushed, or an empty result with
+    // kTransformIncomplete otherwise. Orientation and crop options are not
+    // supported and make begin() return null. As with transform_fd_to_png, a
+    // frame of one color is not written as a palette png.
+    void *png_encoder_begin(int width, int height, const TransformOptions *options);
+
+    // Same as png_encoder_begin, handing the output to |write| as it is
+    // produced; png_encoder_finish() then returns a result without output.
+    // Together with pushed bands this encodes frames of any size in bounded
+    // memory.
+    void *png_encoder_begin_stream(int width, int height, const TransformOptions *options,
+                                   TransformWriteCallback write, void *user_data);
+    int png_encoder_push_rows(void *handle, const void *rows, int count, size_t row_bytes);
+    TransformResult png_encoder_finish(void *handle);
+
+    // Estimates what transform_to_png_ex() with |options| would cost, for
+    // admission control ahead of the transform. A few bands of rows of
+    // |sample_buf|, a frame described by |size| and |options| as for the
+    // transform, are encoded and scaled up, using a per-row CPU cost measured
+    // on this host. |sample_buf| may be null, in which case random bytes stand
+    // in for the rows and the expected values are those of incompressible
+    // input. Trimming and content classification only apply with a sample.
+    TransformEstimate estimate_encode(int width, int height, const TransformOptions *options,
+                                      size_t size, const void *sample_buf);
+
+    // Monotonic clock used by TransformOptions::deadline_ns.
+    uint64_t transform_now_ns();
+
+    // A token may be shared by several transforms and cancelled from any
+    // thread. Destroy it only after every transform using it has completed.
+    TransformCancelToken *transform_cancel_token_create();
+    void transform_cancel(TransformCancelToken *token);
+    void transform_cancel_token_destroy(TransformCancelToken *token);
+
+    // Limits for every encode in the process. |max_concurrent| <= 0 selects the
+    // number of cores; |max_inflight_bytes| of zero disables the input byte limit.
+    void set_encode_limits(int max_concurrent, size_t max_inflight_bytes);
+    EncodeStats get_encode_stats();
+
+    // Name of the pixel and fast png engine kernel variant this host runs:
+    // "avx2", "ssse3", "sse2", "neon" or "scalar". Setting SKBITMAP_TO_PNG_CPU
+    // to one of these names before the first encode caps the kernels at that
+    // variant.
+    const char *transform_cpu_variant();
+
     void memfree(void *handle);
-}
\ No newline at end of file
+}
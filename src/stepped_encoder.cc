@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+
+#include <png_codec.h>
+#include <simple_bgra_8888_transformer.h>
+
+#include <stepped_encoder.h>
+
+using Clock = std::chrono::steady_clock;
+
+std::unique_ptr<SteppedEncoder> SteppedEncoder::Make(
+        Kind kind, const SkImageInfo& info, const void* pixels, size_t rowBytes,
+        const SkEncodeLimits& limits, SkEncodedOrigin origin,
+        SkPngEncoder::Options::ColorSpaceHandling colorSpace,
+        SkPngEncoder::Options::Engine engine) {
+    std::unique_ptr<SteppedEncoder> encoder(
+            new SteppedEncoder(info, pixels, rowBytes, limits, origin));
+
+    switch (kind) {
+        case kPng: {
+            SkPngEncoder::Options options = PNGCodec::FastEncodeOptions();
+            options.fLimits = &encoder->fLimits;
+            options.fOrigin = origin;
+            options.fColorSpaceHandling = colorSpace;
+            options.fEngine = engine;
+            encoder->fEncoder = PNGCodec::MakeEncoder(encoder->fPixmap, options,
+                                                      &encoder->fStream);
+            break;
+        }
+        case kBGRA8888: {
+            // The transformer converts any color space it is given.
+            const bool convert =
+                    colorSpace == SkPngEncoder::Options::ColorSpaceHandling::kConvertToSRGB;
+            encoder->fEncoder = SimpleBGRA8888Transformer::Make(
+                    encoder->fPixmap, &encoder->fStream,
+                    convert ? info : info.makeColorSpace(nullptr), &encoder->fLimits, origin);
+            break;
+        }
+    }
+
+    if (!encoder->fEncoder) {
+        return nullptr;
+    }
+    return encoder;
+}
+
+SteppedEncoder::SteppedEncoder(const SkImageInfo& info, const void* pixels, size_t rowBytes,
+                               const SkEncodeLimits& limits, SkEncodedOrigin origin)
+    : fLimits(limits)
+    , fPixmap(info, pixels, rowBytes)
+    , fOutput(new std::vector<unsigned char>)
+    , fStream(fOutput.get())
+    , fRows(SkEncodedOriginSwapsWidthHeight(origin) ? info.width() : info.height())
+    , fRowsEncoded(0)
+    , fNsPerRow(0)
+    , fFailed(false)
+{}
+
+bool SteppedEncoder::step(uint32_t budgetUs) {
+    if (fFailed || this->done()) {
+        return !fFailed;
+    }
+
+    const double budgetNs = budgetUs * 1000.0;
+    const auto start = Clock::now();
+    double spentNs = 0;
+
+    do {
+        int remaining = fRows - fRowsEncoded;
+        int rows = 1;
+        if (fNsPerRow > 0) {
+            rows = (int)std::min<double>(remaining,
+                                         std::max(1.0, (budgetNs - spentNs) / fNsPerRow));
+        }
+
+        const auto before = Clock::now();
+        if (!fEncoder->encodeRows(rows)) {
+            fFailed = true;
+            return false;
+        }
+        const auto after = Clock::now();
+        fRowsEncoded = fEncoder->rowsEncoded();
+
+        // Smooth the estimate so one slow row does not starve the next steps.  It is per row
+        // asked for, which the png encoder may only read ahead in before encoding any.
+        double measured = std::chrono::duration<double, std::nano>(after - before).count() / rows;
+        fNsPerRow = fNsPerRow > 0 ? (fNsPerRow + measured) / 2 : measured;
+        spentNs = std::chrono::duration<double, std::nano>(after - start).count();
+    } while (!this->done() && spentNs + fNsPerRow <= budgetNs);
+
+    return true;
+}
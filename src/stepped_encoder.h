@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <sk_encode_limits.h>
+#include <sk_encoded_origin.h>
+#include <sk_encoder.h>
+#include <sk_image_info.h>
+#include <sk_pixmap.h>
+#include <sk_png_encoder.h>
+#include <vector_wstream.h>
+
+/**
+ *  Drives an SkEncoder a few rows at a time so that a single-threaded host can interleave
+ *  encoding with other work.  Each step() encodes at least one row and then as many more as
+ *  its time budget allows, using the measured cost of previous rows to decide how many fit.
+ *  A png whose first row is one color may first take steps that only read ahead, to tell
+ *  whether it is all that color, and encode no row.
+ */
+class SteppedEncoder {
+public:
+    enum Kind {
+        kPng,
+        kBGRA8888,
+    };
+
+    /**
+     *  |pixels| is borrowed and must stay valid until the encoder is destroyed.  Every step()
+     *  honours |limits|, and rows are flipped or rotated by |origin| as they are encoded.
+     *  |colorSpace| decides how a color space on |info| reaches the output; BGRA output is
+     *  only converted, never tagged.  |engine| filters and deflates png rows.
+     *
+     *  Returns nullptr on an invalid or unsupported |info|.
+     */
+    static std::unique_ptr<SteppedEncoder> Make(
+            Kind kind, const SkImageInfo& info, const void* pixels, size_t rowBytes,
+            const SkEncodeLimits& limits,
+            SkEncodedOrigin origin = kTopLeft_SkEncodedOrigin,
+            SkPngEncoder::Options::ColorSpaceHandling colorSpace =
+                    SkPngEncoder::Options::ColorSpaceHandling::kEmbed,
+            SkPngEncoder::Options::Engine engine = SkPngEncoder::Options::Engine::kLibpng);
+
+    /** Returns false once encoding has failed. */
+    bool step(uint32_t budgetUs);
+
+    int rowsEncoded() const { return fRowsEncoded; }
+    int rows() const { return fRows; }
+    bool done() const { return !fFailed && fRowsEncoded == fRows; }
+    bool failed() const { return fFailed; }
+    const SkEncodeLimits& limits() const { return fLimits; }
+
+    /** Transfers the encoded bytes to the caller.  Only valid once done(). */
+    std::vector<unsigned char>* releaseOutput() { return fOutput.release(); }
+
+private:
+    SteppedEncoder(const SkImageInfo& info, const void* pixels, size_t rowBytes,
+                   const SkEncodeLimits& limits, SkEncodedOrigin origin);
+
+    // Declared in dependency order: the encoder refers to fLimits, fPixmap and fStream.
+    SkEncodeLimits                              fLimits;
+    SkPixmap                                    fPixmap;
+    std::unique_ptr<std::vector<unsigned char>> fOutput;
+    VectorWStream                               fStream;
+    std::unique_ptr<SkEncoder>                  fEncoder;
+
+    // Rows of the encoded image, which is fPixmap with its origin applied.
+    int    fRows;
+    int    fRowsEncoded;
+    double fNsPerRow;
+    bool   fFailed;
+};
@@ -0,0 +1,112 @@
+#include <poll.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static std::atomic<bool> entered(false);
+static std::atomic<bool> released(false);
+
+// Collects the png, holding its encode in the scheduler until released.
+static int collect(const void *data, size_t size, void *user_data) {
+    entered = true;
+    while(!released)
+        poll(nullptr, 0, 1);
+
+    auto bytes = reinterpret_cast<std::vector<unsigned char> *>(user_data);
+    bytes->insert(bytes->end(), (const unsigned char *)data, (const unsigned char *)data + size);
+    return 1;
+}
+
+// Waits until |done| holds, for up to ten seconds.
+template <typename Predicate>
+static bool wait_for(Predicate done) {
+    for(int waited = 0; waited < 10000; waited++) {
+        if(done())
+            return true;
+        poll(nullptr, 0, 1);
+    }
+
+    return false;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+    std::vector<unsigned char> expected_bytes((unsigned char *)expected.encoded,
+                                              (unsigned char *)expected.encoded + expected.size);
+
+    // two slots: one for either lane, one held back for interactive work
+    set_encode_limits(2, 0);
+    auto before = get_encode_stats();
+
+    TransformOptions bulk = {};
+    bulk.priority = kTransformPriorityBulk;
+
+    std::vector<unsigned char> first, second;
+    int first_status = -1, second_status = -1;
+    std::thread first_thread([&] {
+        first_status = transform_to_png_stream(800, 400, buffer.size(), buffer.data(), &bulk,
+                                               collect, &first);
+    });
+    if(!wait_for([] { return entered.load(); }))
+        return 1;
+
+    // the second bulk encode may not take the reserved slot
+    std::thread second_thread([&] {
+        second_status = transform_to_png_stream(800, 400, buffer.size(), buffer.data(), &bulk,
+                                                collect, &second);
+    });
+    if(!wait_for([] { return get_encode_stats().bulk.queue_depth == 1; }))
+        return 1;
+
+    auto stats = get_encode_stats();
+    if(stats.running != 1 || stats.inflight_bytes != buffer.size())
+        return 1;
+
+    // while interactive work still runs in it
+    TransformOptions interactive = {};
+    interactive.priority = kTransformPriorityInteractive;
+    auto result = transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &interactive);
+    if(result.status != kTransformOk || result.size != expected.size ||
+       memcmp(result.encoded, expected.encoded, expected.size) != 0)
+        return 1;
+
+    if(get_encode_stats().bulk.queue_depth != 1)
+        return 1;
+
+    released = true;
+    first_thread.join();
+    second_thread.join();
+
+    if(first_status != kTransformOk || second_status != kTransformOk ||
+       first != expected_bytes || second != expected_bytes)
+        return 1;
+
+    auto after = get_encode_stats();
+    std::cout << "interactive admitted: " << after.interactive.admitted - before.interactive.admitted
+              << ", bulk admitted: " << after.bulk.admitted - before.bulk.admitted
+              << ", bulk max queue depth: " << after.bulk.max_queue_depth << std::endl;
+
+    if(after.running != 0 || after.inflight_bytes != 0 || after.bulk.queue_depth != 0 ||
+       after.interactive.admitted - before.interactive.admitted != 1 ||
+       after.bulk.admitted - before.bulk.admitted != 2 || after.bulk.max_queue_depth < 1)
+        return 1;
+
+    memfree(result.handle);
+    memfree(expected.handle);
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto encoded = transform_to_png(800, 400, buffer.size(), buffer.data());
+    if(encoded.status != kTransformOk)
+        return 1;
+
+    // sampled rows predict the output within a factor of two
+    auto estimate = estimate_encode(800, 400, nullptr, buffer.size(), buffer.data());
+    if(estimate.status != kTransformOk || estimate.max_output_bytes < encoded.size ||
+       estimate.expected_output_bytes > 2 * encoded.size ||
+       2 * estimate.expected_output_bytes < encoded.size ||
+       estimate.peak_memory_bytes < estimate.expected_output_bytes ||
+       estimate.expected_cpu_ns == 0)
+        return 1;
+
+    // without a sample, the input is assumed incompressible
+    auto worst = estimate_encode(800, 400, nullptr, 0, nullptr);
+    if(worst.status != kTransformOk || worst.max_output_bytes != estimate.max_output_bytes ||
+       worst.expected_output_bytes < 800 * 400 * 4 / 2 ||
+       worst.expected_output_bytes > worst.max_output_bytes)
+        return 1;
+
+    if(estimate_encode(0, 400, nullptr, 0, nullptr).status != kTransformInvalidInput)
+        return 1;
+
+    memfree(encoded.handle);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <cstdint>
+#include <vector>
+
+#include <sk_image_info.h>
+#include <sk_row_transform.h>
+#include <skcms.h>
+
+// Transforms one row of premultiplied half float pixels for png and compares it with skcms
+// converting the same pixels.
+static bool matches_skcms(const std::vector<uint16_t> &src) {
+    const int width = (int)(src.size() / 4);
+    auto info = SkImageInfo::Make(width, 1, kRGBA_F16_SkColorType, kPremul_SkAlphaType);
+    auto transform = SkChooseRowTransform(info, SkRowDst::kPng);
+    if(transform == nullptr || transform->fDstBytesPerPixel != 8)
+        return false;
+
+    std::vector<unsigned char> expected(width * 8), actual(width * 8);
+    skcms_Transform(src.data(), skcms_PixelFormat_RGBA_hhhh,
+                    skcms_AlphaFormat_PremulAsEncoded, nullptr,
+                    expected.data(), skcms_PixelFormat_RGBA_16161616BE,
+                    skcms_AlphaFormat_Unpremul, nullptr, width);
+    (*transform)(reinterpret_cast<char *>(actual.data()), width * 8,
+                 reinterpret_cast<const char *>(src.data()), width * 8, width, 1);
+
+    return expected == actual;
+}
+
+int main() {
+    // zeros, ones, a half, negatives, the smallest denormal, infinities and NaNs
+    const uint16_t specials[] = {
+        0x0000, 0x8000, 0x3c00, 0xbc00, 0x3800, 0xb800, 0x0001, 0x8001,
+        0x03ff, 0x0400, 0x7bff, 0x7c00, 0xfc00, 0x7e00, 0xfe00, 0x7c01,
+    };
+
+    // every half in every color channel, against each special alpha
+    for(uint16_t alpha : specials) {
+        std::vector<uint16_t> pixels(65536 * 4);
+        for(int h = 0; h < 65536; h++) {
+            pixels[4 * h + 0] = h;
+            pixels[4 * h + 1] = h ^ 0x8000;
+            pixels[4 * h + 2] = h ^ 0x5a5a;
+            pixels[4 * h + 3] = alpha;
+        }
+        if(!matches_skcms(pixels))
+            return 1;
+    }
+
+    // every half as alpha, under each special color
+    for(uint16_t color : specials) {
+        std::vector<uint16_t> pixels(65536 * 4);
+        for(int h = 0; h < 65536; h++) {
+            pixels[4 * h + 0] = color;
+            pixels[4 * h + 1] = 0x3400;
+            pixels[4 * h + 2] = color ^ 0x8000;
+            pixels[4 * h + 3] = h;
+        }
+        if(!matches_skcms(pixels))
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static bool push_in_bands(const std::vector<char> &buffer, const TransformResult &expected,
+                          const TransformOptions *options) {
+    const int width = 800, height = 400, band = 48;
+    const size_t row_bytes = width * 4;
+
+    auto handle = png_encoder_begin(width, height, options);
+    if(handle == nullptr)
+        return false;
+
+    for(int y = 0; y < height; y += band) {
+        int count = y + band > height ? height - y : band;
+        if(png_encoder_push_rows(handle, buffer.data() + y * row_bytes, count, row_bytes) != kTransformOk) {
+            png_encoder_finish(handle);
+            return false;
+        }
+    }
+
+    auto result = png_encoder_finish(handle);
+    bool same = result.status == kTransformOk && result.size == expected.size &&
+                memcmp(result.encoded, expected.encoded, result.size) == 0;
+
+    memfree(result.handle);
+    return same;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+
+    // encoded on the pushing thread
+    if(!push_in_bands(buffer, expected, nullptr))
+        return 1;
+
+    // encoded on a worker
+    TransformOptions options = {};
+    options.max_threads = 2;
+    if(!push_in_bands(buffer, expected, &options))
+        return 1;
+
+    // finishing before the last row is reported as such
+    auto handle = png_encoder_begin(800, 400, nullptr);
+    if(png_encoder_push_rows(handle, buffer.data(), 8, 800 * 4) != kTransformOk ||
+       png_encoder_finish(handle).status != kTransformIncomplete)
+        return 1;
+
+    memfree(expected.handle);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+// Decodes |result| to BGRA, reporting whether the png has an alpha channel.
+static bool decode_bgra(const TransformResult &result, std::vector<uint8_t> *pixels,
+                        bool *has_alpha) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    *has_alpha = (image.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+    image.format = PNG_FORMAT_BGRA;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+// Encodes |width| x |height| straight-alpha BGRA pixels, red and blue swapped for
+// RGBA_8888, as unpremultiplied and as opaque input, and checks both outputs copy the
+// color channels through untouched.
+static bool copies_channels(const std::vector<uint8_t> &bgra, int width, int height,
+                            int color_type) {
+    std::vector<uint8_t> input(bgra.begin(), bgra.begin() + 4 * width * height);
+    if(color_type == kTransformColorRGBA8888) {
+        for(size_t i = 0; i < input.size(); i += 4)
+            std::swap(input[i], input[i + 2]);
+    }
+
+    for(int alpha_type : { kTransformAlphaUnpremul, kTransformAlphaOpaque }) {
+        TransformOptions options = {};
+        options.color_type = color_type;
+        options.alpha_type = alpha_type;
+
+        // opaque input keeps its colors and gets alpha 255
+        bool opaque = alpha_type == kTransformAlphaOpaque;
+        std::vector<uint8_t> expected(bgra.begin(), bgra.begin() + 4 * width * height);
+        for(size_t i = 3; opaque && i < expected.size(); i += 4)
+            expected[i] = 255;
+
+        auto png = transform_to_png_ex(width, height, input.size(), input.data(), &options);
+        std::vector<uint8_t> decoded;
+        bool has_alpha = false;
+        bool same = decode_bgra(png, &decoded, &has_alpha) && decoded == expected &&
+                    has_alpha != opaque;
+
+        auto out = transform_to_bgra8888_ex(width, height, input.size(), input.data(), &options);
+        same = same && out.status == kTransformOk && out.size == expected.size() &&
+               memcmp(out.encoded, expected.data(), expected.size()) == 0;
+
+        memfree(png.handle);
+        memfree(out.handle);
+        if(!same)
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<uint8_t> sample(size);
+    if(!file.read(reinterpret_cast<char *>(sample.data()), sample.size()))
+        return 1;
+
+    // the sample is premultiplied; read as straight alpha it is just bytes, so give it
+    // some colors brighter than their alpha too
+    for(size_t i = 0; i < sample.size(); i += 4 * 7)
+        sample[i + 3] = (uint8_t)(sample[i + 3] >> 1);
+
+    // whole SIMD blocks, and every tail length after them
+    const struct {
+        int width;
+        int height;
+    } sizes[] = { {800, 400}, {199, 80}, {1, 3}, {5, 3}, {6, 3}, {7, 3}, {9, 3}, {15, 3} };
+    for(const auto &s : sizes) {
+        for(int color_type : { kTransformColorBGRA8888, kTransformColorRGBA8888 }) {
+            if(!copies_channels(sample, s.width, s.height, color_type))
+                return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+// The png in |result| with its |type| chunk cut out, and that chunk, header and
+// crc included, in |chunk|.
+static std::string without_chunk(const TransformResult &result, const char *type,
+                                 std::string *chunk) {
+    std::string png(reinterpret_cast<const char *>(result.encoded), result.size);
+    chunk->clear();
+    for(size_t at = 8; at + 12 <= png.size();) {
+        auto bytes = reinterpret_cast<const uint8_t *>(png.data() + at);
+        size_t length = (size_t)bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+        if(png.compare(at + 4, 4, type) == 0) {
+            *chunk = png.substr(at, length + 12);
+            return png.erase(at, length + 12);
+        }
+        at += length + 12;
+    }
+    return png;
+}
+
+static bool has_chunk(const TransformResult &result, const char *type) {
+    std::string chunk;
+    without_chunk(result, type, &chunk);
+    return !chunk.empty();
+}
+
+// Reads the ICC profile libpng finds in |result|, checking it is well formed.
+static bool read_profile(const TransformResult &result, std::string *profile) {
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png_create_info_struct(png);
+    if(setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    struct Reader {
+        const uint8_t *data;
+        size_t left;
+    } reader = { reinterpret_cast<const uint8_t *>(result.encoded), result.size };
+    png_set_read_fn(png, &reader, [](png_structp png, png_bytep out, png_size_t size) {
+        auto reader = reinterpret_cast<Reader *>(png_get_io_ptr(png));
+        if(size > reader->left)
+            png_error(png, "truncated");
+        memcpy(out, reader->data, size);
+        reader->data += size;
+        reader->left -= size;
+    });
+    png_read_info(png, info);
+
+    png_charp name = nullptr;
+    int compression = 0;
+    png_bytep data = nullptr;
+    png_uint_32 size = 0;
+    bool ok = png_get_iCCP(png, info, &name, &compression, &data, &size) != 0 && size >= 132;
+    if(ok) {
+        profile->assign(reinterpret_cast<const char *>(data), size);
+        uint32_t declared = (uint32_t)(uint8_t)(*profile)[0] << 24 |
+                            (uint32_t)(uint8_t)(*profile)[1] << 16 |
+                            (uint32_t)(uint8_t)(*profile)[2] << 8 | (uint8_t)(*profile)[3];
+        ok = declared == size && profile->compare(36, 4, "acsp") == 0;
+    }
+    png_destroy_read_struct(&png, &info, nullptr);
+    return ok;
+}
+
+static bool decode_bgra(const TransformResult &result, std::vector<uint8_t> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    image.format = PNG_FORMAT_BGRA;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // sRGB stays untagged
+    auto untagged = transform_to_png(800, 400, sample.size(), sample.data());
+    if(untagged.status != kTransformOk || has_chunk(untagged, "iCCP") ||
+       has_chunk(untagged, "sRGB"))
+        return 1;
+    std::string untagged_bytes(reinterpret_cast<const char *>(untagged.encoded), untagged.size);
+
+    std::string profiles[2];
+    int index = 0;
+    for(int color_space : { kTransformColorSpaceDisplayP3, kTransformColorSpaceAdobeRGB }) {
+        TransformOptions options = {};
+        options.color_space = color_space;
+
+        // embedding tags the png and leaves the pixels alone: without its iCCP chunk
+        // the png is the untagged one
+        auto tagged = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+        std::string iccp;
+        if(tagged.status != kTransformOk ||
+           without_chunk(tagged, "iCCP", &iccp) != untagged_bytes ||
+           !read_profile(tagged, &profiles[index++]))
+            return 1;
+
+        // every encode, on any thread, writes the one cached chunk
+        std::vector<std::string> chunks(4);
+        std::vector<std::thread> threads;
+        for(auto &chunk : chunks) {
+            threads.emplace_back([&sample, &options, &chunk] {
+                auto again = transform_to_png_ex(800, 400, sample.size(), sample.data(),
+                                                 &options);
+                if(again.status == kTransformOk)
+                    without_chunk(again, "iCCP", &chunk);
+                memfree(again.handle);
+            });
+        }
+        for(auto &thread : threads)
+            thread.join();
+        for(const auto &chunk : chunks) {
+            if(chunk != iccp)
+                return 1;
+        }
+
+        // converting tags the png as sRGB, and converts as BGRA output does
+        options.convert_to_srgb = 1;
+        auto converted = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+        auto bgra = transform_to_bgra8888_ex(800, 400, sample.size(), sample.data(), &options);
+        std::vector<uint8_t> decoded;
+        if(!decode_bgra(converted, &decoded) || has_chunk(converted, "iCCP") ||
+           !has_chunk(converted, "sRGB") || bgra.status != kTransformOk ||
+           bgra.size != decoded.size() || memcmp(bgra.encoded, decoded.data(), bgra.size) != 0)
+            return 1;
+
+        memfree(tagged.handle);
+        memfree(converted.handle);
+        memfree(bgra.handle);
+    }
+
+    if(profiles[0] == profiles[1])
+        return 1;
+
+    memfree(untagged.handle);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+static bool same_bytes(const TransformResult &a, const void *bytes, size_t size) {
+    return a.status == kTransformOk && a.size == size && memcmp(a.encoded, bytes, size) == 0;
+}
+
+static bool decode_bgra(const TransformResult &result, std::vector<uint8_t> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    image.format = PNG_FORMAT_BGRA;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> bgra(size);
+    if(!file.read(bgra.data(), bgra.size()))
+        return 1;
+
+    const int width = 800, height = 400;
+    auto png = transform_to_png(width, height, bgra.size(), bgra.data());
+    auto bgra_out = transform_to_bgra8888(width, height, bgra.size(), bgra.data());
+
+    // RGBA_8888 is the same frame with red and blue swapped
+    std::vector<char> rgba(bgra);
+    for(size_t i = 0; i < rgba.size(); i += 4)
+        std::swap(rgba[i], rgba[i + 2]);
+
+    TransformOptions options = {};
+    options.color_type = kTransformColorRGBA8888;
+    auto rgba_png = transform_to_png_ex(width, height, rgba.size(), rgba.data(), &options);
+    auto rgba_bgra = transform_to_bgra8888_ex(width, height, rgba.size(), rgba.data(), &options);
+    if(!same_bytes(rgba_png, png.encoded, png.size) ||
+       !same_bytes(rgba_bgra, bgra_out.encoded, bgra_out.size))
+        return 1;
+
+    // RGB_565 widens each channel to the nearest 8-bit value, and is opaque
+    std::vector<uint16_t> rgb565(width * height);
+    std::vector<uint8_t> expected(4 * width * height);
+    for(size_t i = 0; i < rgb565.size(); i++) {
+        const uint8_t *pixel = (const uint8_t *)bgra.data() + 4 * i;
+        unsigned r = pixel[2] >> 3, g = pixel[1] >> 2, b = pixel[0] >> 3;
+        rgb565[i] = (uint16_t)(r << 11 | g << 5 | b);
+        expected[4 * i + 0] = (uint8_t)((b * 255 + 15) / 31);
+        expected[4 * i + 1] = (uint8_t)((g * 255 + 31) / 63);
+        expected[4 * i + 2] = (uint8_t)((r * 255 + 15) / 31);
+        expected[4 * i + 3] = 255;
+    }
+
+    options = {};
+    options.color_type = kTransformColorRGB565;
+    auto serial = transform_to_bgra8888_ex(width, height, 2 * rgb565.size(), rgb565.data(),
+                                           &options);
+    if(!same_bytes(serial, expected.data(), expected.size()))
+        return 1;
+
+    // bands are sized for 4-byte output from 2-byte input
+    options.max_threads = 4;
+    auto parallel = transform_to_bgra8888_ex(width, height, 2 * rgb565.size(), rgb565.data(),
+                                             &options);
+    if(!same_bytes(parallel, expected.data(), expected.size()))
+        return 1;
+
+    // and the png holds the widened pixels; its sBIT chunk still says 565
+    options = {};
+    options.color_type = kTransformColorRGB565;
+    auto rgb565_png = transform_to_png_ex(width, height, 2 * rgb565.size(), rgb565.data(),
+                                          &options);
+    std::vector<uint8_t> decoded;
+    if(!decode_bgra(rgb565_png, &decoded) || decoded != expected)
+        return 1;
+
+    for(auto *result : { &png, &bgra_out, &rgba_png, &rgba_bgra, &serial, &parallel,
+                         &rgb565_png })
+        memfree(result->handle);
+    return 0;
+}
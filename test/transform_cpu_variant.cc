@@ -0,0 +1,154 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+struct Report {
+    char variant[16];
+    uint64_t hash;
+};
+
+static uint64_t fnv1a(uint64_t hash, const TransformResult &result) {
+    if(result.status != kTransformOk)
+        return 0;
+
+    auto bytes = reinterpret_cast<const uint8_t *>(result.encoded);
+    for(size_t i = 0; i < result.size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+// Encodes the sample through every kernel family the override switches: unpremultiply,
+// swizzle, strip alpha and F16, to png and to BGRA_8888, and the Up filter, adler32 and
+// match search of the fast png engine.
+static uint64_t encode_all(std::vector<char> sample) {
+    uint64_t hash = 14695981039346656037ull;
+    for(int alpha_type : { kTransformAlphaPremul, kTransformAlphaUnpremul,
+                           kTransformAlphaOpaque }) {
+        for(int color_type : { kTransformColorBGRA8888, kTransformColorRGBA8888 }) {
+            TransformOptions options = {};
+            options.color_type = color_type;
+            options.alpha_type = alpha_type;
+            auto png = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+            auto bgra = transform_to_bgra8888_ex(800, 400, sample.size(), sample.data(),
+                                                 &options);
+            hash = fnv1a(fnv1a(hash, png), bgra);
+            memfree(png.handle);
+            memfree(bgra.handle);
+        }
+    }
+
+    // rows of the fast engine a few bytes past a multiple of every vector width
+    for(int alpha_type : { kTransformAlphaPremul, kTransformAlphaOpaque }) {
+        TransformOptions options = {};
+        options.alpha_type = alpha_type;
+        options.png_engine = kTransformPngEngineFast;
+        options.crop_width = 797;
+        options.crop_height = 400;
+        auto png = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+        hash = fnv1a(hash, png);
+        memfree(png.handle);
+    }
+
+    // the sample read as half the number of F16 pixels, finite halves only
+    for(size_t i = 1; i < sample.size(); i += 2)
+        sample[i] &= 0x3b;
+
+    TransformOptions options = {};
+    options.color_type = kTransformColorRGBAF16;
+    auto png = transform_to_png_ex(400, 400, sample.size(), sample.data(), &options);
+    auto bgra = transform_to_bgra8888_ex(400, 400, sample.size(), sample.data(), &options);
+    hash = fnv1a(fnv1a(hash, png), bgra);
+    memfree(png.handle);
+    memfree(bgra.handle);
+    return hash;
+}
+
+// Runs encode_all in a child with SKBITMAP_TO_PNG_CPU set to |cap|, or unset for null, since
+// the variant is fixed by the first encode of a process.
+static bool run_capped(const char *cap, const std::vector<char> &sample, Report *report) {
+    int fds[2];
+    if(pipe(fds) != 0)
+        return false;
+
+    pid_t pid = fork();
+    if(pid < 0)
+        return false;
+
+    if(pid == 0) {
+        close(fds[0]);
+        if(cap)
+            setenv("SKBITMAP_TO_PNG_CPU", cap, 1);
+        else
+            unsetenv("SKBITMAP_TO_PNG_CPU");
+
+        Report child = {};
+        strncpy(child.variant, transform_cpu_variant(), sizeof(child.variant) - 1);
+        child.hash = encode_all(sample);
+        bool written = write(fds[1], &child, sizeof(child)) == sizeof(child);
+        _exit(written ? 0 : 1);
+    }
+
+    close(fds[1]);
+    bool read_all = read(fds[0], report, sizeof(*report)) == sizeof(*report);
+    close(fds[0]);
+
+    int status = 0;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+           read_all;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    Report host;
+    if(!run_capped(nullptr, sample, &host))
+        return 1;
+
+    // unknown names leave the host's variant alone
+    Report unknown;
+    if(!run_capped("avx512", sample, &unknown) || strcmp(unknown.variant, host.variant) != 0 ||
+       unknown.hash != host.hash)
+        return 1;
+
+    // each cap runs that variant or one it includes, and every variant encodes the same bytes
+    const struct {
+        const char *cap;
+        const char *allowed;
+    } caps[] = {
+        {"avx2", " avx2 ssse3 sse2 scalar "},
+        {"ssse3", " ssse3 sse2 scalar "},
+        {"sse2", " sse2 scalar "},
+        {"neon", " neon scalar "},
+        {"scalar", " scalar "},
+    };
+    for(const auto &cap : caps) {
+        Report report;
+        if(!run_capped(cap.cap, sample, &report) || report.hash != host.hash)
+            return 1;
+
+        std::string variant = std::string(" ") + report.variant + " ";
+        if(strstr(cap.allowed, variant.c_str()) == nullptr)
+            return 1;
+
+        // capping at the host's own variant changes nothing
+        if(strcmp(cap.cap, host.variant) == 0 && strcmp(report.variant, host.variant) != 0)
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <skbitmap_to_png.h>
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+
+    int fds[2];
+    if(pipe(fds) != 0)
+        return 1;
+
+    // a renderer writing the frame in small pieces
+    std::thread writer([&] {
+        for(size_t offset = 0; offset < buffer.size(); offset += 1000) {
+            size_t n = std::min<size_t>(1000, buffer.size() - offset);
+            if(write(fds[1], buffer.data() + offset, n) != (ssize_t)n)
+                break;
+        }
+        close(fds[1]);
+    });
+
+    auto result = transform_fd_to_png(fds[0], 800, 400, nullptr);
+    writer.join();
+    close(fds[0]);
+
+    bool same = result.status == kTransformOk && result.size == expected.size &&
+                memcmp(result.encoded, expected.encoded, result.size) == 0;
+
+    memfree(result.handle);
+    memfree(expected.handle);
+    return same ? 0 : 1;
+}
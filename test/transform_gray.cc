@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+// Decodes |result| to one byte of gray per pixel, checking the png has no alpha.
+static bool decode_gray(const TransformResult &result, std::vector<uint8_t> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    bool gray = image.format == PNG_FORMAT_GRAY;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return gray && ok;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // the green channel of the sample as one byte per pixel
+    const int width = 800, height = 400;
+    std::vector<uint8_t> plane(width * height);
+    for(size_t i = 0; i < plane.size(); i++)
+        plane[i] = (uint8_t)sample[4 * i + 1];
+
+    for(int color_type : { kTransformColorGray8, kTransformColorAlpha8 }) {
+        TransformOptions options = {};
+        options.color_type = color_type;
+
+        // gray level or coverage becomes the gray level of the png
+        auto png = transform_to_png_ex(width, height, plane.size(), plane.data(), &options);
+        std::vector<uint8_t> decoded;
+        if(!decode_gray(png, &decoded) || decoded != plane)
+            return 1;
+
+        // pushed bands encode to the same png
+        auto handle = png_encoder_begin(width, height, &options);
+        for(int y = 0; y < height; y += 64) {
+            int count = y + 64 > height ? height - y : 64;
+            if(png_encoder_push_rows(handle, plane.data() + y * width, count, width) != kTransformOk)
+                return 1;
+        }
+        auto pushed = png_encoder_finish(handle);
+        if(pushed.size != png.size || memcmp(pushed.encoded, png.encoded, png.size) != 0)
+            return 1;
+
+        // gray is copied to every color channel of opaque pixels, and
+        // coverage is the alpha of black ones
+        std::vector<uint8_t> expected(4 * plane.size());
+        for(size_t i = 0; i < plane.size(); i++) {
+            bool gray = color_type == kTransformColorGray8;
+            uint8_t level = gray ? plane[i] : 0;
+            expected[4 * i + 0] = level;
+            expected[4 * i + 1] = level;
+            expected[4 * i + 2] = level;
+            expected[4 * i + 3] = gray ? 255 : plane[i];
+        }
+
+        auto bgra = transform_to_bgra8888_ex(width, height, plane.size(), plane.data(), &options);
+        if(bgra.status != kTransformOk || bgra.size != expected.size() ||
+           memcmp(bgra.encoded, expected.data(), expected.size()) != 0)
+            return 1;
+
+        options.max_threads = 3;
+        auto parallel = transform_to_bgra8888_ex(width, height, plane.size(), plane.data(),
+                                                 &options);
+        if(parallel.status != kTransformOk || parallel.size != expected.size() ||
+           memcmp(parallel.encoded, expected.data(), expected.size()) != 0)
+            return 1;
+
+        memfree(png.handle);
+        memfree(pushed.handle);
+        memfree(bgra.handle);
+        memfree(parallel.handle);
+    }
+
+    return 0;
+}
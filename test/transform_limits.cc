@@ -0,0 +1,135 @@
+#include <poll.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static std::atomic<bool> entered(false);
+static std::atomic<bool> released(false);
+
+// Holds the encode writing through it in the scheduler until released.
+static int block(const void *, size_t, void *) {
+    entered = true;
+    while(!released)
+        poll(nullptr, 0, 1);
+
+    return 1;
+}
+
+static std::atomic<int> completed(0);
+static std::atomic<int> completed_status(-1);
+
+static void on_complete(TransformResult result, void *) {
+    completed_status = result.status;
+    completed++;
+    memfree(result.handle);
+}
+
+// Waits until |done| holds, for up to ten seconds.
+template <typename Predicate>
+static bool wait_for(Predicate done) {
+    for(int waited = 0; waited < 10000; waited++) {
+        if(done())
+            return true;
+        poll(nullptr, 0, 1);
+    }
+
+    return false;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+
+    // a passed deadline fails the transform
+    TransformOptions options = {};
+    options.deadline_ns = transform_now_ns() - 1;
+    if(transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options).status !=
+       kTransformDeadlineExceeded)
+        return 1;
+
+    // a cancelled token fails it
+    options = {};
+    options.cancel = transform_cancel_token_create();
+    transform_cancel(options.cancel);
+    if(transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options).status !=
+       kTransformCancelled)
+        return 1;
+    transform_cancel_token_destroy(options.cancel);
+
+    // output one byte over the cap fails it, output that fits does not
+    options = {};
+    options.max_output_bytes = expected.size - 1;
+    if(transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options).status !=
+       kTransformOutputTooLarge)
+        return 1;
+
+    options.max_output_bytes = expected.size;
+    auto capped = transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options);
+    if(capped.status != kTransformOk || capped.size != expected.size ||
+       memcmp(capped.encoded, expected.encoded, expected.size) != 0)
+        return 1;
+    memfree(capped.handle);
+
+    // queued async jobs whose deadline passes complete without running
+    set_encode_limits(1, 0);
+    std::thread blocker([&] {
+        transform_to_png_stream(800, 400, buffer.size(), buffer.data(), nullptr, block, nullptr);
+    });
+    if(!wait_for([] { return entered.load(); }))
+        return 1;
+
+    auto before = get_encode_stats();
+    TransformJob job{};
+    job.width = 800;
+    job.height = 400;
+    job.size = buffer.size();
+    job.buf = buffer.data();
+
+    // already passed on submission: completes while the only slot is taken
+    job.options.deadline_ns = transform_now_ns() - 1;
+    transform_to_png_async(&job, on_complete, nullptr);
+    if(!wait_for([] { return completed == 1; }) || completed_status != kTransformDeadlineExceeded)
+        return 1;
+
+    // passing while queued: completes once the queue moves, instead of running
+    job.options.deadline_ns = transform_now_ns() + 20 * 1000 * 1000;
+    transform_to_png_async(&job, on_complete, nullptr);
+    poll(nullptr, 0, 50);
+
+    released = true;
+    blocker.join();
+    if(!wait_for([] { return completed == 2; }) || completed_status != kTransformDeadlineExceeded)
+        return 1;
+
+    auto after = get_encode_stats();
+    std::cout << "expired: " << after.interactive.expired - before.interactive.expired
+              << ", admitted: " << after.interactive.admitted - before.interactive.admitted
+              << std::endl;
+    if(after.interactive.expired - before.interactive.expired != 2 ||
+       after.interactive.admitted != before.interactive.admitted ||
+       after.interactive.queue_depth != 0)
+        return 1;
+
+    // finishing a stepped transform early is neither a success nor a cancel
+    auto handle = transform_begin_png(800, 400, buffer.size(), buffer.data(), nullptr);
+    transform_step(handle, 0);
+    if(transform_finish(handle).status != kTransformIncomplete)
+        return 1;
+
+    memfree(expected.handle);
+    return 0;
+}
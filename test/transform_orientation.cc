@@ -0,0 +1,107 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static bool same(const TransformResult &a, const TransformResult &b) {
+    return a.status == kTransformOk && b.status == kTransformOk && a.size == b.size &&
+           memcmp(a.encoded, b.encoded, a.size) == 0;
+}
+
+// Copies the |w| x |h| rectangle at (|x|, |y|) of the 800 pixel wide |sample|,
+// reoriented, into a packed frame of |*out_w| x |*out_h| pixels.
+static std::vector<char> reorient(const std::vector<char> &sample, int x, int y, int w, int h,
+                                  int orientation, int *out_w, int *out_h) {
+    bool swap = orientation == kTransformOrientationRotate90 ||
+                orientation == kTransformOrientationRotate270;
+    *out_w = swap ? h : w;
+    *out_h = swap ? w : h;
+
+    std::vector<char> out(4 * w * h);
+    for(int oy = 0; oy < *out_h; oy++) {
+        for(int ox = 0; ox < *out_w; ox++) {
+            int sx = ox, sy = oy;
+            switch(orientation) {
+                case kTransformOrientationFlipVertical:   sy = h - 1 - oy; break;
+                case kTransformOrientationFlipHorizontal: sx = w - 1 - ox; break;
+                case kTransformOrientationRotate90:       sx = oy; sy = h - 1 - ox; break;
+                case kTransformOrientationRotate180:      sx = w - 1 - ox; sy = h - 1 - oy; break;
+                case kTransformOrientationRotate270:      sx = w - 1 - oy; sy = ox; break;
+            }
+            memcpy(out.data() + 4 * (oy * *out_w + ox),
+                   sample.data() + 4 * ((y + sy) * 800 + x + sx), 4);
+        }
+    }
+    return out;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    const struct {
+        int x, y, width, height;
+    } crops[] = { {0, 0, 0, 0}, {13, 7, 301, 173}, {799, 0, 1, 400}, {0, 399, 800, 1} };
+
+    for(const auto &crop : crops) {
+        for(int orientation = kTransformOrientationNone;
+            orientation <= kTransformOrientationRotate270; orientation++) {
+            int w = crop.width ? crop.width : 800, h = crop.height ? crop.height : 400;
+            int out_w, out_h;
+            auto copy = reorient(sample, crop.x, crop.y, w, h, orientation, &out_w, &out_h);
+
+            // the same pixels reoriented by hand encode to the same bytes
+            auto png = transform_to_png(out_w, out_h, copy.size(), copy.data());
+            auto bgra = transform_to_bgra8888(out_w, out_h, copy.size(), copy.data());
+
+            TransformOptions options = {};
+            options.orientation = orientation;
+            options.crop_x = crop.x;
+            options.crop_y = crop.y;
+            options.crop_width = crop.width;
+            options.crop_height = crop.height;
+            auto fused_png = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+            auto fused_bgra = transform_to_bgra8888_ex(800, 400, sample.size(), sample.data(),
+                                                       &options);
+
+            options.max_threads = 3;
+            auto parallel_bgra = transform_to_bgra8888_ex(800, 400, sample.size(), sample.data(),
+                                                          &options);
+
+            bool ok = same(png, fused_png) && same(bgra, fused_bgra) && same(bgra, parallel_bgra);
+            for(auto *result : { &png, &bgra, &fused_png, &fused_bgra, &parallel_bgra })
+                memfree(result->handle);
+            if(!ok)
+                return 1;
+        }
+    }
+
+    // rectangles that are empty in one dimension or reach outside the input
+    const struct {
+        int x, y, width, height;
+    } invalid[] = {
+        {0, 0, 100, 0}, {0, 0, 0, 100}, {5, 5, 0, 1}, {-1, 0, 10, 10}, {0, 0, -10, 10},
+        {791, 0, 10, 10}, {0, 391, 10, 10},
+    };
+    for(const auto &crop : invalid) {
+        TransformOptions options = {};
+        options.crop_x = crop.x;
+        options.crop_y = crop.y;
+        options.crop_width = crop.width;
+        options.crop_height = crop.height;
+        if(transform_to_png_ex(800, 400, sample.size(), sample.data(), &options).status !=
+               kTransformInvalidInput ||
+           transform_to_bgra8888_ex(800, 400, sample.size(), sample.data(), &options).status !=
+               kTransformInvalidInput)
+            return 1;
+    }
+
+    return 0;
+}
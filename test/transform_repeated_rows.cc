@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <png.h>
+#include <zlib.h>
+
+#include <skbitmap_to_png.h>
+
+static bool same(const TransformResult &a, const TransformResult &b) {
+    return a.status == kTransformOk && b.status == kTransformOk && a.size == b.size &&
+           memcmp(a.encoded, b.encoded, a.size) == 0;
+}
+
+// Inflates the IDAT chunks of |result| to the filtered rows, each led by its filter byte.
+static bool filtered_rows(const TransformResult &result, std::vector<uint8_t> *rows) {
+    auto png = reinterpret_cast<const uint8_t *>(result.encoded);
+    std::string idat;
+    for(size_t at = 8; at + 12 <= result.size;) {
+        size_t length = (size_t)png[at] << 24 | png[at + 1] << 16 | png[at + 2] << 8 | png[at + 3];
+        if(memcmp(png + at + 4, "IDAT", 4) == 0)
+            idat.append(reinterpret_cast<const char *>(png + at + 8), length);
+        at += length + 12;
+    }
+
+    uLongf size = rows->size();
+    return uncompress(rows->data(), &size, reinterpret_cast<const Bytef *>(idat.data()),
+                      idat.size()) == Z_OK && size == rows->size();
+}
+
+static bool decode_bgra(const TransformResult &result, std::vector<uint8_t> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    image.format = PNG_FORMAT_BGRA;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // a screenshot-like frame: runs of one repeated sample row and of transparent rows
+    // between rows of the sample
+    const int width = 800, height = 400;
+    const size_t row_bytes = 4 * width;
+    std::vector<char> frame(sample);
+    for(int y = 0; y < height; y++) {
+        int source = y;
+        if(y >= 50 && y < 120)
+            source = 49;
+        else if(y >= 260 && y < 300)
+            source = 259;
+
+        if(y >= 120 && y < 200)
+            memset(frame.data() + y * row_bytes, 0, row_bytes);
+        else
+            memcpy(frame.data() + y * row_bytes, sample.data() + source * row_bytes, row_bytes);
+    }
+
+    auto png = transform_to_png(width, height, frame.size(), frame.data());
+    auto bgra = transform_to_bgra8888(width, height, frame.size(), frame.data());
+
+    // the png holds the frame the BGRA transform sees
+    std::vector<uint8_t> decoded;
+    if(!decode_bgra(png, &decoded) || bgra.status != kTransformOk ||
+       decoded.size() != bgra.size || memcmp(decoded.data(), bgra.encoded, bgra.size) != 0)
+        return 1;
+
+    // a row repeating the one before filters to zeros: with Up, or with None when the
+    // row itself is zeros
+    std::vector<uint8_t> rows(height * (1 + row_bytes));
+    if(!filtered_rows(png, &rows))
+        return 1;
+
+    for(int y = 1; y < height; y++) {
+        const char *src = frame.data() + y * row_bytes;
+        if(memcmp(src - row_bytes, src, row_bytes) != 0)
+            continue;
+
+        const uint8_t *row = rows.data() + y * (1 + row_bytes);
+        bool zeros = src[0] == 0 && memcmp(src, src + 1, row_bytes - 1) == 0;
+        if(row[0] != (zeros ? PNG_FILTER_VALUE_NONE : PNG_FILTER_VALUE_UP) || row[1] != 0 ||
+           memcmp(row + 1, row + 2, row_bytes - 1) != 0)
+            return 1;
+    }
+
+    // the pipelined encoder marks repeats per block and writes the same png
+    TransformOptions options = {};
+    options.max_threads = 2;
+    auto pipelined = transform_to_png_ex(width, height, frame.size(), frame.data(), &options);
+    if(!same(png, pipelined))
+        return 1;
+
+    memfree(png.handle);
+    memfree(bgra.handle);
+    memfree(pipelined.handle);
+    return 0;
+}
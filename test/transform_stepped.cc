@@ -0,0 +1,75 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+typedef void *(*BeginProc)(int width, int height, size_t size, void *buf,
+                           const TransformOptions *options);
+
+// Steps a transform to completion in small slices and checks it reports
+// progress through |rows| output rows and ends with the same bytes as
+// |expected|.
+static bool stepped_matches(BeginProc begin, std::vector<char> &buffer,
+                            const TransformOptions *options, int rows,
+                            const TransformResult &expected) {
+    auto handle = begin(800, 400, buffer.size(), buffer.data(), options);
+    if(handle == nullptr)
+        return false;
+
+    int steps = 0, last_rows = 0;
+    TransformProgress progress;
+    do {
+        progress = transform_step(handle, 100);
+        if(progress.failed || progress.rows_total != rows || progress.rows_encoded < last_rows ||
+           progress.rows_encoded > progress.rows_total)
+            break;
+
+        last_rows = progress.rows_encoded;
+        steps++;
+    } while(!progress.done);
+
+    auto result = transform_finish(handle);
+    bool same = progress.done && !progress.failed && progress.rows_encoded == rows &&
+                result.status == kTransformOk && result.size == expected.size &&
+                memcmp(result.encoded, expected.encoded, expected.size) == 0;
+
+    std::cout << "steps: " << steps << std::endl;
+    memfree(result.handle);
+    return same && steps > 1;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto png = transform_to_png(800, 400, buffer.size(), buffer.data());
+    if(!stepped_matches(transform_begin_png, buffer, nullptr, 400, png))
+        return 1;
+
+    auto bgra = transform_to_bgra8888(800, 400, buffer.size(), buffer.data());
+    if(!stepped_matches(transform_begin_bgra8888, buffer, nullptr, 400, bgra))
+        return 1;
+
+    // options reach the stepped encoders as they reach the whole-frame ones;
+    // rows count output rows, which a rotation turns into input columns
+    TransformOptions options = {};
+    options.orientation = kTransformOrientationRotate270;
+    options.color_space = kTransformColorSpaceDisplayP3;
+    options.png_engine = kTransformPngEngineFast;
+    auto oriented = transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options);
+    if(!stepped_matches(transform_begin_png, buffer, &options, 800, oriented))
+        return 1;
+
+    memfree(png.handle);
+    memfree(bgra.handle);
+    memfree(oriented.handle);
+    return 0;
+}
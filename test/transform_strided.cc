@@ -0,0 +1,120 @@
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static bool same_bytes(const TransformResult &a, const TransformResult &b) {
+    return a.status == kTransformOk && b.status == kTransformOk && a.size == b.size &&
+           memcmp(a.encoded, b.encoded, a.size) == 0;
+}
+
+// Pads the rows of a packed frame to |row_bytes| and checks both transforms
+// read the padded frame as they read the packed one.
+static bool strided_matches(const std::vector<char> &pixels, int width, int height,
+                            int color_type, int bytes_per_pixel, size_t row_bytes) {
+    TransformOptions options = {};
+    options.color_type = color_type;
+    options.alpha_type = kTransformAlphaUnpremul;
+
+    size_t packed_size = compute_bytesize_ex(width, height, &options);
+    if(packed_size != (size_t)bytes_per_pixel * width * height)
+        return false;
+
+    std::vector<char> packed(pixels.begin(), pixels.begin() + packed_size);
+    auto png = transform_to_png_ex(width, height, packed.size(), packed.data(), &options);
+    auto bgra = transform_to_bgra8888_ex(width, height, packed.size(), packed.data(), &options);
+
+    // the last row is left unpadded
+    options.row_bytes = row_bytes;
+    size_t strided_size = compute_bytesize_ex(width, height, &options);
+    if(strided_size != (height - 1) * row_bytes + (size_t)bytes_per_pixel * width)
+        return false;
+
+    std::vector<char> strided(strided_size, 0x5a);
+    for(int y = 0; y < height; y++)
+        memcpy(strided.data() + y * row_bytes, packed.data() + y * bytes_per_pixel * width,
+               bytes_per_pixel * width);
+
+    auto strided_png = transform_to_png_ex(width, height, strided.size(), strided.data(), &options);
+    auto strided_bgra = transform_to_bgra8888_ex(width, height, strided.size(), strided.data(),
+                                                 &options);
+    bool same = same_bytes(png, strided_png) && same_bytes(bgra, strided_bgra);
+
+    // one byte short of the last row
+    auto short_png = transform_to_png_ex(width, height, strided.size() - 1, strided.data(),
+                                         &options);
+    same = same && short_png.status == kTransformInvalidInput;
+
+    memfree(png.handle);
+    memfree(bgra.handle);
+    memfree(strided_png.handle);
+    memfree(strided_bgra.handle);
+    return same;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // the 4-byte helpers, and the shorthand taking a stride
+    if(compute_min_bytesize(800, 400) != sample.size() ||
+       compute_bytesize(800, 400, 4000) != 399 * 4000 + 800 * 4)
+        return 1;
+
+    std::vector<char> padded(compute_bytesize(800, 400, 4000));
+    for(int y = 0; y < 400; y++)
+        memcpy(padded.data() + y * 4000, sample.data() + y * 3200, 3200);
+
+    auto expected = transform_to_png(800, 400, sample.size(), sample.data());
+    auto strided = transform_to_png_strided(800, 400, 4000, padded.size(), padded.data());
+    if(!same_bytes(expected, strided))
+        return 1;
+    memfree(expected.handle);
+    memfree(strided.handle);
+
+    // every color type, at an odd width, padded by a few pixels
+    const struct {
+        int color_type;
+        int bytes_per_pixel;
+    } formats[] = {
+        {kTransformColorBGRA8888, 4}, {kTransformColorRGBA8888, 4}, {kTransformColorRGB565, 2},
+        {kTransformColorAlpha8, 1}, {kTransformColorGray8, 1}, {kTransformColorRGBAF16, 8},
+    };
+    for(const auto &format : formats) {
+        const int width = 199, height = 80;
+        std::vector<char> pixels = sample;
+        if(format.color_type == kTransformColorRGBAF16) {
+            // finite halves only, so both transforms see the same values
+            for(size_t i = 1; i < pixels.size(); i += 2)
+                pixels[i] &= 0x3b;
+        }
+        if(!strided_matches(pixels, width, height, format.color_type, format.bytes_per_pixel,
+                            (width + 3) * format.bytes_per_pixel))
+            return 1;
+    }
+
+    // sizes that cannot be met
+    TransformOptions options = {};
+    options.color_type = kTransformColorRGBAF16;
+    if(compute_bytesize_ex(INT_MAX, INT_MAX, &options) != SIZE_MAX)
+        return 1;
+
+    options.row_bytes = 8 * 10 + 4;
+    if(compute_bytesize_ex(10, 10, &options) != SIZE_MAX)
+        return 1;
+
+    options = {};
+    options.color_type = 99;
+    if(compute_bytesize_ex(10, 10, &options) != SIZE_MAX)
+        return 1;
+
+    return 0;
+}
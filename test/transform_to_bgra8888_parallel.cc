@@ -0,0 +1,56 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+// Transforms with |threads| and checks the bytes match the serial transform.
+static bool same_as_serial(int width, int height, std::vector<char> &buffer, int threads,
+                           int color_type) {
+    size_t size = (size_t)width * height * 4;
+    TransformOptions options = {};
+    options.color_type = color_type;
+    auto serial = transform_to_bgra8888_ex(width, height, size, buffer.data(), &options);
+
+    options.max_threads = threads;
+    auto parallel = transform_to_bgra8888_ex(width, height, size, buffer.data(), &options);
+
+    bool same = serial.status == kTransformOk && parallel.status == kTransformOk &&
+                parallel.size == serial.size &&
+                memcmp(parallel.encoded, serial.encoded, serial.size) == 0;
+
+    memfree(serial.handle);
+    memfree(parallel.handle);
+    return same;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    // bands of every size, including a last band shorter than the others
+    for(int threads : { 2, 3, 7, -1 }) {
+        if(!same_as_serial(800, 400, buffer, threads, kTransformColorBGRA8888))
+            return 1;
+        if(!same_as_serial(800, 397, buffer, threads, kTransformColorRGBA8888))
+            return 1;
+    }
+
+    // fewer free slots than threads asked for, down to none beyond the
+    // encode's own
+    for(int limit : { 3, 1 }) {
+        set_encode_limits(limit, 0);
+        if(!same_as_serial(800, 400, buffer, 8, kTransformColorBGRA8888))
+            return 1;
+    }
+    set_encode_limits(0, 0);
+
+    auto stats = get_encode_stats();
+    return stats.running == 0 && stats.inflight_bytes == 0 ? 0 : 1;
+}
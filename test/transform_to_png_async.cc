@@ -0,0 +1,71 @@
+#include <poll.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static std::atomic<int> callbacks(0);
+
+static void on_complete(TransformResult result, void *user_data) {
+    auto expected = reinterpret_cast<TransformResult *>(user_data);
+    if(result.size == expected->size && memcmp(result.encoded, expected->encoded, result.size) == 0)
+        callbacks++;
+
+    memfree(result.handle);
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+    TransformJob job{};
+    job.width = 800;
+    job.height = 400;
+    job.size = buffer.size();
+    job.buf = buffer.data();
+
+    // callback delivery
+    for(int i = 0; i < 4; i++)
+        transform_to_png_async(&job, on_complete, &expected);
+
+    // completion queue delivery
+    for(int i = 0; i < 4; i++)
+        transform_to_png_async(&job, nullptr, &expected);
+
+    int queued = 0;
+    struct pollfd pfd = { transform_completion_fd(), POLLIN, 0 };
+    while(queued < 4 && poll(&pfd, 1, 10000) > 0) {
+        TransformCompletion completions[4];
+        size_t count = transform_drain_completions(completions, 4);
+
+        for(size_t i = 0; i < count; i++) {
+            auto &result = completions[i].result;
+            if(completions[i].user_data != &expected || completions[i].buf != buffer.data())
+                return 1;
+            if(result.size != expected.size || memcmp(result.encoded, expected.encoded, result.size) != 0)
+                return 1;
+
+            memfree(result.handle);
+            queued++;
+        }
+    }
+
+    for(int waited = 0; callbacks < 4 && waited < 10000; waited++)
+        poll(nullptr, 0, 1);
+
+    memfree(expected.handle);
+
+    std::cout << "callbacks: " << callbacks << ", queued: " << queued << std::endl;
+    return callbacks == 4 && queued == 4 ? 0 : 1;
+}
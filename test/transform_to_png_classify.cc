@@ -0,0 +1,66 @@
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static int classify(int width, int height, std::vector<char> &buffer, int color_type) {
+    TransformOptions options = {};
+    options.color_type = color_type;
+    options.classify_content = 1;
+    auto result = transform_to_png_ex(width, height, buffer.size(), buffer.data(), &options);
+    if(result.status != kTransformOk)
+        return -1;
+
+    memfree(result.handle);
+    return result.content_class;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // off unless asked for
+    auto plain = transform_to_png_ex(800, 400, sample.size(), sample.data(), nullptr);
+    if(plain.status != kTransformOk || plain.content_class != kTransformContentUnclassified)
+        return 1;
+    memfree(plain.handle);
+
+    if(classify(800, 400, sample, kTransformColorBGRA8888) != kTransformContentFlat)
+        return 1;
+
+    const int width = 256, height = 256;
+    std::vector<char> pixels(compute_min_bytesize(width, height));
+
+    // a gradient with a little noise
+    unsigned seed = 1;
+    for(size_t i = 0; i < pixels.size(); i += 4) {
+        int x = (i / 4) % width, y = (i / 4) / width;
+        seed = seed * 1103515245 + 12345;
+        pixels[i] = x + (seed >> 16) % 3;
+        pixels[i + 1] = y + (seed >> 20) % 3;
+        pixels[i + 2] = (x + y) / 2 + (seed >> 24) % 3;
+        pixels[i + 3] = (char)255;
+    }
+    if(classify(width, height, pixels, kTransformColorRGBA8888) != kTransformContentContinuousTone)
+        return 1;
+
+    for(size_t i = 0; i < pixels.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        pixels[i] = seed >> 16;
+    }
+    if(classify(width, height, pixels, kTransformColorRGBA8888) != kTransformContentNoise)
+        return 1;
+
+    // half floats are not measured
+    std::vector<char> half(8 * width * height);
+    if(classify(width, height, half, kTransformColorRGBAF16) != kTransformContentUnclassified)
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+// Decodes |result| to 16-bit RGBA, which holds every format the encoder writes.
+static bool decode(const TransformResult &result, std::vector<png_uint_16> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    image.format = PNG_FORMAT_LINEAR_RGB_ALPHA;
+    pixels->resize(PNG_IMAGE_SIZE(image) / sizeof(png_uint_16));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+// Encodes with both engines and checks the pngs hold the same pixels.
+static bool same_pixels(int width, int height, std::vector<char> &buffer,
+                        TransformOptions options) {
+    options.png_engine = kTransformPngEngineLibpng;
+    auto expected = transform_to_png_ex(width, height, buffer.size(), buffer.data(), &options);
+    options.png_engine = kTransformPngEngineFast;
+    auto fast = transform_to_png_ex(width, height, buffer.size(), buffer.data(), &options);
+
+    std::vector<png_uint_16> a, b;
+    bool same = decode(expected, &a) && decode(fast, &b) && a == b &&
+                fast.offset_x == expected.offset_x && fast.offset_y == expected.offset_y;
+
+    memfree(expected.handle);
+    memfree(fast.handle);
+    return same;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    TransformOptions options = {};
+    if(!same_pixels(800, 400, sample, options))
+        return 1;
+
+    options.orientation = kTransformOrientationRotate90;
+    options.color_space = kTransformColorSpaceDisplayP3;
+    if(!same_pixels(800, 400, sample, options))
+        return 1;
+
+    options = {};
+    options.trim_transparent = 1;
+    options.trim_offset_chunk = 1;
+    if(!same_pixels(800, 400, sample, options))
+        return 1;
+
+    // noise spanning several deflate blocks, with repeats far enough back to
+    // match across them
+    const int width = 512, height = 512;
+    std::vector<char> pixels(8 * width * height);
+    unsigned seed = 1;
+    for(size_t i = 0; i < pixels.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        pixels[i] = (i / 4096) % 3 == 2 ? pixels[i - 8192] : (char)(seed >> 16);
+    }
+
+    const struct {
+        int color_type;
+        int bytes_per_pixel;
+    } formats[] = {
+        {kTransformColorRGBA8888, 4}, {kTransformColorRGB565, 2}, {kTransformColorAlpha8, 1},
+        {kTransformColorGray8, 1}, {kTransformColorRGBAF16, 8},
+    };
+    for(const auto &format : formats) {
+        options = {};
+        options.color_type = format.color_type;
+        options.alpha_type = kTransformAlphaUnpremul;
+        std::vector<char> input(pixels.begin(),
+                                pixels.begin() + format.bytes_per_pixel * width * height);
+        if(!same_pixels(width, height, input, options))
+            return 1;
+    }
+
+    // rows pushed in bands
+    options = {};
+    options.png_engine = kTransformPngEngineFast;
+    auto whole = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+    auto handle = png_encoder_begin(800, 400, &options);
+    for(int y = 0; y < 400; y += 48) {
+        int count = y + 48 > 400 ? 400 - y : 48;
+        if(png_encoder_push_rows(handle, sample.data() + y * 800 * 4, count, 800 * 4) != kTransformOk)
+            return 1;
+    }
+    auto pushed = png_encoder_finish(handle);
+    if(pushed.status != kTransformOk || pushed.size != whole.size ||
+       memcmp(pushed.encoded, whole.encoded, whole.size) != 0)
+        return 1;
+
+    // the output limit stops the deflate stream
+    options.max_output_bytes = whole.size / 2;
+    auto limited = transform_to_png_ex(800, 400, sample.size(), sample.data(), &options);
+    if(limited.status != kTransformOutputTooLarge)
+        return 1;
+
+    memfree(whole.handle);
+    memfree(pushed.handle);
+    return 0;
+}
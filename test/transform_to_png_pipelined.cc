@@ -0,0 +1,97 @@
+#include <poll.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static std::atomic<int> matched(0);
+static std::atomic<int> completed(0);
+
+static void on_complete(TransformResult result, void *user_data) {
+    auto expected = reinterpret_cast<TransformResult *>(user_data);
+    if(result.status == kTransformOk && result.size == expected->size &&
+       memcmp(result.encoded, expected->encoded, result.size) == 0)
+        matched++;
+
+    completed++;
+    memfree(result.handle);
+}
+
+// Encodes with a transform thread and checks the bytes match the serial encode.
+static bool same_as_serial(std::vector<char> &buffer, TransformOptions options) {
+    options.max_threads = 0;
+    auto serial = transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options);
+
+    options.max_threads = 2;
+    auto pipelined = transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options);
+
+    bool same = serial.status == kTransformOk && pipelined.status == kTransformOk &&
+                pipelined.size == serial.size &&
+                memcmp(pipelined.encoded, serial.encoded, serial.size) == 0;
+
+    memfree(serial.handle);
+    memfree(pipelined.handle);
+    return same;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    TransformOptions options = {};
+    if(!same_as_serial(buffer, options))
+        return 1;
+
+    options.orientation = kTransformOrientationRotate90;
+    options.color_space = kTransformColorSpaceDisplayP3;
+    options.convert_to_srgb = 1;
+    if(!same_as_serial(buffer, options))
+        return 1;
+
+    // no slot is free for the transform thread
+    set_encode_limits(1, 0);
+    if(!same_as_serial(buffer, {}))
+        return 1;
+
+    // a cancelled encode stops the transform thread too
+    options = {};
+    options.max_threads = 2;
+    options.cancel = transform_cancel_token_create();
+    transform_cancel(options.cancel);
+    if(transform_to_png_ex(800, 400, buffer.size(), buffer.data(), &options).status !=
+       kTransformCancelled)
+        return 1;
+    transform_cancel_token_destroy(options.cancel);
+
+    // more encodes than pool threads, each wanting a transform thread: every
+    // encode finishes whether or not a pool thread is left to transform for it
+    auto expected = transform_to_png(800, 400, buffer.size(), buffer.data());
+    const int jobs = 4 * std::max(1, (int)std::thread::hardware_concurrency());
+    set_encode_limits(2 * jobs, 0);
+
+    TransformJob job{};
+    job.width = 800;
+    job.height = 400;
+    job.size = buffer.size();
+    job.buf = buffer.data();
+    job.options.max_threads = 2;
+    for(int i = 0; i < jobs; i++)
+        transform_to_png_async(&job, on_complete, &expected);
+
+    for(int waited = 0; completed < jobs && waited < 60000; waited++)
+        poll(nullptr, 0, 1);
+
+    memfree(expected.handle);
+    set_encode_limits(0, 0);
+    return matched == jobs ? 0 : 1;
+}
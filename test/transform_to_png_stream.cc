@@ -0,0 +1,69 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static int append(const void *data, size_t size, void *user_data) {
+    auto out = reinterpret_cast<std::vector<char> *>(user_data);
+    auto bytes = reinterpret_cast<const char *>(data);
+    out->insert(out->end(), bytes, bytes + size);
+    return 1;
+}
+
+static int refuse(const void *, size_t, void *) {
+    return 0;
+}
+
+static bool same(const std::vector<char> &streamed, const TransformResult &expected) {
+    return streamed.size() == expected.size &&
+           memcmp(streamed.data(), expected.encoded, expected.size) == 0;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    if(!file.read(buffer.data(), buffer.size()))
+        return 1;
+
+    const int width = 800, height = 400, band = 48;
+    const size_t row_bytes = width * 4;
+
+    auto expected = transform_to_png(width, height, buffer.size(), buffer.data());
+
+    // whole frame, output streamed
+    std::vector<char> streamed;
+    if(transform_to_png_stream(width, height, buffer.size(), buffer.data(), nullptr,
+                               append, &streamed) != kTransformOk || !same(streamed, expected))
+        return 1;
+
+    // pushed bands, output streamed
+    streamed.clear();
+    auto handle = png_encoder_begin_stream(width, height, nullptr, append, &streamed);
+    if(handle == nullptr)
+        return 1;
+
+    for(int y = 0; y < height; y += band) {
+        int count = y + band > height ? height - y : band;
+        if(png_encoder_push_rows(handle, buffer.data() + y * row_bytes, count, row_bytes) != kTransformOk) {
+            png_encoder_finish(handle);
+            return 1;
+        }
+    }
+
+    auto result = png_encoder_finish(handle);
+    if(result.status != kTransformOk || result.encoded != nullptr || !same(streamed, expected))
+        return 1;
+
+    // a failing write fails the transform
+    if(transform_to_png_stream(width, height, buffer.size(), buffer.data(), nullptr,
+                               refuse, nullptr) != kTransformEncodeFailed)
+        return 1;
+
+    memfree(expected.handle);
+    return 0;
+}
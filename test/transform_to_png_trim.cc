@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <skbitmap_to_png.h>
+
+static bool same(const TransformResult &a, const TransformResult &b) {
+    return a.status == kTransformOk && b.status == kTransformOk && a.size == b.size &&
+           memcmp(a.encoded, b.encoded, a.size) == 0;
+}
+
+static bool has_offset_chunk(const TransformResult &result) {
+    auto bytes = reinterpret_cast<const char *>(result.encoded);
+    for(size_t i = 0; i + 4 <= result.size; i++) {
+        if(memcmp(bytes + i, "oFFs", 4) == 0)
+            return true;
+    }
+    return false;
+}
+
+int main() {
+    std::ifstream file("test/sample", std::ios::binary | std::ios::ate);
+    size_t size = file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> sample(size);
+    if(!file.read(sample.data(), sample.size()))
+        return 1;
+
+    // the sample on a larger transparent canvas
+    const int sample_width = 800, sample_height = 400;
+    const int width = 900, height = 450, left = 37, top = 21;
+    std::vector<char> canvas(compute_min_bytesize(width, height));
+    for(int y = 0; y < sample_height; y++) {
+        memcpy(canvas.data() + ((top + y) * width + left) * 4,
+               sample.data() + y * sample_width * 4, sample_width * 4);
+    }
+
+    // the bounds trimming should find
+    int l = width, t = height, r = 0, b = 0;
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            if(canvas[(y * width + x) * 4 + 3] != 0) {
+                l = std::min(l, x);
+                r = std::max(r, x + 1);
+                t = std::min(t, y);
+                b = std::max(b, y + 1);
+            }
+        }
+    }
+
+    TransformOptions options = {};
+    options.crop_x = l;
+    options.crop_y = t;
+    options.crop_width = r - l;
+    options.crop_height = b - t;
+    auto cropped = transform_to_png_ex(width, height, canvas.size(), canvas.data(), &options);
+
+    options = {};
+    options.trim_transparent = 1;
+    auto trimmed = transform_to_png_ex(width, height, canvas.size(), canvas.data(), &options);
+    if(!same(trimmed, cropped) || trimmed.offset_x != l || trimmed.offset_y != t ||
+       has_offset_chunk(trimmed))
+        return 1;
+
+    // offsets are in the rotated output, and can be written to the png
+    options.orientation = kTransformOrientationRotate90;
+    options.trim_offset_chunk = 1;
+    auto rotated = transform_to_png_ex(width, height, canvas.size(), canvas.data(), &options);
+    if(rotated.status != kTransformOk || rotated.offset_x != height - b ||
+       rotated.offset_y != l || !has_offset_chunk(rotated))
+        return 1;
+
+    // nothing visible
+    std::vector<char> empty(compute_min_bytesize(64, 64));
+    options = {};
+    options.trim_transparent = 1;
+    auto blank = transform_to_png_ex(64, 64, empty.size(), empty.data(), &options);
+    if(blank.status != kTransformOk || blank.offset_x != 0 || blank.offset_y != 0)
+        return 1;
+
+    memfree(cropped.handle);
+    memfree(trimmed.handle);
+    memfree(rotated.handle);
+    memfree(blank.handle);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <png.h>
+
+#include <skbitmap_to_png.h>
+
+static bool same(const TransformResult &a, const TransformResult &b) {
+    return a.status == kTransformOk && b.status == kTransformOk && a.size == b.size &&
+           memcmp(a.encoded, b.encoded, a.size) == 0;
+}
+
+// The png color type and bit depth from the IHDR, and whether there is a tRNS chunk.
+static bool read_header(const TransformResult &result, int *color_type, int *bit_depth,
+                        bool *has_trns) {
+    auto png = reinterpret_cast<const uint8_t *>(result.encoded);
+    if(result.status != kTransformOk || result.size < 33 || memcmp(png + 12, "IHDR", 4) != 0)
+        return false;
+
+    *bit_depth = png[24];
+    *color_type = png[25];
+    *has_trns = false;
+    for(size_t at = 8; at + 12 <= result.size;) {
+        size_t length = (size_t)png[at] << 24 | png[at + 1] << 16 | png[at + 2] << 8 | png[at + 3];
+        if(memcmp(png + at + 4, "tRNS", 4) == 0)
+            *has_trns = true;
+        at += length + 12;
+    }
+    return true;
+}
+
+static bool decode_bgra(const TransformResult &result, std::vector<uint8_t> *pixels) {
+    if(result.status != kTransformOk)
+        return false;
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if(!png_image_begin_read_from_memory(&image, result.encoded, result.size))
+        return false;
+
+    image.format = PNG_FORMAT_BGRA;
+    pixels->resize(PNG_IMAGE_SIZE(image));
+    bool ok = png_image_finish_read(&image, nullptr, pixels->data(), 0, nullptr);
+    png_image_free(&image);
+    return ok;
+}
+
+static TransformResult stepped(int width, int height, std::vector<uint8_t> &frame,
+                               const TransformOptions *options) {
+    auto handle = transform_begin_png(width, height, frame.size(), frame.data(), options);
+    if(handle == nullptr)
+        return {};
+
+    TransformProgress progress;
+    do {
+        progress = transform_step(handle, 1);
+    } while(!progress.done && !progress.failed);
+    return transform_finish(handle);
+}
+
+static TransformResult pushed(int width, int height, const std::vector<uint8_t> &frame,
+                              const TransformOptions *options) {
+    auto handle = png_encoder_begin(width, height, options);
+    const size_t row_bytes = frame.size() / height;
+    for(int y = 0; y < height; y += 32) {
+        int count = y + 32 > height ? height - y : 32;
+        if(png_encoder_push_rows(handle, frame.data() + y * row_bytes, count, row_bytes) !=
+           kTransformOk)
+            break;
+    }
+    return png_encoder_finish(handle);
+}
+
+int main() {
+    const int width = 800, height = 400;
+
+    const struct {
+        uint8_t bgra[4];
+        int alpha_type;
+        int orientation;
+        bool trns;
+    } cases[] = {
+        // opaque, with and without the alpha type saying so
+        { {40, 90, 200, 255}, kTransformAlphaPremul, kTransformOrientationNone, false },
+        { {40, 90, 200, 7}, kTransformAlphaOpaque, kTransformOrientationNone, false },
+        // translucent and fully transparent colors need a tRNS entry
+        { {20, 45, 100, 128}, kTransformAlphaPremul, kTransformOrientationNone, true },
+        { {20, 45, 100, 128}, kTransformAlphaUnpremul, kTransformOrientationNone, true },
+        { {0, 0, 0, 0}, kTransformAlphaPremul, kTransformOrientationNone, true },
+        // rotated, so the png is 400 wide and 800 tall
+        { {20, 45, 100, 128}, kTransformAlphaPremul, kTransformOrientationRotate90, true },
+        { {40, 90, 200, 255}, kTransformAlphaPremul, kTransformOrientationRotate270, false },
+    };
+
+    for(const auto &c : cases) {
+        std::vector<uint8_t> frame(4 * width * height);
+        for(size_t i = 0; i < frame.size(); i += 4)
+            memcpy(frame.data() + i, c.bgra, 4);
+
+        TransformOptions options = {};
+        options.alpha_type = c.alpha_type;
+        options.orientation = c.orientation;
+
+        // a one-bit palette png of a few dozen bytes
+        auto png = transform_to_png_ex(width, height, frame.size(), frame.data(), &options);
+        int color_type = 0, bit_depth = 0;
+        bool has_trns = false;
+        if(!read_header(png, &color_type, &bit_depth, &has_trns) ||
+           color_type != PNG_COLOR_TYPE_PALETTE || bit_depth != 1 || has_trns != c.trns ||
+           png.size > 200)
+            return 1;
+
+        // that decodes to the BGRA output
+        auto bgra = transform_to_bgra8888_ex(width, height, frame.size(), frame.data(), &options);
+        std::vector<uint8_t> decoded;
+        if(!decode_bgra(png, &decoded) || bgra.status != kTransformOk ||
+           decoded.size() != bgra.size || memcmp(decoded.data(), bgra.encoded, bgra.size) != 0)
+            return 1;
+
+        // stepping through the rows writes the same png
+        auto steps = stepped(width, height, frame, &options);
+        if(!same(png, steps))
+            return 1;
+
+        // pushed rows are encoded before the frame is seen whole, so they make a
+        // larger png of the same pixels
+        if(c.orientation == kTransformOrientationNone) {
+            auto rows = pushed(width, height, frame, &options);
+            std::vector<uint8_t> pushed_pixels;
+            if(!read_header(rows, &color_type, &bit_depth, &has_trns) ||
+               color_type == PNG_COLOR_TYPE_PALETTE || !decode_bgra(rows, &pushed_pixels) ||
+               pushed_pixels != decoded)
+                return 1;
+            memfree(rows.handle);
+        }
+
+        memfree(png.handle);
+        memfree(bgra.handle);
+        memfree(steps.handle);
+    }
+
+    // one gray level is a gray palette entry
+    std::vector<uint8_t> gray(width * height, 77);
+    TransformOptions options = {};
+    options.color_type = kTransformColorGray8;
+    auto png = transform_to_png_ex(width, height, gray.size(), gray.data(), &options);
+    int color_type = 0, bit_depth = 0;
+    bool has_trns = false;
+    std::vector<uint8_t> decoded;
+    if(!read_header(png, &color_type, &bit_depth, &has_trns) ||
+       color_type != PNG_COLOR_TYPE_PALETTE || has_trns || !decode_bgra(png, &decoded))
+        return 1;
+    for(size_t i = 0; i < decoded.size(); i += 4) {
+        if(decoded[i] != 77 || decoded[i + 1] != 77 || decoded[i + 2] != 77 ||
+           decoded[i + 3] != 255)
+            return 1;
+    }
+    memfree(png.handle);
+
+    // a step reads only as far ahead as its rows, and a later step may be cancelled
+    std::vector<uint8_t> flat(4 * width * height, 0x80);
+    auto token = transform_cancel_token_create();
+    TransformOptions cancelled = {};
+    cancelled.cancel = token;
+    auto handle = transform_begin_png(width, height, flat.size(), flat.data(), &cancelled);
+    if(handle == nullptr)
+        return 1;
+    auto first = transform_step(handle, 0);
+    transform_cancel(token);
+    auto second = transform_step(handle, 0);
+    auto result = transform_finish(handle);
+    transform_cancel_token_destroy(token);
+    if(first.done || first.failed || first.rows_encoded != 0 || !second.failed ||
+       result.status != kTransformCancelled)
+        return 1;
+
+    // a second color anywhere, even in the last pixel, is encoded in full
+    std::vector<uint8_t> almost(4 * width * height, 0);
+    almost[almost.size() - 1] = 255;
+    auto full = transform_to_png(width, height, almost.size(), almost.data());
+    if(!read_header(full, &color_type, &bit_depth, &has_trns) ||
+       color_type != PNG_COLOR_TYPE_RGB_ALPHA)
+        return 1;
+    memfree(full.handle);
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sk_image_info.h>
+#include <sk_row_transform.h>
+#include <skcms.h>
+
+struct Case {
+    SkColorType colorType;
+    SkRowDst dst;
+    skcms_PixelFormat srcFmt;
+    skcms_PixelFormat dstFmt;
+};
+
+static const Case kCases[] = {
+    { kBGRA_8888_SkColorType, SkRowDst::kPng,       skcms_PixelFormat_BGRA_8888, skcms_PixelFormat_RGBA_8888 },
+    { kRGBA_8888_SkColorType, SkRowDst::kPng,       skcms_PixelFormat_RGBA_8888, skcms_PixelFormat_RGBA_8888 },
+    { kBGRA_8888_SkColorType, SkRowDst::kBGRA_8888, skcms_PixelFormat_BGRA_8888, skcms_PixelFormat_BGRA_8888 },
+    { kRGBA_8888_SkColorType, SkRowDst::kBGRA_8888, skcms_PixelFormat_RGBA_8888, skcms_PixelFormat_BGRA_8888 },
+};
+
+// Transforms |rows| rows of |width| pixels, |src_row_bytes| apart, and compares them with
+// skcms converting the same pixels one row at a time.
+static bool matches_skcms(const Case &c, const std::vector<unsigned char> &src, int width,
+                          int rows, size_t src_row_bytes) {
+    auto info = SkImageInfo::Make(width, rows, c.colorType, kPremul_SkAlphaType);
+    auto transform = SkChooseRowTransform(info, c.dst);
+    if(transform == nullptr || transform->fDstBytesPerPixel != 4)
+        return false;
+
+    const size_t dst_row_bytes = width * 4;
+    std::vector<unsigned char> expected(dst_row_bytes * rows), actual(dst_row_bytes * rows);
+    for(int y = 0; y < rows; y++) {
+        skcms_Transform(src.data() + y * src_row_bytes, c.srcFmt,
+                        skcms_AlphaFormat_PremulAsEncoded, nullptr,
+                        expected.data() + y * dst_row_bytes, c.dstFmt,
+                        skcms_AlphaFormat_Unpremul, nullptr, width);
+    }
+    (*transform)(reinterpret_cast<char *>(actual.data()), dst_row_bytes,
+                 reinterpret_cast<const char *>(src.data()), src_row_bytes, width, rows);
+
+    return expected == actual;
+}
+
+static int check_variant() {
+    for(const Case &c : kCases) {
+        // Every (value, alpha) pair, including values above alpha, in every color channel,
+        // as 16 packed rows of 16 pixels per alpha.
+        for(int a = 0; a < 256; a++) {
+            std::vector<unsigned char> pixels(256 * 4);
+            for(int v = 0; v < 256; v++) {
+                pixels[4 * v + 0] = v;
+                pixels[4 * v + 1] = 255 - v;
+                pixels[4 * v + 2] = v ^ 0x5A;
+                pixels[4 * v + 3] = a;
+            }
+            if(!matches_skcms(c, pixels, 16, 16, 16 * 4))
+                return 1;
+        }
+
+        // Runs of opaque and transparent pixels between translucent ones, at every width up
+        // to a few vectors and in padded rows, so each fast path and each tail length is taken.
+        for(int width = 1; width <= 40; width++) {
+            const int rows = 3;
+            const size_t row_bytes = width * 4 + 12;
+            std::vector<unsigned char> pixels(row_bytes * rows);
+            for(int y = 0; y < rows; y++) {
+                for(int x = 0; x < width; x++) {
+                    const int run = (x / 8 + y) % 3;
+                    unsigned char *p = pixels.data() + y * row_bytes + 4 * x;
+                    p[0] = 13 * x + y;
+                    p[1] = 29 * x + 1;
+                    p[2] = 255 - 3 * x;
+                    p[3] = run == 0 ? 255 : run == 1 ? 0 : 7 * x + 3;
+                }
+            }
+            if(!matches_skcms(c, pixels, width, rows, row_bytes))
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    // The kernels are picked once per process, so each variant is checked in a child that
+    // forces it before its first transform.  Variants the host lacks fall back to the best one
+    // it has, which is then checked again.
+    for(const char *variant : { "avx2", "ssse3", "sse2", "neon", "scalar" }) {
+        pid_t pid = fork();
+        if(pid < 0)
+            return 1;
+
+        if(pid == 0) {
+            setenv("SKBITMAP_TO_PNG_CPU", variant, 1);
+            _exit(check_variant());
+        }
+
+        int status = 0;
+        if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            return 1;
+    }
+
+    return 0;
+}